@@ -0,0 +1,89 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef TRACK_ALLOCATIONS
+
+static std::atomic<uint64_t> allocationCount{ 0 };
+
+static void* countedAllocate(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* pointer = std::malloc(size == 0 ? 1 : size);
+	if (!pointer) throw std::bad_alloc();
+	return pointer;
+}
+
+static void* countedAllocateAligned(std::size_t size, std::size_t alignment)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	//aligned_alloc wants a size that is a multiple of the alignment
+	size = (size + alignment - 1) / alignment * alignment;
+#ifdef _MSC_VER
+	void* pointer = _aligned_malloc(size == 0 ? alignment : size, alignment);
+#else
+	void* pointer = std::aligned_alloc(alignment, size == 0 ? alignment : size);
+#endif
+	if (!pointer) throw std::bad_alloc();
+	return pointer;
+}
+
+static void countedFreeAligned(void* pointer)
+{
+#ifdef _MSC_VER
+	_aligned_free(pointer);
+#else
+	std::free(pointer);
+#endif
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return countedAllocate(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return countedAllocate(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, (std::size_t)alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, (std::size_t)alignment); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { countedFreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { countedFreeAligned(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { countedFreeAligned(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { countedFreeAligned(pointer); }
+
+bool AllocationCounter::isEnabled()
+{
+	return true;
+}
+
+uint64_t AllocationCounter::getCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationCounter::isEnabled()
+{
+	return false;
+}
+
+uint64_t AllocationCounter::getCount()
+{
+	return 0;
+}
+
+#endif // TRACK_ALLOCATIONS
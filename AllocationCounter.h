@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+//counts heap allocations made through operator new on every thread
+//the counting operator new is only compiled in with TRACK_ALLOCATIONS, otherwise the count stays 0
+class AllocationCounter
+{
+public:
+	static bool isEnabled();
+	static uint64_t getCount();	// Allocations since the program started
+
+	// Allocations made between construction and getCount(), e.g. around one frame
+	class Scope {
+	public:
+		Scope() : start(AllocationCounter::getCount()) {}
+		uint64_t getCount() const { return AllocationCounter::getCount() - start; }
+
+	private:
+		uint64_t start;
+	};
+};
@@ -1,31 +1,50 @@
 #include "Application.h"
 
+#include <cassert>
+
 bool Application::Initialize(uint16 width, uint16 height)
 {
+    if(!initJobs()) return false;
     if(!initWindowAndDevice(width, height)) return false;
     if(!initDepthBuffer()) return false;
+    if(!initGpuCulling()) return false;
     if(!initRenderPipeline()) return false;
     if(!initTextureSampler()) return false;
     if(!initTexture()) return false;
     if(!initUniforms()) return false;
     if(!initScene()) return false;
+    if(!initResidency()) return false;
 
     return true;
 }
 
 void Application::Terminate()
 {
+    terminateResidency();
     terminateScene();
     terminateUniforms();
     terminateTexture();
     terminateTextureSampler();
     terminateRenderPipeline();
+    terminateGpuCulling();
     terminateDepthBuffer();
+
+    //anything still tracked at this point was never destroyed
+    if (ResourceTracker::getLiveObjectCount() > 0) {
+        cout << "GPU resources leaked: " << ResourceTracker::getLiveObjectCount() << endl;
+        ResourceTracker::dumpReport("gpu_memory_report.json");
+    }
+
     terminateWindowAndDevice();
+    terminateJobs();
 }
 
 void Application::MainLoop()
 {
+    //the CPU time of a benchmark frame covers everything from acquiring the target to presenting it
+    //the allocations are counted up to the submit, the readbacks and the present after it map buffers
+    auto frameStart = std::chrono::high_resolution_clock::now();
+    AllocationCounter::Scope frameAllocations;
     TextureView targetView = this->GetNextSurfaceTextureView();
     if (!targetView) {
         return;
@@ -33,22 +52,183 @@ void Application::MainLoop()
 
     glfwPollEvents();
 
+    this->residency.beginFrame();
+
     CommandEncoderDescriptor commandEncoderDescriptor = {};
     commandEncoderDescriptor.nextInChain = nullptr;
     commandEncoderDescriptor.label = "Command Encoder";
 
     CommandEncoder encoder = this->device.createCommandEncoder(commandEncoderDescriptor);
 
+    this->frameStats = FrameStats();
+
+    //the slot of this frame is free once the GPU finished the frame that used it frameCount frames ago
+    this->frameRing.beginFrame();
+    this->frameStats.frameWaitMilliseconds = this->frameRing.getWaitMilliseconds();
+    if (this->benchmarkMode) {
+        BenchmarkRun::Keyframe camera = this->benchmark.getCamera();
+        this->cameraUniform.viewMatrix = glm::lookAt(camera.position, camera.target, vec3(0.0, 1.0, 0.0));
+    }
+    this->frameRing.upload(this->queue, this->cameraUniformBuffer, 0, &this->cameraUniform, sizeof(CameraUniform));
+    if (this->timestampsSupported) {
+        this->gpuTimer.beginFrame(this->frameNumber, encoder);
+    }
+
+    //world matrices and the draw list are built on the worker threads before anything is recorded
+    //every container used here keeps its capacity between frames, so a static scene allocates nothing
+    //with either GPU culling the draw list is not needed, the compute passes decide what is drawn
+    AllocationCounter::Scope buildAllocations;
+    auto buildStart = std::chrono::high_resolution_clock::now();
+    this->transforms.update(&this->jobs);
+    this->updateSceneBounds();
+    if (this->usesCpuDrawList()) {
+        this->buildDrawList();
+        this->sortDrawList();
+    }
+    auto buildEnd = std::chrono::high_resolution_clock::now();
+    this->frameStats.buildMilliseconds = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+    this->frameStats.buildAllocations = buildAllocations.getCount();
+
+    //with the GPU update the store only knows what changed, the matrices are made by a compute pass
+    if (this->gpuTransformUpdate) {
+        this->frameStats.modelUniformWrites = this->gpuTransforms.record(this->queue, encoder, this->transforms, this->modelTransformTable);
+        this->frameStats.matricesComputed = this->gpuTransforms.getComputedCount();
+    }
+    else {
+        this->frameStats.matricesComputed = this->transforms.getComputedCount();
+        this->frameStats.modelUniformWrites = getActiveTransformBuffer().upload(this->queue, this->frameRing, this->transforms);
+    }
+
+    //the camera and transform copies go before the first pass that reads them
+    this->frameRing.flush(encoder);
+
+    if (this->usesIndirectDraws() && this->usesCpuDrawList()) {
+        this->writeIndirectDraws();
+    }
+
+    //after the transform upload and propagation, the cull pass reads the world matrices of the table
+    if (this->gpuFrustumCulling) {
+        this->updateGpuFrustumObjects();
+        this->gpuFrustumCuller.record(this->queue, encoder, this->cameraUniform.projectionMatrix * this->cameraUniform.viewMatrix,
+            this->modelTransformTable, this->indirectDraws);
+    }
+
+    if (this->gpuCulling) {
+        this->updateGpuCullItems();
+        this->gpuCuller.recordFirstPhase(this->queue, encoder, this->cameraUniform.projectionMatrix * this->cameraUniform.viewMatrix);
+    }
+
+    auto encodeStart = std::chrono::high_resolution_clock::now();
+
+    this->scenePass.resetCounters();
+    this->beginScenePass(encoder, targetView, LoadOp::Clear, !this->gpuCulling);
+    if (this->gpuCulling) {
+        this->encodeCulledDraws(this->scenePass, 0);
+    }
+    else if (this->gpuFrustumCulling) {
+        this->encodeGpuFrustumDraws(this->scenePass);
+    }
+    else {
+        this->encodeDrawList(this->scenePass);
+    }
+    this->scenePass.end();
+
+    //the second phase draws what the previous frame's depth hid but this frame's depth does not
+    if (this->gpuCulling) {
+        this->gpuCuller.recordSecondPhase(encoder);
+
+        this->beginScenePass(encoder, targetView, LoadOp::Load, true);
+        this->encodeCulledDraws(this->scenePass, 1);
+        this->scenePass.end();
+    }
+
+    if (this->timestampsSupported) {
+        this->gpuTimer.resolve(encoder);
+    }
+
+    auto encodeEnd = std::chrono::high_resolution_clock::now();
+    this->frameStats.encodeMilliseconds = std::chrono::duration<double, std::milli>(encodeEnd - encodeStart).count();
+    this->frameStats.stateCallsIssued = this->scenePass.getCounters().issued;
+    this->frameStats.stateCallsElided = this->scenePass.getCounters().elided;
+
+    //encode and submit the render pass commands
+    CommandBufferDescriptor commandBufferDescriptor = {};
+    commandBufferDescriptor.nextInChain = nullptr;
+    commandBufferDescriptor.label = "Command Buffer";
+    CommandBuffer commandBuffer = encoder.finish(commandBufferDescriptor);
+
+    //cout<<"Submitting the command buffer"<<endl;
+    this->queue.submit(1, &commandBuffer);
+    commandBuffer.release();
+    this->frameStats.frameAllocations = frameAllocations.getCount();
+    this->frameRing.endFrame(this->queue);
+    if (this->timestampsSupported) {
+        this->gpuTimer.read();
+    }
+    this->frameStats.frameUploadBytes = this->frameRing.getUploadedBytes();
+    this->frameStats.frameOverflowBytes = this->frameRing.getOverflowBytes();
+
+    if (this->gpuCulling) {
+        this->gpuCuller.readCounters();
+        const GpuCuller::Counters& counters = this->gpuCuller.getCounters();
+        this->frameStats.gpuDrawnFirstPhase = counters.drawnFirstPhase;
+        this->frameStats.gpuDrawnSecondPhase = counters.drawnSecondPhase;
+        this->frameStats.gpuCulled = counters.culled;
+    }
+    if (this->gpuFrustumCulling) {
+        this->gpuFrustumCuller.readVisibleCount();
+        this->frameStats.gpuFrustumVisible = this->gpuFrustumCuller.getVisibleCount();
+    }
+
+    //release the texture view
+    targetView.release();
+
+    //evict what did not fit in the budget now that the frame is recorded
+    this->residency.endFrame();
+    this->checkFrameAllocations();
+
+    //present the surface
+#ifndef __EMSCRIPTEN__
+    this->surface.present();
+#endif // !__EMSCRIPTEN__
+
+#if defined(WEBGPU_BACKEND_DAWN)
+    this->device.tick();
+#elif defined(WEBGPU_BACKEND_WGPU)
+    wgpuDevicePoll(device, false, nullptr);
+#endif
+
+    //GPU times arrive from the ticks, a few frames after their frame
+    for (const GpuTimer::Result& result : this->gpuTimer.getResults()) {
+        this->lastGpuMilliseconds = result.milliseconds;
+        if (this->benchmarkMode) this->benchmark.recordGpuTime(result.frame, result.milliseconds);
+    }
+    this->gpuTimer.clearResults();
+    this->frameStats.gpuMilliseconds = this->lastGpuMilliseconds;
+    this->frameNumber++;
+
+    if (this->benchmarkMode) {
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+        this->benchmark.recordCpuTime(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+        if (this->benchmark.isFinished()) {
+            this->finishBenchmark();
+        }
+    }
+}
+
+void Application::beginScenePass(CommandEncoder encoder, TextureView targetView, LoadOp loadOp, bool lastPass)
+{
     RenderPassDescriptor renderPassDescriptor = {};
     renderPassDescriptor.nextInChain = nullptr;
     renderPassDescriptor.depthStencilAttachment = nullptr;
-    renderPassDescriptor.timestampWrites = nullptr; //do not measure the time
+    renderPassDescriptor.timestampWrites = this->timestampsSupported ? this->gpuTimer.getPassTimestamps(lastPass) : nullptr;
 
     RenderPassColorAttachment renderPassColorAttachment = {};
     renderPassColorAttachment.view = targetView;
     renderPassColorAttachment.resolveTarget = nullptr;
 
-    renderPassColorAttachment.loadOp = LoadOp::Clear;
+    //a pass that continues the frame keeps what the previous one drew
+    renderPassColorAttachment.loadOp = loadOp;
     renderPassColorAttachment.storeOp = StoreOp::Store;
     renderPassColorAttachment.clearValue = Color{ 0.2f, 0.2f, 0.2f, 1.0f }; //any value is fine
 
@@ -63,7 +243,7 @@ void Application::MainLoop()
     RenderPassDepthStencilAttachment renderPassDepthStencilAttachment = {};
     renderPassDepthStencilAttachment.view = this->depthTextureView;
     renderPassDepthStencilAttachment.depthClearValue = 1.0f;    //initial far value
-    renderPassDepthStencilAttachment.depthLoadOp = LoadOp::Clear;
+    renderPassDepthStencilAttachment.depthLoadOp = loadOp;
     renderPassDepthStencilAttachment.depthStoreOp = StoreOp::Store;
     renderPassDepthStencilAttachment.depthReadOnly = false; //turn off writing to the depth buffer globally
 
@@ -78,45 +258,85 @@ void Application::MainLoop()
 
     renderPassDescriptor.depthStencilAttachment = &renderPassDepthStencilAttachment;
 
-    RenderPassEncoder renderPass = encoder.beginRenderPass(renderPassDescriptor);
+    this->scenePass.begin(encoder.beginRenderPass(renderPassDescriptor));
+    this->bindScenePipeline(this->scenePass);
+}
 
-    // Select which render pipeline to use
-    renderPass.setPipeline(this->renderPipeline);
+RenderPipeline Application::getScenePipeline() const
+{
+    return this->transformLayout == TransformBuffer::Layout::StorageTable ? this->transformTablePipeline : this->renderPipeline;
+}
 
-    mat4 rootModelMatrix = mat4(1.0f);
-    this->renderScene(renderPass, &rootModelMatrix, this->scene);
+void Application::bindScenePipeline(FilteredRenderPass& renderPass)
+{
+    //the transform table and the object indices of the indirect draws are bound once for the pass
+    if (this->usesIndirectDraws()) {
+        renderPass.setPipeline(this->indirectPipeline);
+        renderPass.setBindGroup(1, this->indirectDraws.getBindGroup(this->modelTransformTable), 0, nullptr);
+        return;
+    }
 
-    renderPass.end();
-    renderPass.release();
+    // Select which render pipeline to use
+    renderPass.setPipeline(this->getScenePipeline());
+    if (this->transformLayout == TransformBuffer::Layout::StorageTable) {
+        //the whole transform table is bound once for the pass
+        renderPass.setBindGroup(1, this->modelTransformTable.getBindGroup(), 0, nullptr);
+    }
+}
 
-    //encode and submit the render pass commands
-    CommandBufferDescriptor commandBufferDescriptor = {};
-    commandBufferDescriptor.nextInChain = nullptr;
-    commandBufferDescriptor.label = "Command Buffer";
-    CommandBuffer commandBuffer = encoder.finish(commandBufferDescriptor);
+bool Application::IsRunning()
+{
+    return !glfwWindowShouldClose(this->window) && !(this->benchmarkMode && this->benchmark.isFinished());
+}
 
-    //cout<<"Submitting the command buffer"<<endl;
-    this->queue.submit(1, &commandBuffer);
-    commandBuffer.release();
+void Application::setBenchmark(const BenchmarkRun::Config& config)
+{
+    this->benchmark.begin(config);
+    this->benchmarkMode = true;
+}
 
-    //release the texture view
-    targetView.release();
+PresentMode Application::getPresentMode(Adapter adapter)
+{
+    if (!this->benchmarkMode) return PresentMode::Fifo;
+
+    //Fifo waits for the vertical blank, the benchmark modes are only used where they exist
+    PresentMode wanted = PresentMode::Fifo;
+    switch (this->benchmark.getConfig().presentMode) {
+    case BenchmarkRun::PresentMode::Fifo: wanted = PresentMode::Fifo; break;
+    case BenchmarkRun::PresentMode::Immediate: wanted = PresentMode::Immediate; break;
+    case BenchmarkRun::PresentMode::Mailbox: wanted = PresentMode::Mailbox; break;
+    }
 
-    //present the surface
-#ifndef __EMSCRIPTEN__
-    this->surface.present();
-#endif // !__EMSCRIPTEN__
+    SurfaceCapabilities capabilities = Default;
+    this->surface.getCapabilities(adapter, &capabilities);
+    bool supported = false;
+    for (size_t i = 0; i < capabilities.presentModeCount; ++i) {
+        supported = supported || capabilities.presentModes[i] == wanted;
+    }
+    capabilities.freeMembers();
 
-#if defined(WEBGPU_BACKEND_DAWN)
-    this->device.tick();
-#elif defined(WEBGPU_BACKEND_WGPU)
-    wgpuDevicePoll(device, false, nullptr);
-#endif
+    if (!supported) {
+        cout << "The surface has no " << BenchmarkRun::getPresentModeName(this->benchmark.getConfig().presentMode) << " present mode, using fifo" << endl;
+        return PresentMode::Fifo;
+    }
+    return wanted;
 }
 
-bool Application::IsRunning()
+void Application::finishBenchmark()
 {
-    return !glfwWindowShouldClose(this->window);
+    //the timestamps of the last frames are still being read, a lost device would never finish them
+    auto waitStart = std::chrono::high_resolution_clock::now();
+    while (this->timestampsSupported && this->gpuTimer.isReading()) {
+        this->wgpuPollEvents(false);
+        auto now = std::chrono::high_resolution_clock::now();
+        if (std::chrono::duration<double>(now - waitStart).count() > 5.0) break;
+    }
+    for (const GpuTimer::Result& result : this->gpuTimer.getResults()) {
+        this->benchmark.recordGpuTime(result.frame, result.milliseconds);
+    }
+    this->gpuTimer.clearResults();
+
+    this->benchmark.writeResults();
 }
 
 bool Application::initWindowAndDevice(uint16 width, uint16 height) {
@@ -140,6 +360,16 @@ bool Application::initWindowAndDevice(uint16 width, uint16 height) {
         return false;
     }
 
+    glfwSetWindowUserPointer(this->window, this);
+    glfwSetKeyCallback(this->window, [](GLFWwindow* window, int key, int /* scancode */, int action, int /* mods */) {
+        Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+        if (app) app->onKey(key, action);
+        });
+    glfwSetMouseButtonCallback(this->window, [](GLFWwindow* window, int button, int action, int /* mods */) {
+        Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+        if (app) app->onMouseButton(button, action);
+        });
+
     //get the surface
     this->surface = glfwGetWGPUSurface(this->instance, this->window);
 
@@ -199,7 +429,21 @@ bool Application::initWindowAndDevice(uint16 width, uint16 height) {
     DeviceDescriptor deviceDescriptor = {};
     deviceDescriptor.nextInChain = nullptr;
     deviceDescriptor.label = "My Device"; // anything works here, that's your call
-    deviceDescriptor.requiredFeatureCount = 0; // we do not require any specific feature
+    //indirect draws with a first instance other than 0 need a feature, GPU culling is off without it
+    vector<WGPUFeatureName> requiredFeatures;
+    if (adapter.hasFeature(FeatureName::IndirectFirstInstance)) {
+        requiredFeatures.push_back(FeatureName::IndirectFirstInstance);
+    }
+    //render bundles are recorded on the worker threads only if the device locks itself
+    if (adapter.hasFeature(FeatureName::ImplicitDeviceSynchronization)) {
+        requiredFeatures.push_back(FeatureName::ImplicitDeviceSynchronization);
+    }
+    //the GPU time of a frame is measured with timestamps when there are any
+    if (adapter.hasFeature(FeatureName::TimestampQuery)) {
+        requiredFeatures.push_back(FeatureName::TimestampQuery);
+    }
+    deviceDescriptor.requiredFeatureCount = requiredFeatures.size();
+    deviceDescriptor.requiredFeatures = requiredFeatures.data();
     deviceDescriptor.defaultQueue.nextInChain = nullptr;
     deviceDescriptor.defaultQueue.label = "The default queue";
 
@@ -254,7 +498,7 @@ bool Application::initWindowAndDevice(uint16 width, uint16 height) {
     config.usage = TextureUsage::RenderAttachment;
     config.device = this->device;
 
-    config.presentMode = PresentMode::Fifo;
+    config.presentMode = this->getPresentMode(adapter);
     config.alphaMode = CompositeAlphaMode::Auto;
 
     this->surface.configure(config);
@@ -287,11 +531,11 @@ bool Application::initDepthBuffer()
     depthTextureDescriptor.mipLevelCount = 1;
     depthTextureDescriptor.sampleCount = 1;
     depthTextureDescriptor.size = { this->windowWidth, this->windowHeight, 1 };
-    depthTextureDescriptor.usage = TextureUsage::RenderAttachment;
+    depthTextureDescriptor.usage = TextureUsage::RenderAttachment | TextureUsage::TextureBinding;	//read by the GPU culling pyramid
     depthTextureDescriptor.viewFormatCount = 1;
     depthTextureDescriptor.viewFormats = (WGPUTextureFormat*)&this->depthTextureFormat;
 
-    this->depthTexture = this->device.createTexture(depthTextureDescriptor);
+    this->depthTexture = ResourceTracker::createTexture(this->device, depthTextureDescriptor, ResourceCategory::RenderTarget);
 
     //Create depth texture view
     TextureViewDescriptor depthTextureViewDescriptor = {};
@@ -311,8 +555,25 @@ bool Application::initDepthBuffer()
 void Application::terminateDepthBuffer()
 {
     this->depthTextureView.release();
-	this->depthTexture.destroy();
-	this->depthTexture.release();
+    ResourceTracker::destroyTexture(this->depthTexture);
+}
+
+bool Application::initGpuCulling()
+{
+    //the cull passes write the transform slot as the first instance of the indirect draws
+    this->gpuCullingSupported = this->device.hasFeature(FeatureName::IndirectFirstInstance);
+    if (!this->gpuCullingSupported) {
+        cout << "GPU culling is not available, the device has no indirect-first-instance" << endl;
+        return true;
+    }
+
+    return this->gpuCuller.initialize(this->device, this->depthTexture, this->windowWidth, this->windowHeight);
+}
+
+void Application::terminateGpuCulling()
+{
+    this->gpuCuller.terminate();
+    this->gpuCulling = false;
 }
 
 bool Application::initRenderPipeline()
@@ -465,6 +726,7 @@ bool Application::initRenderPipeline()
     modelMatrixBindGroupLayoutEntry.binding = 0;
     modelMatrixBindGroupLayoutEntry.visibility = ShaderStage::Vertex;
     modelMatrixBindGroupLayoutEntry.buffer.type = BufferBindingType::Uniform;
+    modelMatrixBindGroupLayoutEntry.buffer.hasDynamicOffset = true;	//one buffer holds every model matrix
     modelMatrixBindGroupLayoutEntry.buffer.minBindingSize = sizeof(glm::mat4);
 
     BindGroupLayoutDescriptor modelMatrixBindGroupLayoutDescriptor = {};
@@ -510,11 +772,65 @@ bool Application::initRenderPipeline()
     renderPipelineDescriptor.layout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
     this->renderPipeline = this->device.createRenderPipeline(renderPipelineDescriptor);
 
-    return this->renderPipeline != nullptr;
+    //Transform table variant, the second group is a read-only storage buffer with every model matrix
+    this->transformTableShaderModule = loadShaderModule(RESOURCE_DIR "/shader_transform_table.wgsl", this->device);
+
+    BindGroupLayoutEntry modelTableBindGroupLayoutEntry = {};
+    modelTableBindGroupLayoutEntry.binding = 0;
+    modelTableBindGroupLayoutEntry.visibility = ShaderStage::Vertex;
+    modelTableBindGroupLayoutEntry.buffer.type = BufferBindingType::ReadOnlyStorage;
+    modelTableBindGroupLayoutEntry.buffer.minBindingSize = sizeof(glm::mat4);
+
+    BindGroupLayoutDescriptor modelTableBindGroupLayoutDescriptor = {};
+    modelTableBindGroupLayoutDescriptor.label = "Model Table Bind Group Layout";
+    modelTableBindGroupLayoutDescriptor.entryCount = 1;
+    modelTableBindGroupLayoutDescriptor.entries = &modelTableBindGroupLayoutEntry;
+
+    this->modelTableBindGroupLayout = this->device.createBindGroupLayout(modelTableBindGroupLayoutDescriptor);
+
+    vector<BindGroupLayout> transformTableBindGroupLayouts = { cameraBindGroupLayout, modelTableBindGroupLayout, textureBindGroupLayout };
+    pipelineLayoutDescriptor.label = "Transform Table Pipeline Layout";
+    pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)transformTableBindGroupLayouts.data();
+
+    renderPipelineDescriptor.layout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+    renderPipelineDescriptor.vertex.module = this->transformTableShaderModule;
+    fragmentState.module = this->transformTableShaderModule;
+    this->transformTablePipeline = this->device.createRenderPipeline(renderPipelineDescriptor);
+
+    //Indirect variant, the second group also holds the transform slot of every indirect draw
+    this->indirectShaderModule = loadShaderModule(RESOURCE_DIR "/shader_indirect.wgsl", this->device);
+
+    vector<BindGroupLayoutEntry> indirectObjectsLayoutEntries(2, modelTableBindGroupLayoutEntry);
+    indirectObjectsLayoutEntries[1].binding = 1;
+    indirectObjectsLayoutEntries[1].buffer.minBindingSize = sizeof(uint32_t);
+
+    BindGroupLayoutDescriptor indirectObjectsBindGroupLayoutDescriptor = {};
+    indirectObjectsBindGroupLayoutDescriptor.label = "Indirect Objects Bind Group Layout";
+    indirectObjectsBindGroupLayoutDescriptor.entryCount = static_cast<uint32_t>(indirectObjectsLayoutEntries.size());
+    indirectObjectsBindGroupLayoutDescriptor.entries = indirectObjectsLayoutEntries.data();
+
+    this->indirectObjectsBindGroupLayout = this->device.createBindGroupLayout(indirectObjectsBindGroupLayoutDescriptor);
+
+    vector<BindGroupLayout> indirectBindGroupLayouts = { cameraBindGroupLayout, indirectObjectsBindGroupLayout, textureBindGroupLayout };
+    pipelineLayoutDescriptor.label = "Indirect Pipeline Layout";
+    pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)indirectBindGroupLayouts.data();
+
+    renderPipelineDescriptor.layout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+    renderPipelineDescriptor.vertex.module = this->indirectShaderModule;
+    fragmentState.module = this->indirectShaderModule;
+    this->indirectPipeline = this->device.createRenderPipeline(renderPipelineDescriptor);
+
+    return this->renderPipeline != nullptr && this->transformTablePipeline != nullptr && this->indirectPipeline != nullptr;
 }
 
 void Application::terminateRenderPipeline()
 {
+    this->indirectPipeline.release();
+    this->indirectShaderModule.release();
+    this->indirectObjectsBindGroupLayout.release();
+    this->transformTablePipeline.release();
+    this->transformTableShaderModule.release();
+    this->modelTableBindGroupLayout.release();
     this->renderPipeline.release();
 	this->shaderModule.release();
 	this->cameraBindGroupLayout.release();
@@ -547,46 +863,115 @@ void Application::terminateTextureSampler()
 
 bool Application::initTexture()
 {
-    this->imageTexture = loadTexture(RESOURCE_DIR "/image.png", this->device, &this->imageTextureView);
-    if (!this->imageTexture) {
-        cout << "Failed to load the texture" << endl;
+    try {
+        this->imageTexture = new custom::Texture(RESOURCE_DIR "/image.png", this->device);
+    }
+    catch (const std::runtime_error& error) {
+        cout << "Failed to load the texture: " << error.what() << endl;
         return false;
     }
 
-    return this->imageTexture && this->imageTextureView;
+    return this->imageTexture != nullptr;
 }
 
 void Application::terminateTexture()
 {
-	this->imageTextureView.release();
-    this->imageTexture.destroy();
-	this->imageTexture.release();
+    delete this->imageTexture;
+    this->imageTexture = nullptr;
 }
 
 bool Application::initScene()
 {
-    this->scene = new SceneObject(&device, &modelMatrixBindGroupLayout);
+    AllocationCounter::Scope loadAllocations;
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    this->scene = this->sceneObjects.create(&transforms, &this->sceneLists);
 
     cout << "Loading the model" << endl;
 
-     SceneObject* object = Model::LoadModel("D:\\Uni\\3D Models\\models\\base_sponza\\NewSponza_Main_glTF_003.gltf",
-         device, textureBindGroupLayout, modelMatrixBindGroupLayout, imageTextureView, sampler);
+    //a benchmark config names its own model
+    std::string modelPath = "D:\\Uni\\3D Models\\models\\base_sponza\\NewSponza_Main_glTF_003.gltf";
+    if (this->benchmarkMode && !this->benchmark.getConfig().model.empty()) {
+        modelPath = this->benchmark.getConfig().model;
+    }
+
+     SceneObject* object = Model::LoadModel(modelPath, &transforms,
+         &this->sceneObjects, &this->meshes, &this->sceneLists, &this->entities, device, textureBindGroupLayout, imageTexture, sampler);
     if (!object) {
         cout<<"Failed to load the model"<<endl;
-        delete this->scene;
+        terminateScene();
         return false;
     }
     this->scene->addChild(object);
-
-    cout << "Model loaded successfully" << endl;
+    this->sceneBvhDirty = true;
+    this->occlusionCuller.initialize(256, 128);
+    this->staticBundles.initialize(this->device);
+    this->drawListBundles.initialize(this->device);
+    this->parallelRecordingSupported = this->device.hasFeature(FeatureName::ImplicitDeviceSynchronization);
+
+    auto loadEnd = std::chrono::high_resolution_clock::now();
+    cout << "Model loaded successfully: " << this->sceneObjects.size() << " nodes, " << this->meshes.size() << " meshes in "
+        << std::chrono::duration<double, std::milli>(loadEnd - loadStart).count() << " ms";
+    if (AllocationCounter::isEnabled()) {
+        cout << ", " << loadAllocations.getCount() << " allocations";
+    }
+    cout << endl;
 
     return this->scene != nullptr;
 }
 
 void Application::terminateScene()
 {
-    delete this->scene;
+    //no walk over the tree: the meshes release their buffers in one flat loop, the nodes own
+    //nothing and are dropped with their chunks, their lists and every transform go at once
+    auto teardownStart = std::chrono::high_resolution_clock::now();
+    this->staticBundles.terminate();
+    this->drawListBundles.terminate();
+    this->entities.clear();
+    this->meshes.clear();
+    this->sceneObjects.clear();
+    this->sceneLists.clear();
+    this->transforms.clear();
     this->scene = nullptr;
+    auto teardownEnd = std::chrono::high_resolution_clock::now();
+    cout << "Scene released in " << std::chrono::duration<double, std::milli>(teardownEnd - teardownStart).count() << " ms" << endl;
+
+    this->sceneItems.clear();
+    this->sceneItemBounds.clear();
+    this->sceneItemSpheres.resize(0);
+    this->dynamicChunks.clear();
+    this->occluderItems.clear();
+    this->visibleBundleChunks.clear();
+    this->bundleList.clear();
+    this->staticItemCount = 0;
+    this->staticBundleSortCount = ~0u;
+    this->staticBundleItems.clear();
+    this->sceneBvhDirty = true;
+}
+
+bool Application::initResidency()
+{
+    this->residency.initialize(this->device, this->residencyBudget);
+
+    this->residency.registerTexture(this->imageTexture);
+    registerResidency(this->scene);
+
+    return true;
+}
+
+void Application::terminateResidency()
+{
+    this->residency.terminate();
+}
+
+void Application::registerResidency(SceneObject* sceneObject)
+{
+    for (Mesh* mesh : sceneObject->getVisualObjects()) {
+        this->residency.registerMesh(mesh);
+    }
+
+    for (SceneObject* child : sceneObject->getChildren()) {
+        registerResidency(child);
+    }
 }
 
 bool Application::initUniforms()
@@ -605,7 +990,7 @@ bool Application::initUniforms()
     bufferDescriptor.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
     bufferDescriptor.mappedAtCreation = false;
 
-    this->cameraUniformBuffer = this->device.createBuffer(bufferDescriptor);
+    this->cameraUniformBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Uniform);
     //// Set the projection matrix
     float ratio = this->windowWidth / (float)this->windowHeight;
     float focalLength = 2.0;
@@ -632,50 +1017,613 @@ bool Application::initUniforms()
 
     this->cameraBindGroup = this->device.createBindGroup(cameraBindGroupDescriptor);
 
+    //model matrices
+    if (!this->modelTransforms.initialize(this->device, this->modelMatrixBindGroupLayout, TransformBuffer::Layout::DynamicUniform)) {
+        cout << "Failed to create the model transform buffer" << endl;
+        return false;
+    }
+    if (!this->modelTransformTable.initialize(this->device, this->modelTableBindGroupLayout, TransformBuffer::Layout::StorageTable)) {
+        cout << "Failed to create the model transform table" << endl;
+        return false;
+    }
+    if (!this->gpuTransforms.initialize(this->device)) {
+        cout << "Failed to create the transform propagation pipeline" << endl;
+        return false;
+    }
+    if (!this->frameRing.initialize(this->device, this->framesInFlight, this->frameUploadSize)) {
+        cout << "Failed to create the frame upload buffers" << endl;
+        return false;
+    }
+    this->timestampsSupported = this->device.hasFeature(FeatureName::TimestampQuery);
+    if (this->timestampsSupported && !this->gpuTimer.initialize(this->device, this->framesInFlight)) {
+        cout << "Failed to create the timestamp queries" << endl;
+        return false;
+    }
+    if (!this->indirectDraws.initialize(this->device, this->indirectObjectsBindGroupLayout)) {
+        cout << "Failed to create the indirect draw buffers" << endl;
+        return false;
+    }
+    if (!this->gpuFrustumCuller.initialize(this->device)) {
+        cout << "Failed to create the frustum cull pipeline" << endl;
+        return false;
+    }
+
     return this->cameraUniformBuffer;
 }
 
 void Application::terminateUniforms()
 {
-    this->cameraUniformBuffer.destroy();
-    this->cameraUniformBuffer.release();
+    this->gpuFrustumCuller.terminate();
+    this->indirectDraws.terminate();
+    this->gpuTimer.terminate();
+    this->frameRing.terminate();
+    this->gpuTransforms.terminate();
+    this->modelTransforms.terminate();
+    this->modelTransformTable.terminate();
+
+    this->cameraBindGroup.release();
+    ResourceTracker::destroyBuffer(this->cameraUniformBuffer);
 
     this->cameraUniformStride = 0;
 }
 
-void Application::renderScene(RenderPassEncoder renderPass, mat4* parentModelMatrix, SceneObject* renderingObject)
+void Application::buildDrawList()
 {
-    mat4 worldModelMatrix = *parentModelMatrix * renderingObject->calculateModelMatrix();
-    renderingObject->writeModelUniformBuffer(this->queue, &worldModelMatrix);
-   
-    vector<Mesh*> meshes = renderingObject->getVisualObjects();
+    this->drawList.clear();
+    this->rasterizeOccluders();
+    bool testOcclusion = this->occlusionCulling && !this->occluderItems.empty();
+
+    //contiguous chunks merged in order keep the order of the scene items, which is the entity store's
+    //with render bundles the static items are culled per bundle chunk and only the others are listed
+    size_t itemCount = this->sceneItems.size();
+    size_t firstItem = this->renderBundles ? std::min<size_t>(this->staticItemCount, itemCount) : 0;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(this->jobs.getThreadCount() * 4, itemCount - firstItem));
+    if (this->chunkDrawLists.size() < chunkCount) {
+        this->chunkDrawLists.resize(chunkCount);
+    }
+    //an empty range (every item in a bundle) runs no chunk, the lists of an earlier frame must not be merged
+    for (vector<DrawItem>& draws : this->chunkDrawLists) {
+        draws.clear();
+    }
 
-    for (int i = 0; i < meshes.size(); i++) {
-		Buffer vertexBuffer = meshes[i]->getVertexBuffer();
-        Buffer indexBuffer = meshes[i]->getIndexBuffer();
-        Buffer normalBuffer = meshes[i]->getNormalBuffer();
-        Buffer uvBuffer = meshes[i]->getUVBuffer();
+    //the cheap sphere tests run first, several items per instruction, and only the survivors pay for
+    //the occlusion test; a sphere is too small when its projected radius, about
+    //radius * projection[1][1] / w in NDC, covers fewer than minCoveragePixels
+    glm::mat4 viewProjection = this->cameraUniform.projectionMatrix * this->cameraUniform.viewMatrix;
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    glm::vec4 wRow = glm::row(viewProjection, 3);
+    glm::vec4 depthRow = glm::row(this->cameraUniform.viewMatrix, 2);
+    uint32_t pipeline = this->transformLayout == TransformBuffer::Layout::StorageTable ? 1 : 0;
+    float minRadiusPerW = 2.0f * this->minCoveragePixels / (this->windowHeight * this->cameraUniform.projectionMatrix[1][1]);
+    this->cullResults.resize(itemCount);
+
+    this->visibleBundleChunks.clear();
+    if (this->renderBundles) {
+        this->cullStaticBundles(frustum, testOcclusion);
+    }
 
-        // Set the vertex buffer
-        renderPass.setVertexBuffer(0, vertexBuffer, 0, vertexBuffer.getSize());
-        renderPass.setVertexBuffer(1, normalBuffer, 0, normalBuffer.getSize());
-        renderPass.setVertexBuffer(2, uvBuffer, 0, uvBuffer.getSize());
+    std::atomic<uint32_t> frustumCulled{ 0 };
+    std::atomic<uint32_t> coverageCulled{ 0 };
+    std::atomic<uint32_t> occlusionCulled{ 0 };
+    this->jobs.parallelFor(itemCount - firstItem, chunkCount, [&](size_t begin, size_t end, size_t chunk) {
+        vector<DrawItem>& draws = this->chunkDrawLists[chunk];
+        begin += firstItem;
+        end += firstItem;
+        if (this->frustumCulling) {
+            const SphereArrays& spheres = this->sceneItemSpheres;
+            CullingKernels::testSpheres(frustum, wRow, minRadiusPerW, spheres.centerX.data() + begin, spheres.centerY.data() + begin,
+                spheres.centerZ.data() + begin, spheres.radius.data() + begin, end - begin, this->cullResults.data() + begin);
+        }
+
+        uint32_t chunkFrustumCulled = 0;
+        uint32_t chunkCoverageCulled = 0;
+        uint32_t chunkOcclusionCulled = 0;
+        for (size_t i = begin; i < end; ++i) {
+            if (this->frustumCulling && this->cullResults[i] != CullingKernels::Result::Visible) {
+                if (this->cullResults[i] == CullingKernels::Result::OutsideFrustum) chunkFrustumCulled++;
+                else chunkCoverageCulled++;
+                continue;
+            }
+            if (testOcclusion && !this->occlusionCuller.isVisible(this->sceneItemBounds[i])) {
+                chunkOcclusionCulled++;
+                continue;
+            }
+            const SceneItem& item = this->sceneItems[i];
+            const SphereArrays& spheres = this->sceneItemSpheres;
+            float viewDepth = glm::dot(depthRow, glm::vec4(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], 1.0f));
+            uint64_t sortKey = DrawSort::makeKey(DrawSort::Opaque, pipeline, item.materialId, item.geometryId, viewDepth);
+            draws.push_back({ item.mesh, this->transforms.getSlot(item.transformId), sortKey });
+        }
+        frustumCulled += chunkFrustumCulled;
+        coverageCulled += chunkCoverageCulled;
+        occlusionCulled += chunkOcclusionCulled;
+        });
+
+    for (size_t i = 0; i < chunkCount; ++i) {
+        this->drawList.insert(this->drawList.end(), this->chunkDrawLists[i].begin(), this->chunkDrawLists[i].end());
+    }
+    this->frameStats.frustumCulled = frustumCulled;
+    this->frameStats.coverageCulled = coverageCulled;
+    this->frameStats.occlusionCulled = occlusionCulled;
+}
 
-        //uint must correspond to the index buffer data type
-        renderPass.setIndexBuffer(indexBuffer, meshes[i]->getIndexFormat(), 0, indexBuffer.getSize());
+void Application::cullStaticBundles(const Frustum& frustum, bool testOcclusion)
+{
+    //the chunks bake transform slots into their bundles, so they are built again when the slots move
+    if (this->staticBundleSortCount != this->transforms.getSortCount()) {
+        vector<StaticBundles::Item>& items = this->staticBundleItems;
+        items.resize(this->staticItemCount);
+        for (uint32_t i = 0; i < this->staticItemCount; ++i) {
+            const SceneItem& item = this->sceneItems[i];
+            items[i].mesh = item.mesh;
+            items[i].transformSlot = this->transforms.getSlot(item.transformId);
+            items[i].sortKey = DrawSort::makeKey(DrawSort::Opaque, 0, item.materialId, item.geometryId, 0.0f);
+            items[i].bounds = this->sceneItemBounds[i];
+        }
+        this->staticBundles.build(items);
+        this->staticBundleSortCount = this->transforms.getSortCount();
+    }
 
-        renderPass.setBindGroup(0, this->cameraBindGroup, 0, nullptr);
-        renderPass.setBindGroup(1, renderingObject->getModelBindGroup(), 0, nullptr);
-        renderPass.setBindGroup(2, meshes[i]->getTextureBindGroup(), 0, nullptr);
+    const vector<StaticBundles::Chunk>& chunks = this->staticBundles.getChunks();
+    for (uint32_t i = 0; i < (uint32_t)chunks.size(); ++i) {
+        bool visible = !this->frustumCulling || frustum.intersects(chunks[i].sphere);
+        visible = visible && (!testOcclusion || this->occlusionCuller.isVisible(chunks[i].bounds));
+        if (visible) this->visibleBundleChunks.push_back(i);
+        else this->frameStats.bundlesCulled++;
+    }
+}
 
-        renderPass.drawIndexed((uint32_t)meshes[i]->getNumIndices(), 1, 0, 0, 0);
-	}
+void Application::encodeStaticBundles(FilteredRenderPass& renderPass)
+{
+    StaticBundles::Target target;
+    target.pipeline = this->getScenePipeline();
+    target.cameraBindGroup = this->cameraBindGroup;
+    target.transforms = &this->getActiveTransformBuffer();
+    target.colorFormat = this->surfaceFormat;
+    target.depthFormat = this->depthTextureFormat;
+
+    //recording touches GPU objects, so the stale bundles are recorded here and not while building the frame
+    this->staticBundles.resetRecordCount();
+    this->bundleList.clear();
+    for (uint32_t chunk : this->visibleBundleChunks) {
+        RenderBundle bundle = this->staticBundles.prepare(chunk, this->residency, target);
+        if (!bundle) continue;
+        this->bundleList.push_back(bundle);
+        this->frameStats.bundleDraws += this->staticBundles.getChunks()[chunk].itemCount;
+    }
+    this->frameStats.bundlesExecuted = (uint32_t)this->bundleList.size();
+    this->frameStats.bundlesRecorded = this->staticBundles.getRecordCount();
+    if (this->bundleList.empty()) return;
 
-    //now render children
-    vector<SceneObject*> children = renderingObject->getChildren();
-    for (int i = 0; i < children.size(); i++) {
-		renderScene(renderPass, &worldModelMatrix, children[i]);
-	}
+    renderPass.executeBundles((uint32_t)this->bundleList.size(), this->bundleList.data());
+    this->bindScenePipeline(renderPass);
+}
+
+void Application::writeIndirectDraws()
+{
+    //draw i of the buffers is the i-th draw in encoding order, its first instance selects its object index
+    uint32_t drawCount = (uint32_t)this->drawPackets.size();
+    this->indirectArguments.resize(drawCount);
+    this->indirectObjectIndices.resize(drawCount);
+    for (uint32_t i = 0; i < drawCount; ++i) {
+        const DrawItem& draw = this->drawList[this->drawPackets[i].draw];
+        IndirectDraws::Arguments& arguments = this->indirectArguments[i];
+        arguments.indexCount = (uint32_t)draw.mesh->getNumIndices();
+        arguments.instanceCount = 1;
+        arguments.firstIndex = 0;
+        arguments.baseVertex = 0;
+        arguments.firstInstance = i;
+        this->indirectObjectIndices[i] = draw.transformSlot;
+    }
+    this->indirectDraws.upload(this->queue, this->indirectArguments, this->indirectObjectIndices);
+}
+
+void Application::sortDrawList()
+{
+    auto sortStart = std::chrono::high_resolution_clock::now();
+    this->drawPackets.resize(this->drawList.size());
+    for (size_t i = 0; i < this->drawList.size(); ++i) {
+        this->drawPackets[i].key = this->drawList[i].sortKey;
+        this->drawPackets[i].draw = (uint32_t)i;
+    }
+    if (this->drawSorting) {
+        DrawSort::sort(this->drawPackets, this->drawPacketScratch);
+    }
+    auto sortEnd = std::chrono::high_resolution_clock::now();
+    this->frameStats.sortMilliseconds = std::chrono::duration<double, std::milli>(sortEnd - sortStart).count();
+}
+
+void Application::selectOccluders()
+{
+    //the items with the largest world boxes (walls, floors, pillars) until the triangle budget is spent
+    const size_t maxOccluders = 64;
+    const size_t triangleBudget = 100000;
+
+    this->occluderItems.resize(this->sceneItems.size());
+    for (size_t i = 0; i < this->sceneItems.size(); ++i) {
+        this->occluderItems[i] = (uint32_t)i;
+    }
+    std::sort(this->occluderItems.begin(), this->occluderItems.end(), [&](uint32_t a, uint32_t b) {
+        return this->sceneItemBounds[a].getSurfaceArea() > this->sceneItemBounds[b].getSurfaceArea();
+        });
+
+    size_t selected = 0;
+    size_t triangles = 0;
+    for (uint32_t item : this->occluderItems) {
+        if (selected == maxOccluders) break;
+        size_t meshTriangles = this->sceneItems[item].mesh->getNumIndices() / 3;
+        if (triangles + meshTriangles > triangleBudget) continue;
+
+        this->occluderItems[selected++] = item;
+        triangles += meshTriangles;
+    }
+    this->occluderItems.resize(selected);
+}
+
+void Application::rasterizeOccluders()
+{
+    this->frameStats.occluderTriangles = 0;
+    this->frameStats.rasterMilliseconds = 0.0;
+    if (!this->occlusionCulling || this->occluderItems.empty()) return;
+
+    //the occluders are drawn from the CPU copies of their meshes with this frame's matrices
+    this->occlusionCuller.beginFrame(this->cameraUniform.projectionMatrix * this->cameraUniform.viewMatrix);
+    for (uint32_t item : this->occluderItems) {
+        const SceneItem& sceneItem = this->sceneItems[item];
+        Mesh* mesh = sceneItem.mesh;
+        this->occlusionCuller.addOccluder(mesh->getVertices(), mesh->getNumVertices() / 3, mesh->getIndices(),
+            mesh->getIndexFormat() == IndexFormat::Uint32, mesh->getNumIndices(), this->transforms.getWorldMatrix(sceneItem.transformId));
+    }
+    this->occlusionCuller.rasterize(&this->jobs);
+
+    this->frameStats.occluderTriangles = this->occlusionCuller.getStats().triangles;
+    this->frameStats.rasterMilliseconds = this->occlusionCuller.getStats().rasterMilliseconds;
+}
+
+void Application::updateSceneBounds()
+{
+    if (this->sceneBvhDirty) {
+        this->collectSceneItems();
+        this->sceneBvh.build(this->sceneItemBounds.data(), (uint32_t)this->sceneItemBounds.size());
+        this->selectOccluders();
+        this->sceneBvhDirty = false;
+        this->gpuCullItemsDirty = true;
+        return;
+    }
+
+    //a static frame leaves the tree as it is, and static entities are never looked at again
+    if (this->transforms.getComputedCount() == 0 || this->dynamicChunks.empty()) return;
+
+    //split over the flattened dynamic items, not over the entity chunks: a scene whose moving entities
+    //fit in one chunk would otherwise update them all on one thread
+    uint32_t firstDynamicItem = this->dynamicChunks.front().second;
+    size_t dynamicItemCount = this->sceneItems.size() - firstDynamicItem;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(this->jobs.getThreadCount() * 4, dynamicItemCount / TransformStore::ParallelBatch));
+    this->jobs.parallelFor(dynamicItemCount, chunkCount, [&](size_t begin, size_t end, size_t) {
+        uint32_t firstItem = firstDynamicItem + (uint32_t)begin;
+        uint32_t lastItem = firstDynamicItem + (uint32_t)end;
+
+        //the entity chunk holding the first item, the chunks are in item order
+        size_t c = std::upper_bound(this->dynamicChunks.begin(), this->dynamicChunks.end(), firstItem,
+            [](uint32_t item, const pair<EntityStore::Chunk*, uint32_t>& chunk) { return item < chunk.second; }) - this->dynamicChunks.begin() - 1;
+        for (uint32_t i = firstItem; i < lastItem; ++i) {
+            while (c + 1 < this->dynamicChunks.size() && this->dynamicChunks[c + 1].second <= i) c++;
+            const EntityStore::Chunk& chunk = *this->dynamicChunks[c].first;
+            uint32_t row = i - this->dynamicChunks[c].second;
+            uint32_t transformId = chunk.transforms[row].transformId;
+            if (!this->transforms.wasChanged(transformId)) continue;
+
+            const glm::mat4& world = this->transforms.getWorldMatrix(transformId);
+            this->sceneItemBounds[i] = chunk.bounds[row].localBounds.transformed(world);
+            this->sceneItemSpheres.set(i, chunk.bounds[row].localSphere.transformed(world));
+            this->sceneBvh.setItemBounds(i, this->sceneItemBounds[i]);
+        }
+        });
+
+    this->sceneBvh.refit();
+    this->gpuCullItemsDirty = true;
+}
+
+void Application::collectSceneItems()
+{
+    //static entities first, so that the moving ones are one range at the end
+    const uint32_t renderable = EntityStore::Transform | EntityStore::MeshRenderer | EntityStore::Bounds;
+    this->sceneItems.clear();
+    this->sceneItemBounds.clear();
+    this->sceneItemSpheres.resize(0);
+    this->dynamicChunks.clear();
+    //ids in order of first use, only the grouping matters to the sort
+    unordered_map<const void*, uint32_t> materialIds;
+    unordered_map<const void*, uint32_t> geometryIds;
+    auto collect = [&](EntityStore::Chunk& chunk) {
+        if (chunk.components & EntityStore::DynamicTag) {
+            this->dynamicChunks.push_back({ &chunk, (uint32_t)this->sceneItems.size() });
+        }
+        for (uint32_t row = 0; row < chunk.count; ++row) {
+            uint32_t transformId = chunk.transforms[row].transformId;
+            Mesh* mesh = chunk.meshRenderers[row].mesh;
+            uint32_t materialId = materialIds.emplace(mesh->getTexture(), (uint32_t)materialIds.size()).first->second;
+            uint32_t geometryId = geometryIds.emplace(mesh, (uint32_t)geometryIds.size()).first->second;
+            this->sceneItems.push_back({ chunk.entities[row], transformId, mesh, materialId, geometryId });
+            const glm::mat4& world = this->transforms.getWorldMatrix(transformId);
+            this->sceneItemBounds.push_back(chunk.bounds[row].localBounds.transformed(world));
+            this->sceneItemSpheres.add(chunk.bounds[row].localSphere.transformed(world));
+        }
+    };
+    this->entities.forEachChunk(renderable, EntityStore::DynamicTag, collect);
+    this->staticItemCount = (uint32_t)this->sceneItems.size();
+    this->staticBundleSortCount = ~0u;
+    this->gpuFrustumSortCount = ~0u;
+    this->entities.forEachChunk(renderable | EntityStore::DynamicTag, 0, collect);
+}
+
+bool Application::raycast(const Ray& ray, float maxDistance, RaycastHit& hit)
+{
+    //scene level BVH over the object boxes, then the triangle BVH of every mesh the ray gets close to
+    float distance = maxDistance;
+    bool found = this->sceneBvh.raycast(ray, distance, [&](uint32_t item, float& closest) {
+        const SceneItem& sceneItem = this->sceneItems[item];
+
+        MeshHit meshHit;
+        meshHit.distance = closest;
+        glm::mat4 worldToModel = glm::inverse(this->transforms.getWorldMatrix(sceneItem.transformId));
+        if (!sceneItem.mesh->getBVH().raycast(ray, worldToModel, meshHit)) return false;
+
+        closest = meshHit.distance;
+        hit.entity = sceneItem.entity;
+        hit.mesh = sceneItem.mesh;
+        hit.triangle = meshHit.triangle;
+        hit.barycentrics = vec3(1.0f - meshHit.u - meshHit.v, meshHit.u, meshHit.v);
+        return true;
+        });
+
+    if (!found) return false;
+
+    hit.distance = distance;
+    hit.position = ray.origin + ray.direction * distance;
+    return true;
+}
+
+Ray Application::getCursorRay(double cursorX, double cursorY) const
+{
+    //points on the near and far planes under the cursor, the depth range is [0, 1]
+    float x = 2.0f * (float)cursorX / this->windowWidth - 1.0f;
+    float y = 1.0f - 2.0f * (float)cursorY / this->windowHeight;
+    glm::mat4 clipToWorld = glm::inverse(this->cameraUniform.projectionMatrix * this->cameraUniform.viewMatrix);
+
+    glm::vec4 nearPoint = clipToWorld * glm::vec4(x, y, 0.0f, 1.0f);
+    glm::vec4 farPoint = clipToWorld * glm::vec4(x, y, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+
+    return Ray(origin, glm::normalize(target - origin));
+}
+
+bool Application::bindMesh(FilteredRenderPass& renderPass, Mesh* mesh, uint32_t transformSlot)
+{
+    //uploads the mesh again if it was evicted, this touches GPU objects so it stays on this thread
+    if (!this->residency.useMesh(mesh)) return false;
+
+    Buffer vertexBuffer = mesh->getVertexBuffer();
+    Buffer indexBuffer = mesh->getIndexBuffer();
+    Buffer normalBuffer = mesh->getNormalBuffer();
+    Buffer uvBuffer = mesh->getUVBuffer();
+
+    // Set the vertex buffer
+    renderPass.setVertexBuffer(0, vertexBuffer, 0, vertexBuffer.getSize());
+    renderPass.setVertexBuffer(1, normalBuffer, 0, normalBuffer.getSize());
+    renderPass.setVertexBuffer(2, uvBuffer, 0, uvBuffer.getSize());
+
+    //uint must correspond to the index buffer data type
+    renderPass.setIndexBuffer(indexBuffer, mesh->getIndexFormat(), 0, indexBuffer.getSize());
+
+    renderPass.setBindGroup(0, this->cameraBindGroup, 0, nullptr);
+    if (this->transformLayout != TransformBuffer::Layout::StorageTable) {
+        uint32_t modelOffset = this->modelTransforms.getOffset(transformSlot);
+        renderPass.setBindGroup(1, this->modelTransforms.getBindGroup(), 1, &modelOffset);
+    }
+    renderPass.setBindGroup(2, mesh->getTextureBindGroup(), 0, nullptr);
+
+    return true;
+}
+
+void Application::encodeDrawList(FilteredRenderPass& renderPass)
+{
+    bool useTransformTable = this->transformLayout == TransformBuffer::Layout::StorageTable;
+
+    if (this->renderBundles) {
+        this->encodeStaticBundles(renderPass);
+    }
+
+    if (this->parallelRecording) {
+        this->encodeDrawListBundles(renderPass);
+        return;
+    }
+
+    bool indirect = this->usesIndirectDraws();
+    Buffer argumentBuffer = this->indirectDraws.getArgumentBuffer();
+
+    Mesh* previousMesh = nullptr;
+    custom::Texture* previousTexture = nullptr;
+    for (uint32_t i = 0; i < (uint32_t)this->drawPackets.size(); ++i) {
+        const DrawItem& draw = this->drawList[this->drawPackets[i].draw];
+        Mesh* mesh = draw.mesh;
+        if (!this->bindMesh(renderPass, mesh, draw.transformSlot)) continue;
+
+        //what the order of the draws costs, whether or not the calls are filtered
+        if (mesh != previousMesh) this->frameStats.geometryChanges++;
+        if (mesh->getTexture() != previousTexture || previousMesh == nullptr) this->frameStats.materialChanges++;
+        previousMesh = mesh;
+        previousTexture = mesh->getTexture();
+
+        //the indirect draws only differ by their offset, the arguments were written with the draw list
+        if (indirect) {
+            renderPass.drawIndexedIndirect(argumentBuffer, this->indirectDraws.getArgumentOffset(i));
+            this->frameStats.draws++;
+            continue;
+        }
+
+        //with the transform table the first instance is the index of the model matrix
+        uint32_t firstInstance = useTransformTable ? draw.transformSlot : 0;
+        renderPass.drawIndexed((uint32_t)mesh->getNumIndices(), 1, 0, 0, firstInstance);
+        this->frameStats.draws++;
+    }
+}
+
+void Application::encodeDrawListBundles(FilteredRenderPass& renderPass)
+{
+    //residency touches GPU objects and the eviction order, so the meshes are made resident here in
+    //encoding order and the jobs only see draws whose buffers exist
+    this->bundleDraws.clear();
+    Mesh* previousMesh = nullptr;
+    custom::Texture* previousTexture = nullptr;
+    for (uint32_t i = 0; i < (uint32_t)this->drawPackets.size(); ++i) {
+        const DrawItem& draw = this->drawList[this->drawPackets[i].draw];
+        Mesh* mesh = draw.mesh;
+        if (!this->residency.useMesh(mesh)) continue;
+        this->bundleDraws.push_back({ mesh, draw.transformSlot, i });
+
+        if (mesh != previousMesh) this->frameStats.geometryChanges++;
+        if (mesh->getTexture() != previousTexture || previousMesh == nullptr) this->frameStats.materialChanges++;
+        previousMesh = mesh;
+        previousTexture = mesh->getTexture();
+    }
+    this->frameStats.draws += (uint32_t)this->bundleDraws.size();
+
+    ParallelBundles::Target target;
+    target.cameraBindGroup = this->cameraBindGroup;
+    target.transforms = &this->getActiveTransformBuffer();
+    target.colorFormat = this->surfaceFormat;
+    target.depthFormat = this->depthTextureFormat;
+    if (this->usesIndirectDraws()) {
+        target.pipeline = this->indirectPipeline;
+        target.objectBindGroup = this->indirectDraws.getBindGroup(this->modelTransformTable);
+        target.indirectDraws = &this->indirectDraws;
+    }
+    else {
+        target.pipeline = this->getScenePipeline();
+        if (this->transformLayout == TransformBuffer::Layout::StorageTable) {
+            target.objectBindGroup = this->modelTransformTable.getBindGroup();
+        }
+    }
+
+    //the ranges are contiguous and executed in order, so the draw order is the one of drawPackets
+    this->drawListBundles.record(this->bundleDraws, target, this->jobs);
+    const vector<RenderBundle>& bundles = this->drawListBundles.getBundles();
+    this->frameStats.drawListBundles = (uint32_t)bundles.size();
+    if (!bundles.empty()) {
+        renderPass.executeBundles((uint32_t)bundles.size(), bundles.data());
+        this->bindScenePipeline(renderPass);
+    }
+    this->drawListBundles.release();
+}
+
+void Application::encodeCulledDraws(FilteredRenderPass& renderPass, uint32_t phase)
+{
+    //every item is recorded, the cull pass of the phase sets the instance count of the hidden ones to 0
+    //the CPU cannot tell which ones those are, so every mesh stays resident
+    Buffer drawBuffer = this->gpuCuller.getDrawBuffer();
+    uint32_t itemCount = std::min((uint32_t)this->sceneItems.size(), this->gpuCuller.getItemCount());
+
+    for (uint32_t i = 0; i < itemCount; ++i) {
+        const SceneItem& item = this->sceneItems[i];
+        if (!this->bindMesh(renderPass, item.mesh, this->transforms.getSlot(item.transformId))) continue;
+
+        renderPass.drawIndexedIndirect(drawBuffer, this->gpuCuller.getDrawOffset(phase, i));
+        this->frameStats.draws++;
+    }
+}
+
+void Application::encodeGpuFrustumDraws(FilteredRenderPass& renderPass)
+{
+    //one draw per mesh whatever the camera sees, the cull pass sets how many instances each one has
+    //the CPU cannot tell which meshes have none, so every mesh stays resident
+    Buffer argumentBuffer = this->indirectDraws.getArgumentBuffer();
+    uint32_t groupCount = std::min((uint32_t)this->gpuFrustumGroupMeshes.size(), this->gpuFrustumCuller.getGroupCount());
+
+    for (uint32_t group = 0; group < groupCount; ++group) {
+        if (!this->bindMesh(renderPass, this->gpuFrustumGroupMeshes[group], 0)) continue;
+
+        renderPass.drawIndexedIndirect(argumentBuffer, this->indirectDraws.getArgumentOffset(group));
+        this->frameStats.draws++;
+    }
+}
+
+void Application::updateGpuFrustumObjects()
+{
+    if (this->gpuFrustumSortCount == this->transforms.getSortCount()) return;
+
+    //the geometry ids of the scene items are the groups, counted then placed so every group is one range
+    this->gpuFrustumGroupMeshes.clear();
+    this->gpuFrustumGroupIndexCounts.clear();
+    vector<uint32_t>& groupStarts = this->gpuFrustumGroupStarts;
+    groupStarts.clear();
+    for (const SceneItem& item : this->sceneItems) {
+        if (item.geometryId >= this->gpuFrustumGroupMeshes.size()) {
+            this->gpuFrustumGroupMeshes.resize(item.geometryId + 1, nullptr);
+            this->gpuFrustumGroupIndexCounts.resize(item.geometryId + 1, 0);
+            groupStarts.resize(item.geometryId + 1, 0);
+        }
+        this->gpuFrustumGroupMeshes[item.geometryId] = item.mesh;
+        this->gpuFrustumGroupIndexCounts[item.geometryId] = (uint32_t)item.mesh->getNumIndices();
+        groupStarts[item.geometryId]++;
+    }
+    uint32_t first = 0;
+    for (uint32_t& start : groupStarts) {
+        uint32_t count = start;
+        start = first;
+        first += count;
+    }
+
+    this->gpuFrustumObjects.resize(this->sceneItems.size());
+    for (const SceneItem& item : this->sceneItems) {
+        const AABB& localBounds = item.mesh->getLocalBounds();
+        GpuFrustumCuller::Object& object = this->gpuFrustumObjects[groupStarts[item.geometryId]++];
+        object.boundsMin = localBounds.min;
+        object.transformSlot = this->transforms.getSlot(item.transformId);
+        object.boundsMax = localBounds.max;
+        object.group = item.geometryId;
+    }
+
+    this->gpuFrustumCuller.upload(this->queue, this->gpuFrustumObjects, this->gpuFrustumGroupIndexCounts, this->indirectDraws);
+    this->gpuFrustumSortCount = this->transforms.getSortCount();
+}
+
+void Application::updateGpuCullItems()
+{
+    if (!this->gpuCullItemsDirty) return;
+
+    this->gpuCullItems.resize(this->sceneItems.size());
+    for (size_t i = 0; i < this->sceneItems.size(); ++i) {
+        const SceneItem& item = this->sceneItems[i];
+        GpuCuller::Item& cullItem = this->gpuCullItems[i];
+        cullItem.boundsMin = this->sceneItemBounds[i].min;
+        cullItem.boundsMax = this->sceneItemBounds[i].max;
+        cullItem.indexCount = (uint32_t)item.mesh->getNumIndices();
+        cullItem.firstInstance = this->transforms.getSlot(item.transformId);
+    }
+
+    this->gpuCuller.uploadItems(this->queue, this->gpuCullItems);
+    this->gpuCullItemsDirty = false;
+}
+
+bool Application::initJobs()
+{
+    //the main thread works too, so one core is left out of the pool
+    uint32_t cores = std::thread::hardware_concurrency();
+    this->jobs.initialize(cores > 1 ? cores - 1 : 0);
+
+    return true;
+}
+
+void Application::terminateJobs()
+{
+    this->jobs.terminate();
+}
+
+TransformBuffer& Application::getActiveTransformBuffer()
+{
+    return this->transformLayout == TransformBuffer::Layout::StorageTable ? this->modelTransformTable : this->modelTransforms;
 }
 
 TextureView Application::GetNextSurfaceTextureView()
@@ -705,6 +1653,243 @@ TextureView Application::GetNextSurfaceTextureView()
     return targetView;
 }
 
+void Application::onMouseButton(int button, int action)
+{
+    if (action != GLFW_PRESS || button != GLFW_MOUSE_BUTTON_LEFT) return;
+
+    //the pick runs inside the allocation count of the frame that polled the event
+    this->allocationCheckFrame = this->frameNumber + AllocationSettleFrames;
+
+    //pick the object under the cursor
+    double cursorX, cursorY;
+    glfwGetCursorPos(this->window, &cursorX, &cursorY);
+
+    RaycastHit hit;
+    if (!raycast(getCursorRay(cursorX, cursorY), FLT_MAX, hit)) {
+        cout << "Nothing under the cursor" << endl;
+        return;
+    }
+
+    cout << "Picked triangle " << hit.triangle << " of mesh " << hit.mesh << " at distance " << hit.distance
+        << " (" << hit.position.x << ", " << hit.position.y << ", " << hit.position.z << ")" << endl;
+}
+
+void Application::onKey(int key, int action)
+{
+    if (action != GLFW_PRESS) return;
+
+    //a key may toggle a path that has not run yet, its containers grow in the next frames
+    this->allocationCheckFrame = this->frameNumber + AllocationSettleFrames;
+
+    //M dumps the GPU memory report
+    if (key == GLFW_KEY_M) {
+        ResourceTracker::dumpReport("gpu_memory_report.json");
+    }
+
+    //R prints the residency counters
+    if (key == GLFW_KEY_R) {
+        this->residency.printCounters();
+    }
+
+    //F prints the counters of the last frame
+    if (key == GLFW_KEY_F) {
+        printFrameStats();
+    }
+
+    //T switches between the dynamic offset uniform buffer and the storage transform table
+    if (key == GLFW_KEY_T) {
+        if (this->gpuTransformUpdate || this->indirectDrawing || this->gpuFrustumCulling) {
+            cout << "The GPU transform update and the indirect draws read the storage transform table" << endl;
+            return;
+        }
+        bool useTransformTable = this->transformLayout == TransformBuffer::Layout::StorageTable;
+        this->transformLayout = useTransformTable ? TransformBuffer::Layout::DynamicUniform : TransformBuffer::Layout::StorageTable;
+        //the other buffer missed the uploads made while it was not in use
+        this->transforms.invalidate();
+        cout << "Model matrices from " << (useTransformTable ? "dynamic offset uniform buffer" : "storage transform table") << endl;
+    }
+
+    //P moves the world matrices to a compute pass, the CPU then only uploads local transforms and its
+    //own world matrices (bounds, culling, picking) stop following moving nodes until it is switched back
+    if (key == GLFW_KEY_P) {
+        this->gpuTransformUpdate = !this->gpuTransformUpdate;
+        this->transforms.setCpuWorldMatrices(!this->gpuTransformUpdate);
+        this->transforms.invalidate();
+        this->gpuTransforms.reset();
+        if (this->gpuTransformUpdate) {
+            this->transformLayout = TransformBuffer::Layout::StorageTable;
+        }
+        cout << "World matrices computed on the " << (this->gpuTransformUpdate ? "GPU" : "CPU") << endl;
+    }
+
+    //O toggles the CPU occlusion culling
+    if (key == GLFW_KEY_O) {
+        this->occlusionCulling = !this->occlusionCulling;
+        cout << "Occlusion culling " << (this->occlusionCulling ? "on" : "off") << endl;
+    }
+
+    //C toggles the frustum and screen coverage tests of the CPU draw list
+    if (key == GLFW_KEY_C) {
+        this->frustumCulling = !this->frustumCulling;
+        cout << "Frustum culling " << (this->frustumCulling ? "on" : "off") << endl;
+    }
+
+    //S switches between drawing in sort key order and in scene order
+    if (key == GLFW_KEY_S) {
+        this->drawSorting = !this->drawSorting;
+        cout << "Draws encoded in " << (this->drawSorting ? "sort key" : "scene") << " order" << endl;
+    }
+
+    //D turns the redundant state filtering of the scene passes on and off
+    if (key == GLFW_KEY_D) {
+        this->scenePass.setFiltering(!this->scenePass.isFiltering());
+        cout << "Redundant state filtering " << (this->scenePass.isFiltering() ? "on" : "off") << endl;
+    }
+
+    //I draws the draw list with drawIndexedIndirect from the argument and object index buffers
+    if (key == GLFW_KEY_I) {
+        if (!this->gpuCullingSupported) {
+            cout << "Indirect draws need the indirect-first-instance feature" << endl;
+            return;
+        }
+        this->indirectDrawing = !this->indirectDrawing;
+        if (this->indirectDrawing && this->transformLayout != TransformBuffer::Layout::StorageTable) {
+            this->transformLayout = TransformBuffer::Layout::StorageTable;
+            this->transforms.invalidate();
+        }
+        cout << "Draw list drawn " << (this->indirectDrawing ? "indirectly" : "directly") << endl;
+    }
+
+    //E records the draw list into render bundles on the worker threads instead of the scene pass
+    if (key == GLFW_KEY_E) {
+        if (!this->parallelRecordingSupported) {
+            cout << "Parallel recording needs the implicit-device-synchronization feature" << endl;
+            return;
+        }
+        this->parallelRecording = !this->parallelRecording;
+        cout << "Draw list recorded " << (this->parallelRecording ? "into bundles on the worker threads" : "on the main thread") << endl;
+    }
+
+    //B switches the static items between render bundles and the draw list
+    if (key == GLFW_KEY_B) {
+        this->renderBundles = !this->renderBundles;
+        cout << "Static geometry " << (this->renderBundles ? "replayed from render bundles" : "in the draw list") << endl;
+    }
+
+    //G switches between the CPU draw list and two phase occlusion culling on the GPU
+    if (key == GLFW_KEY_G) {
+        if (!this->gpuCullingSupported) {
+            cout << "GPU culling needs the indirect-first-instance feature" << endl;
+            return;
+        }
+        this->gpuCulling = !this->gpuCulling;
+        this->gpuFrustumCulling = false;
+        this->gpuCullItemsDirty = true;
+        cout << "Culling on the " << (this->gpuCulling ? "GPU" : "CPU") << endl;
+    }
+
+    //V moves the frustum culling to a compute pass that compacts the visible objects into one
+    //instanced indirect draw per mesh, without occlusion culling
+    if (key == GLFW_KEY_V) {
+        if (!this->gpuCullingSupported) {
+            cout << "GPU frustum culling needs the indirect-first-instance feature" << endl;
+            return;
+        }
+        this->gpuFrustumCulling = !this->gpuFrustumCulling;
+        this->gpuCulling = false;
+        this->gpuFrustumSortCount = ~0u;
+        if (this->gpuFrustumCulling && this->transformLayout != TransformBuffer::Layout::StorageTable) {
+            this->transformLayout = TransformBuffer::Layout::StorageTable;
+            this->transforms.invalidate();
+        }
+        cout << "Frustum culling on the " << (this->gpuFrustumCulling ? "GPU" : "CPU") << endl;
+    }
+}
+
+void Application::printFrameStats()
+{
+    cout << "Frame stats:" << endl;
+    cout << "  world matrices computed: " << this->frameStats.matricesComputed << (this->gpuTransformUpdate ? " on the GPU" : "") << endl;
+    cout << "  model uniform writes: " << this->frameStats.modelUniformWrites << endl;
+    cout << "  draws: " << this->frameStats.draws << (this->usesIndirectDraws() ? " indirect" : "") << endl;
+    if (this->timestampsSupported) {
+        cout << "  frame on the GPU: " << this->frameStats.gpuMilliseconds << " ms (a few frames old)" << endl;
+    }
+    cout << "  frame slot wait: " << this->frameStats.frameWaitMilliseconds << " ms with " << this->frameRing.getFrameCount() << " frames in flight" << endl;
+    cout << "  frame uploads: " << this->frameStats.frameUploadBytes << " bytes through the slot";
+    if (this->frameStats.frameOverflowBytes > 0) {
+        cout << ", " << this->frameStats.frameOverflowBytes << " bytes written directly";
+    }
+    cout << endl;
+    cout << "  frame building: " << this->frameStats.buildMilliseconds << " ms on " << this->jobs.getThreadCount() << " threads" << endl;
+    if (AllocationCounter::isEnabled()) {
+        cout << "  frame building allocations: " << this->frameStats.buildAllocations << endl;
+        cout << "  frame allocations: " << this->frameStats.frameAllocations << " up to the submit" << endl;
+    }
+    cout << "  draw encoding: " << this->frameStats.encodeMilliseconds << " ms";
+    if (this->frameStats.draws > 0) {
+        cout << " (" << this->frameStats.encodeMilliseconds * 10000.0 / this->frameStats.draws << " ms per 10k draws)";
+    }
+    cout << endl;
+    if (this->usesCpuDrawList() && this->parallelRecording) {
+        cout << "  draw list bundles: " << this->frameStats.drawListBundles << " recorded in parallel" << endl;
+    }
+    cout << "  state calls: " << this->frameStats.stateCallsIssued << " issued, " << this->frameStats.stateCallsElided << " elided"
+        << (this->scenePass.isFiltering() ? "" : " (filtering off)") << endl;
+    if (this->usesCpuDrawList() && this->renderBundles) {
+        cout << "  render bundles: " << this->frameStats.bundlesExecuted << " executed (" << this->frameStats.bundleDraws << " draws), "
+            << this->frameStats.bundlesCulled << " culled, " << this->frameStats.bundlesRecorded << " recorded" << endl;
+    }
+    if (this->usesCpuDrawList()) {
+        cout << "  draw sorting: " << this->frameStats.sortMilliseconds << " ms" << (this->drawSorting ? "" : " (scene order)") << ", "
+            << this->frameStats.materialChanges << " material changes, " << this->frameStats.geometryChanges << " geometry changes" << endl;
+    }
+    if (this->gpuCulling) {
+        cout << "  GPU culling (a few frames old): " << this->frameStats.gpuDrawnFirstPhase << " drawn in the first phase, "
+            << this->frameStats.gpuDrawnSecondPhase << " in the second, " << this->frameStats.gpuCulled << " culled" << endl;
+    }
+    else if (this->gpuFrustumCulling) {
+        cout << "  GPU frustum culling (a few frames old): " << this->frameStats.gpuFrustumVisible << " of " << this->gpuFrustumCuller.getObjectCount()
+            << " objects visible in " << this->gpuFrustumCuller.getGroupCount() << " instanced draws" << endl;
+    }
+    else {
+        if (this->frustumCulling) {
+            cout << "  frustum culled: " << this->frameStats.frustumCulled << " draws, too small on screen: " << this->frameStats.coverageCulled << " draws" << endl;
+        }
+        if (this->occlusionCulling) {
+            cout << "  occlusion culled: " << this->frameStats.occlusionCulled << " draws" << endl;
+            cout << "  occluder rasterization: " << this->frameStats.rasterMilliseconds << " ms for " << this->frameStats.occluderTriangles << " triangles" << endl;
+        }
+    }
+}
+
+void Application::checkFrameAllocations()
+{
+    //a frame with the camera, the transform slots and the resident set of the previous one and no
+    //input records the same commands, every container already has the capacity it needs
+    const ResidencyManager::Counters& residencyCounters = this->residency.getFrameCounters();
+    bool changed = this->cameraUniform.viewMatrix != this->allocationCheckView
+        || this->transforms.getSortCount() != this->allocationCheckSortCount
+        || residencyCounters.misses > 0 || residencyCounters.evictions > 0 || residencyCounters.failures > 0;
+    this->allocationCheckView = this->cameraUniform.viewMatrix;
+    this->allocationCheckSortCount = this->transforms.getSortCount();
+    if (changed) {
+        this->allocationCheckFrame = this->frameNumber + AllocationSettleFrames;
+    }
+
+#ifdef TRACK_ALLOCATIONS
+    if (this->frameNumber < this->allocationCheckFrame) return;
+
+#if defined(WEBGPU_BACKEND_DAWN)
+    //Dawn is linked into the executable and records the commands with the same operator new, so
+    //only the frame building is free of it; wgpu-native and the browser allocate on their own heap
+    assert(this->frameStats.buildAllocations == 0 && "a steady frame allocated while building");
+#else
+    assert(this->frameStats.frameAllocations == 0 && "a steady frame allocated before the submit");
+#endif
+#endif // TRACK_ALLOCATIONS
+}
+
 RequiredLimits Application::GetRequiredLimits(Adapter adapter)
 {
     //first get the adapter supported limits
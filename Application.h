@@ -1,4 +1,6 @@
+#include <chrono>
 #include <iostream>
+#include <unordered_map>
 #include <vector>
 
 #include <webgpu/webgpu.hpp>
@@ -13,6 +15,29 @@
 #include "SceneObject.h"
 #include "Model.h"
 #include "Mesh.h"
+#include "ResourceTracker.h"
+#include "ResidencyManager.h"
+#include "Texture.h"
+#include "TransformStore.h"
+#include "TransformBuffer.h"
+#include "JobSystem.h"
+#include "AllocationCounter.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "CullingKernels.h"
+#include "GpuCuller.h"
+#include "GpuTransforms.h"
+#include "ObjectPool.h"
+#include "EntityStore.h"
+#include "DrawSort.h"
+#include "FilteredRenderPass.h"
+#include "StaticBundles.h"
+#include "IndirectDraws.h"
+#include "GpuFrustumCuller.h"
+#include "ParallelBundles.h"
+#include "FrameRing.h"
+#include "GpuTimer.h"
+#include "BenchmarkRun.h"
 
 #ifdef __EMSCRIPTEN__
 #  include <emscripten.h>
@@ -29,12 +54,76 @@ struct CameraUniform {
 
 static_assert(sizeof(CameraUniform) % 16 == 0, "MyUniforms size must be a multiple of 16 bytes");
 
+// Per frame counters, printed with the F key
+struct FrameStats {
+    uint32_t matricesComputed = 0;	//world matrices recomputed by the transform store
+    uint32_t modelUniformWrites = 0;	//model matrix uploads
+    uint32_t draws = 0;
+    double gpuMilliseconds = -1.0;	//uploads, compute and scene passes of the last frame whose timestamps were read back, -1 without timestamps
+    double frameWaitMilliseconds = 0.0;	//CPU time spent waiting for the GPU to release the frame's upload slot
+    uint64_t frameUploadBytes = 0;	//camera and model matrices copied through the upload slot
+    uint64_t frameOverflowBytes = 0;	//written directly because they did not fit in the slot
+    double buildMilliseconds = 0.0;	//CPU time spent on transforms and the draw list
+    uint64_t buildAllocations = 0;	//heap allocations while building the frame, 0 in steady state (needs TRACK_ALLOCATIONS)
+    uint64_t frameAllocations = 0;	//heap allocations from the start of the frame to the submit, the build included
+    double encodeMilliseconds = 0.0;	//CPU time spent recording the scene draws
+    double sortMilliseconds = 0.0;	//CPU time spent sorting the draw list, part of frame building
+    uint32_t materialChanges = 0;	//texture changes between consecutive draws
+    uint32_t geometryChanges = 0;	//vertex and index buffer changes between consecutive draws
+    uint32_t stateCallsIssued = 0;	//pipeline, bind group, vertex and index buffer calls recorded in the scene passes
+    uint32_t stateCallsElided = 0;	//the same calls dropped because they would not change anything
+    uint32_t bundlesExecuted = 0;	//static chunks replayed from their render bundles
+    uint32_t bundleDraws = 0;	//draws inside the executed bundles, not part of draws
+    uint32_t bundlesCulled = 0;	//static chunks outside the frustum or behind the occluders
+    uint32_t bundlesRecorded = 0;	//bundles recorded this frame because they were missing or stale
+    uint32_t drawListBundles = 0;	//bundles the draw list was recorded into on the worker threads, 0 when encoded directly
+    uint32_t frustumCulled = 0;	//draws outside the camera frustum
+    uint32_t coverageCulled = 0;	//draws inside the frustum but smaller than minCoveragePixels on screen
+    uint32_t occlusionCulled = 0;	//draws skipped because the occluders hide their bounds
+    uint32_t occluderTriangles = 0;	//triangles drawn into the CPU depth buffer
+    double rasterMilliseconds = 0.0;	//CPU time spent drawing the occluders, part of frame building
+    uint32_t gpuDrawnFirstPhase = 0;	//GPU culling counters, read back asynchronously
+    uint32_t gpuDrawnSecondPhase = 0;
+    uint32_t gpuCulled = 0;
+    uint32_t gpuFrustumVisible = 0;	//objects the GPU frustum culling kept, read back asynchronously
+};
+
+// One mesh to draw with the model matrix in the given transform slot
+struct DrawItem {
+    Mesh* mesh = nullptr;
+    uint32_t transformSlot = 0;
+    uint64_t sortKey = 0;	//see DrawSort
+};
+
+// One mesh renderer entity, the items of the scene BVH
+struct SceneItem {
+    uint32_t entity = EntityStore::InvalidEntity;
+    uint32_t transformId = TransformStore::InvalidIndex;
+    Mesh* mesh = nullptr;
+    uint32_t materialId = 0;	//small ids of the texture and the mesh for the draw sort keys
+    uint32_t geometryId = 0;
+};
+
+// Closest triangle under a ray
+struct RaycastHit {
+    uint32_t entity = EntityStore::InvalidEntity;
+    Mesh* mesh = nullptr;
+    uint32_t triangle = 0;
+    vec3 barycentrics = vec3(0.0f);	//weights of the three vertices of the triangle
+    vec3 position = vec3(0.0f);	//world space
+    float distance = FLT_MAX;
+};
+
 class Application {
 public:
     bool Initialize(uint16 windowWidth, uint16 windowHeight);	// Initialize the application and return true if successful
     void Terminate();	// Terminate the application
     void MainLoop();	// Run the main loop
     bool IsRunning();	// Return true if the application is running
+    void setBenchmark(const BenchmarkRun::Config& config);	// Before Initialize, the application then stops after the measured frames
+
+    bool raycast(const Ray& ray, float maxDistance, RaycastHit& hit);	// Closest triangle of the scene along the ray, on the CPU
+    Ray getCursorRay(double cursorX, double cursorY) const;	// World space ray through a window position
 
 private:
     void wgpuPollEvents(bool yieldToWebBrowser);	// Poll events
@@ -47,6 +136,9 @@ private:
     bool initDepthBuffer();
     void terminateDepthBuffer();
 
+    bool initGpuCulling();
+    void terminateGpuCulling();
+
     bool initRenderPipeline();
     void terminateRenderPipeline();
 
@@ -62,7 +154,43 @@ private:
     bool initUniforms();
     void terminateUniforms();
 
-    void renderScene(RenderPassEncoder renderPass, mat4* parentModelMatrix, SceneObject* renderingObject);
+    void buildDrawList();	// Collect the draws of the scene items that pass the frustum, coverage and occlusion tests, in parallel
+    void sortDrawList();	// Encoding order of the draw list, by sort key or in scene order
+    void selectOccluders();	// Pick the scene items drawn into the occlusion buffer, after a BVH rebuild
+    void rasterizeOccluders();
+    void beginScenePass(CommandEncoder encoder, TextureView targetView, LoadOp loadOp, bool lastPass);	// Clear or continue the frame in scenePass, with the pipeline set; the last pass ends the frame's GPU time
+    PresentMode getPresentMode(Adapter adapter);	// The one of the benchmark if the surface supports it, Fifo otherwise
+    void finishBenchmark();	// Waits for the last GPU times and writes the results
+    void bindScenePipeline(FilteredRenderPass& renderPass);	// The pipeline of the transform layout and its pass wide bind groups
+    RenderPipeline getScenePipeline() const;
+    bool usesIndirectDraws() const { return (indirectDrawing || gpuFrustumCulling) && !gpuCulling; }	// The scene is drawn from indirectDraws
+    bool usesCpuDrawList() const { return !gpuCulling && !gpuFrustumCulling; }	// Otherwise compute passes decide what is drawn
+    void writeIndirectDraws();	// Arguments and object indices of the draw list in encoding order
+    void updateGpuFrustumObjects();	// Objects of the GPU frustum culling grouped by mesh, after the scene or the transform slots changed
+    void encodeGpuFrustumDraws(FilteredRenderPass& renderPass);	// One instanced indirect draw per mesh
+    void cullStaticBundles(const Frustum& frustum, bool testOcclusion);	// Chunks of static items to replay, rebuilt first if the static items changed
+    void encodeStaticBundles(FilteredRenderPass& renderPass);
+    bool bindMesh(FilteredRenderPass& renderPass, Mesh* mesh, uint32_t transformSlot);	// False when the mesh could not be made resident
+    void encodeDrawList(FilteredRenderPass& renderPass);
+    void encodeDrawListBundles(FilteredRenderPass& renderPass);	// The draw list recorded into bundles by the worker threads
+    void encodeCulledDraws(FilteredRenderPass& renderPass, uint32_t phase);	// Indirect draws of every scene item for a GPU culling phase
+    void updateGpuCullItems();
+
+    void updateSceneBounds();	// Refit the scene BVH to the moved objects, or rebuild it after the scene changed
+    void collectSceneItems();	// Scene items and their world bounds from the entity store, static entities first
+    TransformBuffer& getActiveTransformBuffer();
+
+    bool initResidency();
+    void terminateResidency();
+    void registerResidency(SceneObject* sceneObject);
+
+    bool initJobs();
+    void terminateJobs();
+
+    void onKey(int key, int action);	// Handle keyboard input
+    void onMouseButton(int button, int action);	// Handle mouse input
+    void printFrameStats();
+    void checkFrameAllocations();	// After a few frames in which nothing changed, a frame must not allocate (asserted with TRACK_ALLOCATIONS)
 
 private:
     std::unique_ptr<wgpu::ErrorCallback> onDeviceError = nullptr;
@@ -89,17 +217,122 @@ private:
     BindGroupLayout modelMatrixBindGroupLayout = nullptr;
     BindGroupLayout textureBindGroupLayout = nullptr;
 
+    //transform table pipeline variables (model matrices fetched from a storage buffer by instance index)
+    RenderPipeline transformTablePipeline = nullptr;
+    ShaderModule transformTableShaderModule = nullptr;
+    BindGroupLayout modelTableBindGroupLayout = nullptr;
+
+    //indirect pipeline variables (the transform slot of each indirect draw comes from an object index buffer)
+    RenderPipeline indirectPipeline = nullptr;
+    ShaderModule indirectShaderModule = nullptr;
+    BindGroupLayout indirectObjectsBindGroupLayout = nullptr;
+
     //texture variables
     Sampler sampler = nullptr;
-    Texture imageTexture = nullptr;
-    TextureView imageTextureView = nullptr;
+    custom::Texture* imageTexture = nullptr;
 
     SceneObject* scene = nullptr;
+    TransformStore transforms;	//transforms of every scene object, the scene objects are handles into it
+    ObjectPool<SceneObject> sceneObjects;	//every node of the scene, released together with the transforms
+    ObjectPool<Mesh> meshes;
+    SceneLists sceneLists;	//child and mesh lists of the scene objects
+    EntityStore entities;	//renderable components of the scene, filled by the loader
+
+    //statistics of the last frame
+    FrameStats frameStats;
+
+    //frame building variables
+    JobSystem jobs;	//worker threads for the transform update and the draw list
+    vector<DrawItem> drawList;	//draws of the current frame in scene order
+    vector<vector<DrawItem>> chunkDrawLists;	//one list per job, merged into drawList
+    vector<DrawSort::Packet> drawPackets;	//indices into drawList in encoding order
+    vector<DrawSort::Packet> drawPacketScratch;
+    bool drawSorting = true;	//encode by sort key instead of in scene order
+    FilteredRenderPass scenePass;	//the scene draws are recorded through it to drop redundant state calls
+
+    //static bundle variables, the static scene items are replayed from render bundles instead of the draw list
+    StaticBundles staticBundles;
+    vector<uint32_t> visibleBundleChunks;	//chunks of staticBundles that pass the frustum and occlusion tests
+    vector<RenderBundle> bundleList;	//bundles executed this frame
+    uint32_t staticItemCount = 0;	//the static scene items are the first ones
+    uint32_t staticBundleSortCount = ~0u;	//transform store sort the chunks were built after, the slots move when it sorts
+    vector<StaticBundles::Item> staticBundleItems;	//input of the chunk build, kept for the capacity
+    bool renderBundles = true;
+
+    //parallel recording variables, the draw list is recorded into one render bundle per thread
+    ParallelBundles drawListBundles;
+    vector<ParallelBundles::Draw> bundleDraws;	//resident draws in encoding order
+    bool parallelRecording = false;
+    bool parallelRecordingSupported = false;	//the device can be used from several threads
+
+    //spatial variables
+    vector<SceneItem> sceneItems;
+    vector<pair<EntityStore::Chunk*, uint32_t>> dynamicChunks;	//chunks of moving entities and the scene item of their first row
+    vector<AABB> sceneItemBounds;	//world space, indexed like sceneItems
+    SphereArrays sceneItemSpheres;	//world space, indexed like sceneItems
+    SceneBVH sceneBvh;
+    bool sceneBvhDirty = true;	//entities were added or removed, the BVH has to be rebuilt
+
+    //frustum culling variables
+    vector<CullingKernels::Result> cullResults;	//indexed like sceneItems
+    bool frustumCulling = true;
+    float minCoveragePixels = 1.0f;	//items with a smaller projected radius are skipped
+
+    //occlusion culling variables
+    OcclusionCuller occlusionCuller;
+    vector<uint32_t> occluderItems;	//indices into sceneItems
+    bool occlusionCulling = true;
+
+    //GPU culling variables
+    GpuCuller gpuCuller;
+    vector<GpuCuller::Item> gpuCullItems;	//indexed like sceneItems
+    bool gpuCulling = false;
+    bool gpuCullingSupported = false;
+    bool gpuCullItemsDirty = true;	//bounds or transform slots changed since the last upload
+
+    //GPU frustum culling variables, compacted into the indirect draws
+    GpuFrustumCuller gpuFrustumCuller;
+    vector<GpuFrustumCuller::Object> gpuFrustumObjects;
+    vector<uint32_t> gpuFrustumGroupIndexCounts;
+    vector<Mesh*> gpuFrustumGroupMeshes;	//mesh of every group, which is the geometry id of its scene items
+    vector<uint32_t> gpuFrustumGroupStarts;	//first object of every group while the objects are placed
+    uint32_t gpuFrustumSortCount = ~0u;	//transform store sort the objects were uploaded after, ~0u after the scene changed
+    bool gpuFrustumCulling = false;
+
+    //benchmark variables
+    BenchmarkRun benchmark;
+    bool benchmarkMode = false;
+    GpuTimer gpuTimer;	//GPU time of the frame
+    bool timestampsSupported = false;
+    uint32_t frameNumber = 0;	//frames submitted so far, the warm-up of a benchmark included
+    double lastGpuMilliseconds = -1.0;
+
+    //allocation check variables, the frame number is pushed back by every change
+    static constexpr uint32_t AllocationSettleFrames = 8;	//unchanged frames before the check applies, the frames in flight included
+    uint32_t allocationCheckFrame = 0;	//first frame that must not allocate
+    mat4x4 allocationCheckView = mat4x4(0.0f);	//camera of the previous frame
+    uint32_t allocationCheckSortCount = ~0u;	//transform store sort of the previous frame
+
+    //residency variables
+    ResidencyManager residency;
+    uint64_t residencyBudget = 1024ull * 1024ull * 1024ull;	//VRAM budget for meshes and textures in bytes
 
     //uniforms variables
     CameraUniform cameraUniform;
     Buffer cameraUniformBuffer = nullptr;
     uint32_t cameraUniformStride = 0;
+    FrameRing frameRing;	//per frame upload slots, the CPU records at most frameCount frames ahead of the GPU
+    uint32_t framesInFlight = FrameRing::DefaultFrameCount;
+    uint64_t frameUploadSize = 8ull * 1024ull * 1024ull;	//bytes per slot, larger uploads are written directly
+    TransformBuffer modelTransforms;	//every model matrix in one dynamic offset uniform buffer
+    TransformBuffer modelTransformTable;	//every model matrix in one storage buffer
+    TransformBuffer::Layout transformLayout = TransformBuffer::Layout::DynamicUniform;	//which of the two is used to draw
+    GpuTransforms gpuTransforms;	//writes the transform table from local transforms in a compute pass
+    bool gpuTransformUpdate = false;
+    IndirectDraws indirectDraws;	//draw arguments and object indices of the draw list
+    vector<IndirectDraws::Arguments> indirectArguments;
+    vector<uint32_t> indirectObjectIndices;
+    bool indirectDrawing = false;
 
     //binding group variables
     BindGroup bindGroup = nullptr;
@@ -0,0 +1,260 @@
+#include "BenchmarkRun.h"
+#include "json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static bool readVec3(const nlohmann::json& value, glm::vec3& v)
+{
+	if (!value.is_array() || value.size() != 3) return false;
+	for (size_t i = 0; i < 3; ++i) {
+		if (!value[i].is_number()) return false;
+		v[(glm::length_t)i] = value[i].get<float>();
+	}
+	return true;
+}
+
+bool BenchmarkRun::parseConfig(const std::string& text, Config& config, std::string& error)
+{
+	nlohmann::json json = nlohmann::json::parse(text, nullptr, false);
+	if (json.is_discarded() || !json.is_object()) {
+		error = "not a JSON object";
+		return false;
+	}
+
+	config = Config();
+	if (json.contains("model")) {
+		if (!json["model"].is_string()) {
+			error = "model must be a path";
+			return false;
+		}
+		config.model = json["model"].get<std::string>();
+	}
+	if (json.contains("output")) {
+		if (!json["output"].is_string()) {
+			error = "output must be a path";
+			return false;
+		}
+		config.output = json["output"].get<std::string>();
+	}
+
+	if (json.contains("presentMode")) {
+		std::string mode = json["presentMode"].is_string() ? json["presentMode"].get<std::string>() : "";
+		if (mode == "fifo") config.presentMode = PresentMode::Fifo;
+		else if (mode == "immediate") config.presentMode = PresentMode::Immediate;
+		else if (mode == "mailbox") config.presentMode = PresentMode::Mailbox;
+		else {
+			error = "presentMode must be fifo, immediate or mailbox";
+			return false;
+		}
+	}
+
+	auto readCount = [&](const char* key, uint32_t& count) {
+		if (!json.contains(key)) return true;
+		if (!json[key].is_number_unsigned()) {
+			error = std::string(key) + " must be a frame count";
+			return false;
+		}
+		count = json[key].get<uint32_t>();
+		return true;
+	};
+	if (!readCount("warmupFrames", config.warmupFrames) || !readCount("frames", config.frames)) return false;
+	if (config.frames == 0) {
+		error = "frames must not be 0";
+		return false;
+	}
+
+	if (json.contains("camera")) {
+		if (!json["camera"].is_array()) {
+			error = "camera must be an array of keyframes";
+			return false;
+		}
+		for (const nlohmann::json& value : json["camera"]) {
+			Keyframe keyframe;
+			if (!value.is_object() || !value.contains("time") || !value["time"].is_number()
+				|| !value.contains("position") || !readVec3(value["position"], keyframe.position)
+				|| !value.contains("target") || !readVec3(value["target"], keyframe.target)) {
+				error = "a camera keyframe needs a time, a position and a target";
+				return false;
+			}
+			keyframe.time = value["time"].get<float>();
+			config.camera.push_back(keyframe);
+		}
+		std::stable_sort(config.camera.begin(), config.camera.end(), [](const Keyframe& a, const Keyframe& b) { return a.time < b.time; });
+	}
+
+	return true;
+}
+
+bool BenchmarkRun::loadConfig(const fs::path& path, Config& config)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		std::cout << "Failed to open the benchmark config " << path.string() << std::endl;
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+
+	std::string error;
+	if (!parseConfig(text.str(), config, error)) {
+		std::cout << "Invalid benchmark config " << path.string() << ": " << error << std::endl;
+		return false;
+	}
+	return true;
+}
+
+const char* BenchmarkRun::getPresentModeName(PresentMode mode)
+{
+	switch (mode) {
+	case PresentMode::Fifo: return "fifo";
+	case PresentMode::Immediate: return "immediate";
+	case PresentMode::Mailbox: return "mailbox";
+	}
+	return "unknown";
+}
+
+BenchmarkRun::Keyframe BenchmarkRun::sampleCamera(const std::vector<Keyframe>& camera, float t)
+{
+	if (camera.empty()) return Keyframe();
+	if (camera.size() == 1) return camera.front();
+
+	//t covers the whole path, the keyframe times only place the keyframes on it
+	float time = camera.front().time + glm::clamp(t, 0.0f, 1.0f) * (camera.back().time - camera.front().time);
+	size_t next = 1;
+	while (next < camera.size() - 1 && camera[next].time < time) next++;
+
+	const Keyframe& a = camera[next - 1];
+	const Keyframe& b = camera[next];
+	float span = b.time - a.time;
+	float s = span > 0.0f ? glm::clamp((time - a.time) / span, 0.0f, 1.0f) : 1.0f;
+
+	Keyframe sample;
+	sample.time = time;
+	sample.position = glm::mix(a.position, b.position, s);
+	sample.target = glm::mix(a.target, b.target, s);
+	return sample;
+}
+
+double BenchmarkRun::percentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty()) return 0.0;
+
+	//the smallest value with at least p percent of the values at or below it
+	size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+	return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+BenchmarkRun::Summary BenchmarkRun::summarize(std::vector<double> values)
+{
+	values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return v < 0.0; }), values.end());
+
+	Summary summary;
+	if (values.empty()) return summary;
+
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (double v : values) sum += v;
+
+	summary.count = (uint32_t)values.size();
+	summary.mean = sum / values.size();
+	summary.min = values.front();
+	summary.max = values.back();
+	summary.p50 = percentile(values, 50.0);
+	summary.p95 = percentile(values, 95.0);
+	summary.p99 = percentile(values, 99.0);
+	return summary;
+}
+
+void BenchmarkRun::begin(const Config& config)
+{
+	this->config = config;
+	this->frame = 0;
+	this->cpuMilliseconds.assign(config.frames, -1.0);
+	this->gpuMilliseconds.assign(config.frames, -1.0);
+}
+
+BenchmarkRun::Keyframe BenchmarkRun::getCamera() const
+{
+	//the warm-up stays on the first keyframe, the measured frames spread evenly over the path
+	if (!isMeasuring() || this->config.frames < 2) return sampleCamera(this->config.camera, 0.0f);
+	uint32_t measured = std::min(this->frame - this->config.warmupFrames, this->config.frames - 1);
+	return sampleCamera(this->config.camera, (float)measured / (this->config.frames - 1));
+}
+
+void BenchmarkRun::recordCpuTime(double milliseconds)
+{
+	if (isFinished()) return;
+	if (isMeasuring()) {
+		this->cpuMilliseconds[this->frame - this->config.warmupFrames] = milliseconds;
+	}
+	this->frame++;
+}
+
+void BenchmarkRun::recordGpuTime(uint32_t frame, double milliseconds)
+{
+	if (frame < this->config.warmupFrames || frame >= this->config.warmupFrames + this->config.frames) return;
+	this->gpuMilliseconds[frame - this->config.warmupFrames] = milliseconds;
+}
+
+BenchmarkRun::Summary BenchmarkRun::getCpuSummary() const
+{
+	return summarize(this->cpuMilliseconds);
+}
+
+BenchmarkRun::Summary BenchmarkRun::getGpuSummary() const
+{
+	return summarize(this->gpuMilliseconds);
+}
+
+static nlohmann::json toJson(const BenchmarkRun::Summary& summary)
+{
+	return {
+		{ "count", summary.count },
+		{ "mean", summary.mean },
+		{ "min", summary.min },
+		{ "max", summary.max },
+		{ "p50", summary.p50 },
+		{ "p95", summary.p95 },
+		{ "p99", summary.p99 },
+	};
+}
+
+bool BenchmarkRun::writeResults() const
+{
+	fs::path csvPath = this->config.output + ".csv";
+	fs::path jsonPath = this->config.output + ".json";
+
+	//an empty GPU column means the timestamps were not available or not read back in time
+	std::ofstream csv(csvPath);
+	if (!csv.is_open()) {
+		std::cout << "Failed to write the benchmark frames to " << csvPath.string() << std::endl;
+		return false;
+	}
+	csv << "frame,cpu_ms,gpu_ms\n";
+	for (size_t i = 0; i < this->cpuMilliseconds.size(); ++i) {
+		csv << i << "," << this->cpuMilliseconds[i] << ",";
+		if (this->gpuMilliseconds[i] >= 0.0) csv << this->gpuMilliseconds[i];
+		csv << "\n";
+	}
+
+	nlohmann::json report;
+	report["model"] = this->config.model;
+	report["presentMode"] = getPresentModeName(this->config.presentMode);
+	report["warmupFrames"] = this->config.warmupFrames;
+	report["frames"] = this->config.frames;
+	report["cpuMilliseconds"] = toJson(getCpuSummary());
+	report["gpuMilliseconds"] = toJson(getGpuSummary());
+	std::string text = report.dump(4);
+	std::cout << "Benchmark results:\n" << text << std::endl;
+
+	std::ofstream json(jsonPath);
+	if (!json.is_open()) {
+		std::cout << "Failed to write the benchmark summary to " << jsonPath.string() << std::endl;
+		return false;
+	}
+	json << text << "\n";
+	return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace fs = std::filesystem;
+
+//a reproducible frame time measurement: a JSON config picks the model, the present mode and a
+//keyframed camera path, the path is sampled by frame index and not by wall clock so every run
+//renders the same frames, and the CPU and GPU time of every measured frame is written to a CSV
+//file and a JSON summary with percentiles
+//
+//{
+//	"model": "path/to/scene.gltf",
+//	"presentMode": "immediate",	//fifo, immediate or mailbox
+//	"warmupFrames": 120,	//rendered at the first keyframe and not measured
+//	"frames": 1000,	//measured, the camera path is spread over them
+//	"output": "benchmark",	//writes benchmark.csv and benchmark.json
+//	"camera": [ { "time": 0.0, "position": [0, 0, -50], "target": [0, 0, 0] }, ... ]
+//}
+class BenchmarkRun
+{
+public:
+	enum class PresentMode {
+		Fifo,
+		Immediate,
+		Mailbox,
+	};
+
+	struct Keyframe {
+		float time = 0.0f;	//any unit, only the ratios between keyframes matter
+		glm::vec3 position = glm::vec3(0.0f, 0.0f, -50.0f);
+		glm::vec3 target = glm::vec3(0.0f);
+	};
+
+	struct Config {
+		std::string model;
+		PresentMode presentMode = PresentMode::Immediate;
+		uint32_t warmupFrames = 60;
+		uint32_t frames = 600;
+		std::string output = "benchmark";
+		std::vector<Keyframe> camera;	//sorted by time, empty keeps the default camera
+	};
+
+	// Distribution of one time series
+	struct Summary {
+		uint32_t count = 0;
+		double mean = 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+	};
+
+	static bool parseConfig(const std::string& text, Config& config, std::string& error);	// False with a message when the JSON is not a valid config
+	static bool loadConfig(const fs::path& path, Config& config);	// Prints what went wrong
+	static const char* getPresentModeName(PresentMode mode);
+
+	static Keyframe sampleCamera(const std::vector<Keyframe>& camera, float t);	// Position and target at t in [0, 1] of the path
+	static double percentile(const std::vector<double>& sorted, double p);	// Nearest rank, p in [0, 100]
+	static Summary summarize(std::vector<double> values);	// Negative values (not measured) are skipped
+
+	void begin(const Config& config);
+	const Config& getConfig() const { return config; }
+
+	uint32_t getFrame() const { return frame; }	// Frames rendered so far, warm-up included
+	bool isMeasuring() const { return frame >= config.warmupFrames; }
+	bool isFinished() const { return frame >= config.warmupFrames + config.frames; }
+	Keyframe getCamera() const;	// Of the current frame
+
+	void recordCpuTime(double milliseconds);	// Ends the current frame
+	void recordGpuTime(uint32_t frame, double milliseconds);	// Arrives a few frames late, for the frame getFrame() returned then
+
+	Summary getCpuSummary() const;
+	Summary getGpuSummary() const;
+	bool writeResults() const;	// CSV of every measured frame and JSON summary, named after the config output
+
+private:
+	Config config;
+	uint32_t frame = 0;
+	std::vector<double> cpuMilliseconds;	//per measured frame
+	std::vector<double> gpuMilliseconds;	//per measured frame, -1 until the timestamps were read back
+};
@@ -0,0 +1,1449 @@
+// CPU side benchmarks of the scene systems, they do not need a GPU or a window.
+// Usage: Benchmarks [benchmark name...] (runs everything when no name is given)
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include "AllocationCounter.h"
+#include "BenchmarkRun.h"
+#include "CullingKernels.h"
+#include "DrawSort.h"
+#include "EntityStore.h"
+#include "JobSystem.h"
+#include "MeshBVH.h"
+#include "ObjectPool.h"
+#include "OcclusionCuller.h"
+#include "SceneBVH.h"
+#include "SceneObject.h"
+#include "TransformKernels.h"
+#include "TransformStore.h"
+
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif // __linux__
+
+using namespace std;
+
+// Set by benchmarks whose results disagree with their reference, makes the executable fail
+static bool checksFailed = false;
+
+// Counts hardware cache misses around a block of code when the platform allows it
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        this->fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif // __linux__
+    }
+
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (this->fd >= 0) close(this->fd);
+#endif // __linux__
+    }
+
+    bool isAvailable() const { return this->fd >= 0; }
+
+    void start() {
+#ifdef __linux__
+        if (this->fd < 0) return;
+        ioctl(this->fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(this->fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif // __linux__
+    }
+
+    uint64_t stop() {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (this->fd < 0) return 0;
+        ioctl(this->fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(this->fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif // __linux__
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+// Runs `function` `iterations` times and returns the average time in milliseconds
+static double timeMilliseconds(int iterations, const std::function<void()>& function) {
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        function();
+    }
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / iterations;
+}
+
+// Random hierarchy where every node picks a parent among the `parentWindow` nodes created before it
+// a small window gives a deep tree, a window as large as the node count gives a wide and shallow one
+static vector<uint32_t> makeRandomHierarchy(uint32_t nodeCount, uint32_t seed, uint32_t parentWindow = 64) {
+    mt19937 random(seed);
+    vector<uint32_t> parents(nodeCount, TransformStore::InvalidIndex);
+    for (uint32_t i = 1; i < nodeCount; ++i) {
+        uint32_t window = std::min(i, parentWindow);
+        parents[i] = i - 1 - (random() % window);
+    }
+    return parents;
+}
+
+//--------------------------------------------------------------------------------------------------
+// transforms: pointer tree (the previous SceneObject layout) vs the flattened TransformStore
+
+struct PointerNode {
+    glm::vec3 localTranslation;
+    glm::quat localRotation;
+    glm::vec3 localScale;
+    glm::mat4 worldMatrix;
+    vector<PointerNode*> children;
+    char padding[96]; //GPU handles and mesh lists of the old SceneObject
+};
+
+static void updatePointerTree(PointerNode* node, const glm::mat4& parentMatrix) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, node->localTranslation);
+    model *= glm::mat4_cast(node->localRotation);
+    model = glm::scale(model, node->localScale);
+    node->worldMatrix = parentMatrix * model;
+
+    vector<PointerNode*> children = node->children; //getChildren() returned a copy
+    for (PointerNode* child : children) {
+        updatePointerTree(child, node->worldMatrix);
+    }
+}
+
+static void benchmarkTransforms() {
+    const uint32_t nodeCount = 100000;
+    const int iterations = 50;
+    vector<uint32_t> parents = makeRandomHierarchy(nodeCount, 42);
+    mt19937 random(7);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    //pointer tree, allocated in a shuffled order with other allocations in between like a real load
+    vector<uint32_t> allocationOrder(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) allocationOrder[i] = i;
+    shuffle(allocationOrder.begin(), allocationOrder.end(), random);
+
+    vector<PointerNode*> nodes(nodeCount);
+    vector<vector<char>> noise;
+    for (uint32_t i : allocationOrder) {
+        nodes[i] = new PointerNode();
+        noise.emplace_back(64 + random() % 512);
+    }
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        nodes[i]->localTranslation = glm::vec3(distribution(random), distribution(random), distribution(random));
+        nodes[i]->localRotation = glm::angleAxis(distribution(random), glm::vec3(0.0f, 1.0f, 0.0f));
+        nodes[i]->localScale = glm::vec3(1.0f);
+        if (parents[i] != TransformStore::InvalidIndex) nodes[parents[i]]->children.push_back(nodes[i]);
+    }
+
+    //transform store, created in the same order
+    TransformStore store;
+    vector<uint32_t> ids(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        ids[i] = store.create();
+        store.setTranslation(ids[i], nodes[i]->localTranslation);
+        store.setRotation(ids[i], nodes[i]->localRotation);
+        store.setScale(ids[i], nodes[i]->localScale);
+        if (parents[i] != TransformStore::InvalidIndex) store.setParent(ids[i], ids[parents[i]]);
+    }
+    store.update();
+
+    CacheMissCounter counter;
+
+    counter.start();
+    double pointerTime = timeMilliseconds(iterations, [&]() { updatePointerTree(nodes[0], glm::mat4(1.0f)); });
+    uint64_t pointerMisses = counter.stop() / iterations;
+
+    counter.start();
+    double storeTime = timeMilliseconds(iterations, [&]() {
+        store.invalidate();
+        store.update();
+        });
+    uint64_t storeMisses = counter.stop() / iterations;
+
+    //both layouts must agree
+    float maxError = 0.0f;
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        const glm::mat4& a = nodes[i]->worldMatrix;
+        const glm::mat4& b = store.getWorldMatrix(ids[i]);
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) maxError = std::max(maxError, std::abs(a[c][r] - b[c][r]));
+        }
+    }
+
+    cout << "transforms (" << nodeCount << " nodes)" << endl;
+    cout << "  pointer tree:    " << pointerTime << " ms/update";
+    if (counter.isAvailable()) cout << ", " << pointerMisses << " cache misses";
+    cout << endl;
+    cout << "  transform store: " << storeTime << " ms/update";
+    if (counter.isAvailable()) cout << ", " << storeMisses << " cache misses";
+    cout << endl;
+    cout << "  max difference:  " << maxError << endl;
+
+    for (PointerNode* node : nodes) delete node;
+}
+
+//--------------------------------------------------------------------------------------------------
+// dirtyTransforms: cost of a static frame and of moving one node with dirty flag propagation
+
+static void benchmarkDirtyTransforms() {
+    const uint32_t nodeCount = 100000;
+    const int iterations = 200;
+    vector<uint32_t> parents = makeRandomHierarchy(nodeCount, 42);
+
+    TransformStore store;
+    vector<uint32_t> ids(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        ids[i] = store.create();
+        store.setTranslation(ids[i], glm::vec3((float)i, 0.0f, 0.0f));
+        if (parents[i] != TransformStore::InvalidIndex) store.setParent(ids[i], ids[parents[i]]);
+    }
+    store.update();
+    uint32_t initialCount = store.getComputedCount();
+
+    double staticTime = timeMilliseconds(iterations, [&]() { store.update(); });
+    uint32_t staticCount = store.getComputedCount();
+
+    //a node deep in the tree, so only a small subtree follows it
+    uint32_t moved = ids[nodeCount - 100];
+    float offset = 0.0f;
+    double movingTime = timeMilliseconds(iterations, [&]() {
+        offset += 1.0f;
+        store.setTranslation(moved, glm::vec3(offset, 0.0f, 0.0f));
+        store.update();
+        });
+    uint32_t movingCount = store.getComputedCount();
+
+    cout << "dirtyTransforms (" << nodeCount << " nodes)" << endl;
+    cout << "  first update:  " << initialCount << " matrices" << endl;
+    cout << "  static frame:  " << staticTime << " ms, " << staticCount << " matrices" << endl;
+    cout << "  one node moved: " << movingTime << " ms, " << movingCount << " matrices" << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// transformKernels: batched TRS composition and matrix products, SIMD vs scalar vs glm
+
+// Largest difference between two matrices in units in the last place of the larger value
+static float maxUlpError(const glm::mat4& a, const glm::mat4& b) {
+    float maxError = 0.0f;
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            float magnitude = std::max(std::abs(a[c][r]), std::abs(b[c][r]));
+            float ulp = std::nextafter(magnitude, INFINITY) - magnitude;
+            maxError = std::max(maxError, std::abs(a[c][r] - b[c][r]) / ulp);
+        }
+    }
+    return maxError;
+}
+
+static void benchmarkTransformKernels() {
+    const uint32_t count = 100000;
+    const int iterations = 50;
+    //products of two matrices may differ from glm by a few rounding steps when FMA is used
+    const float toleranceUlps = 64.0f;
+
+    mt19937 random(11);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    vector<glm::vec3> translations(count);
+    vector<glm::quat> rotations(count);
+    vector<glm::vec3> scales(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        translations[i] = glm::vec3(distribution(random), distribution(random), distribution(random)) * 10.0f;
+        glm::vec3 axis = glm::normalize(glm::vec3(distribution(random), distribution(random), distribution(random)) + glm::vec3(0.0f, 2.0f, 0.0f));
+        rotations[i] = glm::angleAxis(distribution(random) * 3.14159f, axis);
+        scales[i] = glm::vec3(1.0f) + glm::vec3(distribution(random), distribution(random), distribution(random)) * 0.5f;
+    }
+    glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+        * glm::lookAt(glm::vec3(0.0f, 5.0f, -10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    vector<glm::mat4> reference(count), scalar(count), simd(count);
+    vector<glm::mat4> referenceMvp(count), scalarMvp(count), simdMvp(count);
+
+    //TRS to matrix
+    double glmComposeTime = timeMilliseconds(iterations, [&]() {
+        for (uint32_t i = 0; i < count; ++i) {
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, translations[i]);
+            model *= glm::mat4_cast(rotations[i]);
+            reference[i] = glm::scale(model, scales[i]);
+        }
+        });
+    double scalarComposeTime = timeMilliseconds(iterations, [&]() {
+        TransformKernels::composeTRSScalar(translations.data(), rotations.data(), scales.data(), nullptr, count, scalar.data());
+        });
+    double simdComposeTime = timeMilliseconds(iterations, [&]() {
+        TransformKernels::composeTRS(translations.data(), rotations.data(), scales.data(), nullptr, count, simd.data());
+        });
+
+    //model view projection for every object, the three take turns and the fastest round of each
+    //counts, they are close to memory bound and an average mostly measures the noise of the machine
+    double glmMultiplyTime = DBL_MAX, scalarMultiplyTime = DBL_MAX, simdMultiplyTime = DBL_MAX;
+    for (int round = 0; round < iterations; ++round) {
+        glmMultiplyTime = std::min(glmMultiplyTime, timeMilliseconds(1, [&]() {
+            for (uint32_t i = 0; i < count; ++i) referenceMvp[i] = viewProjection * reference[i];
+            }));
+        scalarMultiplyTime = std::min(scalarMultiplyTime, timeMilliseconds(1, [&]() {
+            TransformKernels::multiplyScalar(viewProjection, reference.data(), count, scalarMvp.data());
+            }));
+        simdMultiplyTime = std::min(simdMultiplyTime, timeMilliseconds(1, [&]() {
+            TransformKernels::multiply(viewProjection, reference.data(), count, simdMvp.data());
+            }));
+    }
+
+    float composeScalarError = 0.0f, composeSimdError = 0.0f, multiplyScalarError = 0.0f, multiplySimdError = 0.0f;
+    for (uint32_t i = 0; i < count; ++i) {
+        composeScalarError = std::max(composeScalarError, maxUlpError(reference[i], scalar[i]));
+        composeSimdError = std::max(composeSimdError, maxUlpError(reference[i], simd[i]));
+        multiplyScalarError = std::max(multiplyScalarError, maxUlpError(referenceMvp[i], scalarMvp[i]));
+        multiplySimdError = std::max(multiplySimdError, maxUlpError(referenceMvp[i], simdMvp[i]));
+    }
+    bool passed = composeScalarError <= toleranceUlps && composeSimdError <= toleranceUlps
+        && multiplyScalarError <= toleranceUlps && multiplySimdError <= toleranceUlps;
+    if (!passed) checksFailed = true;
+
+    cout << "transformKernels (" << count << " matrices, " << TransformKernels::getIsaName(TransformKernels::getIsa()) << ")" << endl;
+    cout << "  TRS glm:      " << glmComposeTime << " ms" << endl;
+    cout << "  TRS scalar:   " << scalarComposeTime << " ms, max error " << composeScalarError << " ulp" << endl;
+    cout << "  TRS SIMD:     " << simdComposeTime << " ms, max error " << composeSimdError << " ulp" << endl;
+    cout << "  MVP glm:      " << glmMultiplyTime << " ms" << endl;
+    cout << "  MVP scalar:   " << scalarMultiplyTime << " ms, max error " << multiplyScalarError << " ulp" << endl;
+    cout << "  MVP SIMD:     " << simdMultiplyTime << " ms, max error " << multiplySimdError << " ulp" << endl;
+    cout << "  tolerance (" << toleranceUlps << " ulp): " << (passed ? "passed" : "FAILED") << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parallelTransforms: full transform update of a large hierarchy split by level across threads
+
+static void benchmarkParallelTransforms() {
+    const uint32_t nodeCount = 1000000;
+    const int iterations = 20;
+    //a wide scene, e.g. many objects with small subtrees, deep chains leave nothing to split within a level
+    vector<uint32_t> parents = makeRandomHierarchy(nodeCount, 42, nodeCount);
+
+    TransformStore store;
+    vector<uint32_t> ids(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        ids[i] = store.create();
+        store.setTranslation(ids[i], glm::vec3((float)(i % 100), 0.0f, 1.0f));
+        store.setRotation(ids[i], glm::angleAxis(0.001f * (float)i, glm::vec3(0.0f, 1.0f, 0.0f)));
+        if (parents[i] != TransformStore::InvalidIndex) store.setParent(ids[i], ids[parents[i]]);
+    }
+    store.update();
+    vector<glm::mat4> serialResult(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) serialResult[i] = store.getWorldMatrix(ids[i]);
+
+    //the first parallel update sorts the store into levels, the serial baseline gets the same memory order
+    {
+        JobSystem jobs;
+        jobs.initialize(1);
+        store.invalidate();
+        store.update(&jobs);
+    }
+    uint32_t levelCount = store.getLevelCount();
+
+    double serialTime = timeMilliseconds(iterations, [&]() {
+        store.invalidate();
+        store.update();
+        });
+
+    //more threads than cores only shows the cost of the switching, those runs just check the result
+    uint32_t cores = std::max(1u, thread::hardware_concurrency());
+    cout << "parallelTransforms (" << nodeCount << " nodes in " << levelCount << " levels, " << cores << " hardware threads)" << endl;
+    cout << "  serial:     " << serialTime << " ms/update" << endl;
+    if (cores == 1) {
+        cout << "  a single hardware thread, no scaling is measured" << endl;
+    }
+
+    for (uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u }) {
+        JobSystem jobs;
+        jobs.initialize(threadCount - 1);
+
+        double time = timeMilliseconds(iterations, [&]() {
+            store.invalidate();
+            store.update(&jobs);
+            });
+
+        //same matrices as the serial update, the sort moved the slots so they are compared by id
+        bool identical = true;
+        for (uint32_t i = 0; i < nodeCount && identical; ++i) {
+            identical = memcmp(&serialResult[i], &store.getWorldMatrix(ids[i]), sizeof(glm::mat4)) == 0;
+        }
+        if (!identical) checksFailed = true;
+
+        cout << "  " << threadCount << (threadCount < 10 ? " threads:  " : " threads: ");
+        if (threadCount <= cores) cout << time << " ms/update, speedup " << serialTime / time << "x, ";
+        else cout << "oversubscribed, ";
+        cout << (identical ? "identical" : "MISMATCH") << endl;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// jobSystem: many short parallelFor calls of different sizes back to back, the pattern where a
+// worker waking late could run a chunk of a loop that already returned; every index of every loop
+// must be visited exactly once and only by that loop's function
+
+static void benchmarkJobSystem() {
+    const int loops = 20000;
+    const size_t maxCount = 4096;
+
+    //more workers than cores, so that workers are often descheduled in the middle of a loop
+    JobSystem jobs;
+    jobs.initialize(7);
+
+    mt19937 random(33);
+    vector<std::atomic<uint32_t>> visits(maxCount);
+    std::atomic<uint32_t> currentLoop{ 0 };
+    std::atomic<uint32_t> foreignChunks{ 0 };
+    uint32_t wrongCounts = 0;
+    double time = timeMilliseconds(1, [&]() {
+        for (int loop = 0; loop < loops; ++loop) {
+            size_t count = 1 + random() % maxCount;
+            size_t chunkCount = 1 + random() % 32;
+            for (size_t i = 0; i < count; ++i) visits[i] = 0;
+            currentLoop = (uint32_t)loop;
+
+            jobs.parallelFor(count, chunkCount, [&, loop](size_t begin, size_t end, size_t) {
+                if (currentLoop != (uint32_t)loop) foreignChunks++;
+                for (size_t i = begin; i < end; ++i) visits[i]++;
+                });
+
+            for (size_t i = 0; i < count; ++i) {
+                if (visits[i] != 1) wrongCounts++;
+            }
+        }
+        });
+
+    bool passed = foreignChunks == 0 && wrongCounts == 0;
+    if (!passed) checksFailed = true;
+
+    cout << "jobSystem (" << loops << " loops of up to " << maxCount << " items, " << jobs.getThreadCount() << " threads)" << endl;
+    cout << "  " << time << " ms, " << wrongCounts << " items not visited once, " << foreignChunks << " chunks of a finished loop ("
+        << (passed ? "passed" : "FAILED") << ")" << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// frameAllocations: a steady state frame of the CPU frame path must not touch the heap: the
+// transform update, the item bounds and BVH refit, the occluder rasterization, the culled draw list
+// built over chunks of the flattened items and its sort, laid out like Application's
+
+static void benchmarkFrameAllocations() {
+    const uint32_t nodeCount = 50000;
+    const uint32_t occluderCount = 16;
+    const int warmupFrames = 20;	//covers the serial, parallel and full update paths once
+    const int frames = 100;
+    vector<uint32_t> parents = makeRandomHierarchy(nodeCount, 42, nodeCount);
+
+    mt19937 random(42);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    TransformStore store;
+    vector<uint32_t> ids(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        ids[i] = store.create();
+        if (parents[i] != TransformStore::InvalidIndex) store.setParent(ids[i], ids[parents[i]]);
+        store.setTranslation(ids[i], glm::vec3(distribution(random), distribution(random), distribution(random)) * 4.0f);
+    }
+    store.update();
+
+    JobSystem jobs;
+    jobs.initialize(3);
+
+    //one item per node: a unit box, its world bounds and sphere, and the draw fields of a SceneItem
+    const AABB localBounds(glm::vec3(-1.0f), glm::vec3(1.0f));
+    const Sphere localSphere(glm::vec3(0.0f), std::sqrt(3.0f));
+    vector<AABB> itemBounds(nodeCount);
+    SphereArrays itemSpheres;
+    itemSpheres.resize(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        itemBounds[i] = localBounds.transformed(store.getWorldMatrix(ids[i]));
+        itemSpheres.set(i, localSphere.transformed(store.getWorldMatrix(ids[i])));
+    }
+    SceneBVH bvh;
+    bvh.build(itemBounds.data(), nodeCount);
+
+    //the occluders are unit boxes drawn with the matrices of the first items
+    const float cubePositions[] = { -1, -1, -1,  1, -1, -1,  1, 1, -1,  -1, 1, -1,  -1, -1, 1,  1, -1, 1,  1, 1, 1,  -1, 1, 1 };
+    const uint16_t cubeIndices[] = { 0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,  3, 6, 2, 3, 7, 6,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5 };
+    OcclusionCuller occlusionCuller;
+    occlusionCuller.initialize(256, 128);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, -60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspectiveZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    glm::mat4 viewProjection = projection * view;
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    glm::vec4 wRow = glm::row(viewProjection, 3);
+    glm::vec4 depthRow = glm::row(view, 2);
+    float minRadiusPerW = 2.0f * 1.0f / (720.0f * projection[1][1]);
+
+    struct FrameDraw {
+        uint32_t item;
+        uint32_t transformSlot;
+        uint64_t sortKey;
+    };
+    size_t chunkCount = (size_t)jobs.getThreadCount() * 4;
+    vector<vector<FrameDraw>> chunkDraws(chunkCount);
+    vector<FrameDraw> drawList;
+    vector<CullingKernels::Result> cullResults(nodeCount);
+    vector<DrawSort::Packet> packets, packetScratch;
+    size_t lastDrawCount = 0;
+
+    //the same number of nodes moves every frame, serial and parallel updates alternate
+    auto frame = [&](int index) {
+        for (uint32_t i = 0; i < 64; ++i) {
+            uint32_t id = ids[(i * 7919u + (uint32_t)index) % nodeCount];
+            store.setTranslation(id, glm::vec3((float)(index % 8), (float)(i % 8), 0.0f));
+        }
+        store.update(index % 2 == 0 ? &jobs : nullptr);
+        if (index % 10 == 0) {
+            store.invalidate();
+            store.update(&jobs);
+        }
+
+        //bounds of the items whose world matrix changed, then the tree
+        jobs.parallelFor(nodeCount, chunkCount, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                if (!store.wasChanged(ids[i])) continue;
+                const glm::mat4& world = store.getWorldMatrix(ids[i]);
+                itemBounds[i] = localBounds.transformed(world);
+                itemSpheres.set(i, localSphere.transformed(world));
+                bvh.setItemBounds((uint32_t)i, itemBounds[i]);
+            }
+            });
+        bvh.refit();
+
+        occlusionCuller.beginFrame(viewProjection);
+        for (uint32_t i = 0; i < occluderCount; ++i) {
+            occlusionCuller.addOccluder(cubePositions, 8, cubeIndices, false, 36, store.getWorldMatrix(ids[i]));
+        }
+        occlusionCuller.rasterize(&jobs);
+
+        //contiguous chunks of the flattened items, merged in order
+        drawList.clear();
+        jobs.parallelFor(nodeCount, chunkCount, [&](size_t begin, size_t end, size_t chunk) {
+            vector<FrameDraw>& draws = chunkDraws[chunk];
+            draws.clear();
+            CullingKernels::testSpheres(frustum, wRow, minRadiusPerW, itemSpheres.centerX.data() + begin, itemSpheres.centerY.data() + begin,
+                itemSpheres.centerZ.data() + begin, itemSpheres.radius.data() + begin, end - begin, cullResults.data() + begin);
+            for (size_t i = begin; i < end; ++i) {
+                if (cullResults[i] != CullingKernels::Result::Visible || !occlusionCuller.isVisible(itemBounds[i])) continue;
+                float viewDepth = glm::dot(depthRow, glm::vec4(itemSpheres.centerX[i], itemSpheres.centerY[i], itemSpheres.centerZ[i], 1.0f));
+                uint64_t sortKey = DrawSort::makeKey(DrawSort::Opaque, 0, (uint32_t)i % 64, (uint32_t)i % 2000, viewDepth);
+                draws.push_back({ (uint32_t)i, store.getSlot(ids[i]), sortKey });
+            }
+            });
+        for (const vector<FrameDraw>& draws : chunkDraws) {
+            drawList.insert(drawList.end(), draws.begin(), draws.end());
+        }
+
+        packets.resize(drawList.size());
+        for (size_t i = 0; i < drawList.size(); ++i) {
+            packets[i].key = drawList[i].sortKey;
+            packets[i].draw = (uint32_t)i;
+        }
+        DrawSort::sort(packets, packetScratch);
+        lastDrawCount = drawList.size();
+    };
+
+    for (int i = 0; i < warmupFrames; ++i) frame(i);
+
+    AllocationCounter::Scope scope;
+    for (int i = 0; i < frames; ++i) frame(warmupFrames + i);
+    uint64_t allocations = scope.getCount();
+
+    cout << "frameAllocations (" << nodeCount << " nodes, " << frames << " frames, " << lastDrawCount << " draws in the last)" << endl;
+    if (!AllocationCounter::isEnabled()) {
+        cout << "  allocation tracking is not compiled in (TRACK_ALLOCATIONS)" << endl;
+        return;
+    }
+
+    bool passed = allocations == 0;
+    if (!passed) checksFailed = true;
+    cout << "  allocations: " << allocations << " (" << (passed ? "passed" : "FAILED") << ")" << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// sceneBvh: build, refit and queries over object boxes, checked against brute force
+
+static void benchmarkSceneBvh() {
+    const uint32_t itemCount = 100000;
+    const int iterations = 10;
+
+    mt19937 random(3);
+    uniform_real_distribution<float> position(-500.0f, 500.0f);
+    uniform_real_distribution<float> size(0.5f, 5.0f);
+    vector<AABB> bounds(itemCount);
+    for (AABB& box : bounds) {
+        glm::vec3 center(position(random), position(random) * 0.1f, position(random));
+        glm::vec3 extents(size(random), size(random), size(random));
+        box = AABB(center - extents, center + extents);
+    }
+
+    SceneBVH bvh;
+    double buildTime = timeMilliseconds(iterations, [&]() { bvh.build(bounds.data(), itemCount); });
+
+    //every object moves a little, the tree shape stays
+    double refitTime = timeMilliseconds(iterations, [&]() {
+        for (uint32_t i = 0; i < itemCount; ++i) {
+            bounds[i].min.x += 0.1f;
+            bounds[i].max.x += 0.1f;
+            bvh.setItemBounds(i, bounds[i]);
+        }
+        bvh.refit();
+        });
+
+    glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f)
+        * glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(100.0f, 0.0f, 50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    Sphere sphere{ glm::vec3(50.0f, 0.0f, -20.0f), 60.0f };
+    AABB box(glm::vec3(-100.0f, -10.0f, -100.0f), glm::vec3(0.0f, 10.0f, 0.0f));
+    Ray ray(glm::vec3(-600.0f, 1.0f, -3.0f), glm::normalize(glm::vec3(1.0f, 0.0f, 0.01f)));
+
+    vector<uint32_t> items;
+    items.reserve(itemCount);
+    size_t frustumCount = 0, sphereCount = 0, boxCount = 0;
+    double frustumTime = timeMilliseconds(iterations, [&]() { items.clear(); bvh.queryFrustum(frustum, items); frustumCount = items.size(); });
+    double sphereTime = timeMilliseconds(iterations, [&]() { items.clear(); bvh.querySphere(sphere, items); sphereCount = items.size(); });
+    double boxTime = timeMilliseconds(iterations, [&]() { items.clear(); bvh.queryAABB(box, items); boxCount = items.size(); });
+    uint32_t rayItem = SceneBVH::InvalidItem;
+    float rayDistance = FLT_MAX;
+    double rayTime = timeMilliseconds(iterations, [&]() { rayDistance = FLT_MAX; rayItem = bvh.raycastBounds(ray, rayDistance); });
+
+    //brute force reference
+    size_t bruteFrustum = 0, bruteSphere = 0, bruteBox = 0;
+    float bruteDistance = FLT_MAX;
+    double bruteTime = timeMilliseconds(1, [&]() {
+        for (const AABB& itemBox : bounds) {
+            if (frustum.intersects(itemBox)) bruteFrustum++;
+            if (intersects(itemBox, sphere)) bruteSphere++;
+            if (itemBox.overlaps(box)) bruteBox++;
+            bruteDistance = std::min(bruteDistance, ray.intersect(itemBox, FLT_MAX));
+        }
+        });
+
+    bool passed = frustumCount == bruteFrustum && sphereCount == bruteSphere && boxCount == bruteBox && rayDistance == bruteDistance;
+    if (!passed) checksFailed = true;
+
+    cout << "sceneBvh (" << itemCount << " objects, " << bvh.getNodeCount() << " nodes)" << endl;
+    cout << "  build:   " << buildTime << " ms" << endl;
+    cout << "  refit:   " << refitTime << " ms" << endl;
+    cout << "  frustum: " << frustumTime << " ms, " << frustumCount << " objects" << endl;
+    cout << "  sphere:  " << sphereTime << " ms, " << sphereCount << " objects" << endl;
+    cout << "  box:     " << boxTime << " ms, " << boxCount << " objects" << endl;
+    cout << "  ray:     " << rayTime << " ms, " << (rayItem == SceneBVH::InvalidItem ? "no hit" : "hit at " + to_string(rayDistance)) << endl;
+    cout << "  brute force (all four queries): " << bruteTime << " ms, " << (passed ? "same results" : "MISMATCH") << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// raycast: two level BVH (objects, then triangles) on a Sponza sized scene, SIMD vs scalar
+
+// Bumpy sphere tessellated into 2 * rings * segments triangles
+static void makeSphere(uint32_t rings, uint32_t segments, vector<float>& positions, vector<uint32_t>& indices) {
+    for (uint32_t ring = 0; ring <= rings; ++ring) {
+        float theta = 3.14159265f * ring / rings;
+        for (uint32_t segment = 0; segment <= segments; ++segment) {
+            float phi = 2.0f * 3.14159265f * segment / segments;
+            float radius = 1.0f + 0.05f * std::sin(7.0f * theta) * std::cos(5.0f * phi);
+            positions.push_back(radius * std::sin(theta) * std::cos(phi));
+            positions.push_back(radius * std::cos(theta));
+            positions.push_back(radius * std::sin(theta) * std::sin(phi));
+        }
+    }
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            uint32_t a = ring * (segments + 1) + segment;
+            uint32_t b = a + segments + 1;
+            indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+}
+
+static void benchmarkRaycast() {
+    //about the triangle count of Sponza spread over many objects
+    const uint32_t objectCount = 64;
+    const uint32_t rayCount = 100000;
+    const uint32_t checkedRayCount = 200;
+
+    vector<float> positions;
+    vector<uint32_t> indices;
+    makeSphere(64, 32, positions, indices);
+    uint32_t meshTriangles = (uint32_t)indices.size() / 3;
+
+    auto buildStart = chrono::high_resolution_clock::now();
+    MeshBVH meshBvh;
+    meshBvh.build(positions.data(), positions.size() / 3, indices.data(), indices.size());
+    auto buildEnd = chrono::high_resolution_clock::now();
+
+    AABB localBounds;
+    for (size_t i = 0; i < positions.size(); i += 3) localBounds.expand(glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+
+    mt19937 random(5);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    vector<glm::mat4> worlds(objectCount), worldToModels(objectCount);
+    vector<AABB> objectBounds(objectCount);
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        glm::mat4 world = glm::translate(glm::mat4(1.0f), glm::vec3(distribution(random) * 40.0f, distribution(random) * 10.0f, distribution(random) * 20.0f));
+        world = glm::rotate(world, distribution(random) * 3.0f, glm::normalize(glm::vec3(distribution(random), 1.0f, distribution(random))));
+        world = glm::scale(world, glm::vec3(2.0f + 2.0f * std::abs(distribution(random))));
+        worlds[i] = world;
+        worldToModels[i] = glm::inverse(world);
+        objectBounds[i] = localBounds.transformed(world);
+    }
+    SceneBVH sceneBvh;
+    sceneBvh.build(objectBounds.data(), objectCount);
+
+    vector<Ray> rays;
+    rays.reserve(rayCount);
+    for (uint32_t i = 0; i < rayCount; ++i) {
+        glm::vec3 origin(distribution(random) * 45.0f, distribution(random) * 12.0f, distribution(random) * 25.0f);
+        glm::vec3 direction = glm::normalize(glm::vec3(distribution(random), distribution(random) * 0.3f, distribution(random)));
+        rays.emplace_back(origin, direction);
+    }
+
+    struct Result {
+        uint32_t object = SceneBVH::InvalidItem;
+        MeshHit hit;
+    };
+    auto castAll = [&](bool simd, vector<Result>& results) {
+        for (uint32_t r = 0; r < rayCount; ++r) {
+            Result& result = results[r];
+            result = Result();
+            sceneBvh.raycast(rays[r], result.hit.distance, [&](uint32_t object, float& maxDistance) {
+                MeshHit hit = result.hit;
+                hit.distance = maxDistance;
+                glm::vec3 origin = glm::vec3(worldToModels[object] * glm::vec4(rays[r].origin, 1.0f));
+                glm::vec3 direction = glm::vec3(worldToModels[object] * glm::vec4(rays[r].direction, 0.0f));
+                bool found = simd ? meshBvh.raycast(Ray(origin, direction), hit) : meshBvh.raycastScalar(Ray(origin, direction), hit);
+                if (!found) return false;
+                result.hit = hit;
+                result.object = object;
+                maxDistance = hit.distance;
+                return true;
+                });
+        }
+    };
+
+    vector<Result> simdResults(rayCount), scalarResults(rayCount);
+    double simdTime = timeMilliseconds(1, [&]() { castAll(true, simdResults); });
+    double scalarTime = timeMilliseconds(1, [&]() { castAll(false, scalarResults); });
+
+    //both paths against each other, and a few rays against every triangle of every object
+    uint32_t hits = 0, mismatches = 0;
+    for (uint32_t r = 0; r < rayCount; ++r) {
+        if (simdResults[r].object != SceneBVH::InvalidItem) hits++;
+        if (simdResults[r].object != scalarResults[r].object || simdResults[r].hit.triangle != scalarResults[r].hit.triangle) mismatches++;
+    }
+    for (uint32_t r = 0; r < checkedRayCount; ++r) {
+        float nearest = FLT_MAX;
+        for (uint32_t object = 0; object < objectCount; ++object) {
+            glm::vec3 origin = glm::vec3(worldToModels[object] * glm::vec4(rays[r].origin, 1.0f));
+            glm::vec3 direction = glm::vec3(worldToModels[object] * glm::vec4(rays[r].direction, 0.0f));
+            for (uint32_t t = 0; t < meshTriangles; ++t) {
+                glm::vec3 v0(positions[3 * indices[3 * t]], positions[3 * indices[3 * t] + 1], positions[3 * indices[3 * t] + 2]);
+                glm::vec3 v1(positions[3 * indices[3 * t + 1]], positions[3 * indices[3 * t + 1] + 1], positions[3 * indices[3 * t + 1] + 2]);
+                glm::vec3 v2(positions[3 * indices[3 * t + 2]], positions[3 * indices[3 * t + 2] + 1], positions[3 * indices[3 * t + 2] + 2]);
+                //plain Moller-Trumbore
+                glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+                glm::vec3 p = glm::cross(direction, e2);
+                float det = glm::dot(e1, p);
+                if (std::abs(det) < 1e-12f) continue;
+                glm::vec3 offset = origin - v0;
+                float u = glm::dot(offset, p) / det;
+                glm::vec3 q = glm::cross(offset, e1);
+                float v = glm::dot(direction, q) / det;
+                float distance = glm::dot(e2, q) / det;
+                if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance > 0.0f) nearest = std::min(nearest, distance);
+            }
+        }
+        float found = simdResults[r].hit.distance;
+        if ((nearest == FLT_MAX) != (found == FLT_MAX) || (nearest != FLT_MAX && std::abs(nearest - found) > 1e-3f * nearest)) mismatches++;
+    }
+    if (mismatches > 0) checksFailed = true;
+
+    cout << "raycast (" << objectCount << " objects, " << objectCount * meshTriangles << " triangles, " << rayCount << " rays, one core)" << endl;
+    cout << "  mesh BVH build: " << chrono::duration<double, milli>(buildEnd - buildStart).count() << " ms for " << meshTriangles << " triangles" << endl;
+    cout << "  SIMD:   " << rayCount / (simdTime / 1000.0) / 1e6 << " Mrays/s" << endl;
+    cout << "  scalar: " << rayCount / (scalarTime / 1000.0) / 1e6 << " Mrays/s" << endl;
+    cout << "  hits: " << hits << ", mismatches: " << mismatches << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// occlusion: software rasterized occluders and box tests against the depth pyramid
+
+static void benchmarkOcclusion() {
+    const uint32_t width = 256, height = 128;
+    const uint32_t objectCount = 100000;
+    const uint32_t occluderCount = 16;
+    const int iterations = 20;
+
+    glm::mat4 projection = glm::perspectiveZO(glm::radians(60.0f), 2.0f, 0.1f, 200.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+
+    mt19937 random(9);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    vector<AABB> objects(objectCount);
+    for (AABB& object : objects) {
+        float depth = 5.0f + 55.0f * std::abs(distribution(random));
+        glm::vec3 center(distribution(random) * depth, distribution(random) * depth * 0.5f, depth);
+        glm::vec3 extents = glm::vec3(0.2f + 0.3f * std::abs(distribution(random)));
+        object = AABB(center - extents, center + extents);
+    }
+
+    JobSystem jobs;
+    jobs.initialize(std::max(1u, thread::hardware_concurrency()) - 1);
+    OcclusionCuller culler;
+    culler.initialize(width, height);
+
+    //a single wall at z = 20, convex, so a box is hidden exactly when it is behind the wall and
+    //all its corners project inside it, one pixel of slack for the sampling at pixel centers
+    const float wallZ = 20.0f;
+    const float wallPositions[] = { -10.0f, -5.0f, wallZ, 10.0f, -5.0f, wallZ, 10.0f, 5.0f, wallZ, -10.0f, 5.0f, wallZ };
+    const uint16_t wallIndices[] = { 0, 1, 2, 0, 2, 3 };
+    culler.beginFrame(viewProjection);
+    culler.addOccluder(wallPositions, 4, wallIndices, false, 6, glm::mat4(1.0f));
+    culler.rasterize(&jobs);
+
+    auto toScreen = [&](const glm::vec3& position) {
+        glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+        return glm::vec2((clip.x / clip.w + 1.0f) * 0.5f * width, (1.0f - clip.y / clip.w) * 0.5f * height);
+    };
+    glm::vec2 wallMin = toScreen(glm::vec3(-10.0f, 5.0f, wallZ)) - glm::vec2(1.0f);
+    glm::vec2 wallMax = toScreen(glm::vec3(10.0f, -5.0f, wallZ)) + glm::vec2(1.0f);
+
+    uint32_t wallCulled = 0, falseCulls = 0, keptHidden = 0;
+    for (const AABB& object : objects) {
+        bool hidden = object.min.z > wallZ;
+        bool hiddenWithSlack = hidden;
+        for (uint32_t corner = 0; corner < 8 && hiddenWithSlack; ++corner) {
+            glm::vec3 position(corner & 1 ? object.max.x : object.min.x, corner & 2 ? object.max.y : object.min.y, corner & 4 ? object.max.z : object.min.z);
+            glm::vec2 screen = toScreen(position);
+            hiddenWithSlack = screen.x >= wallMin.x && screen.y >= wallMin.y && screen.x <= wallMax.x && screen.y <= wallMax.y;
+            //boxes well inside the wall that are kept anyway show how coarse the pyramid test is
+            hidden = hidden && screen.x >= wallMin.x + 3.0f && screen.y >= wallMin.y + 3.0f && screen.x <= wallMax.x - 3.0f && screen.y <= wallMax.y - 3.0f;
+        }
+        bool visible = culler.isVisible(object);
+        if (!visible) wallCulled++;
+        if (!visible && !hiddenWithSlack) falseCulls++;
+        if (visible && hidden) keptHidden++;
+    }
+    if (falseCulls > 0) checksFailed = true;
+
+    //timing with a few thousand occluder triangles in front of the objects
+    vector<float> spherePositions;
+    vector<uint32_t> sphereIndices;
+    makeSphere(32, 64, spherePositions, sphereIndices);
+    vector<glm::mat4> occluderWorlds(occluderCount);
+    for (glm::mat4& world : occluderWorlds) {
+        float depth = 8.0f + 12.0f * std::abs(distribution(random));
+        world = glm::translate(glm::mat4(1.0f), glm::vec3(distribution(random) * depth * 0.6f, distribution(random) * depth * 0.3f, depth));
+        world = glm::scale(world, glm::vec3(1.5f + 2.0f * std::abs(distribution(random))));
+    }
+
+    double rasterTime = timeMilliseconds(iterations, [&]() {
+        culler.beginFrame(viewProjection);
+        for (const glm::mat4& world : occluderWorlds) {
+            culler.addOccluder(spherePositions.data(), spherePositions.size() / 3, sphereIndices.data(), true, sphereIndices.size(), world);
+        }
+        culler.rasterize(&jobs);
+        });
+    uint32_t culled = 0;
+    double testTime = timeMilliseconds(iterations, [&]() {
+        culled = 0;
+        for (const AABB& object : objects) {
+            if (!culler.isVisible(object)) culled++;
+        }
+        });
+
+    cout << "occlusion (" << width << "x" << height << " depth, " << objectCount << " boxes, " << jobs.getThreadCount() << " threads)" << endl;
+    cout << "  wall: " << wallCulled << " culled, false culls: " << falseCulls << ", hidden but kept: " << keptHidden << endl;
+    cout << "  rasterize: " << rasterTime << " ms for " << culler.getStats().triangles << " occluder triangles" << endl;
+    cout << "  box tests: " << testTime << " ms, " << culled << " culled (" << 100.0 * culled / objectCount << "%)" << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// frustumCulling: bounding sphere frustum and screen coverage tests, SIMD vs scalar, and the bounds
+// computed for meshes loaded without accessor min/max
+
+static void benchmarkFrustumCulling() {
+    const uint32_t count = 100000;
+    const int iterations = 50;
+    const float minCoveragePixels = 1.0f;
+    const float screenHeight = 1080.0f;
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    glm::vec4 wRow = glm::row(viewProjection, 3);
+    float minRadiusPerW = 2.0f * minCoveragePixels / (screenHeight * projection[1][1]);
+
+    //objects all around the camera, from pebbles to buildings
+    mt19937 random(12);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    SphereArrays spheres;
+    spheres.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 center = glm::vec3(distribution(random), distribution(random) * 0.1f, distribution(random)) * 400.0f;
+        spheres.set(i, Sphere(center, std::pow(10.0f, 1.5f * distribution(random))));
+    }
+
+    vector<CullingKernels::Result> scalar(count), simd(count);
+    uint32_t perObjectVisible = 0;
+    double perObjectTime = timeMilliseconds(iterations, [&]() {
+        perObjectVisible = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            Sphere sphere(glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]), spheres.radius[i]);
+            if (frustum.intersects(sphere)) perObjectVisible++;
+        }
+        });
+    double scalarTime = timeMilliseconds(iterations, [&]() {
+        CullingKernels::testSpheresScalar(frustum, wRow, minRadiusPerW, spheres.centerX.data(), spheres.centerY.data(),
+            spheres.centerZ.data(), spheres.radius.data(), count, scalar.data());
+        });
+    double simdTime = timeMilliseconds(iterations, [&]() {
+        CullingKernels::testSpheres(frustum, wRow, minRadiusPerW, spheres.centerX.data(), spheres.centerY.data(),
+            spheres.centerZ.data(), spheres.radius.data(), count, simd.data());
+        });
+
+    uint32_t outside = 0, tooSmall = 0, mismatches = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (scalar[i] == CullingKernels::Result::OutsideFrustum) outside++;
+        if (scalar[i] == CullingKernels::Result::TooSmall) tooSmall++;
+        if (scalar[i] != simd[i]) mismatches++;
+    }
+    if (mismatches > 0) checksFailed = true;
+
+    //bounds of a large mesh, the vertex count is not a multiple of four to cover the tail
+    vector<float> positions;
+    vector<uint32_t> indices;
+    makeSphere(512, 1024, positions, indices);
+    size_t vertexCount = positions.size() / 3;
+    AABB scalarBounds, simdBounds;
+    double scalarBoundsTime = timeMilliseconds(iterations, [&]() {
+        scalarBounds = CullingKernels::computeBoundsScalar(positions.data(), vertexCount);
+        });
+    double simdBoundsTime = timeMilliseconds(iterations, [&]() {
+        simdBounds = CullingKernels::computeBounds(positions.data(), vertexCount);
+        });
+    bool boundsMatch = scalarBounds.min == simdBounds.min && scalarBounds.max == simdBounds.max;
+    if (!boundsMatch) checksFailed = true;
+
+    cout << "frustumCulling (" << count << " spheres, " << minCoveragePixels << " pixel coverage threshold)" << endl;
+    cout << "  Frustum::intersects: " << perObjectTime << " ms, " << perObjectVisible << " in the frustum" << endl;
+    cout << "  scalar kernel:       " << scalarTime << " ms, " << outside << " outside, " << tooSmall << " too small" << endl;
+    cout << "  SIMD kernel:         " << simdTime << " ms, mismatches: " << mismatches << endl;
+    cout << "  bounds of " << vertexCount << " vertices: scalar " << scalarBoundsTime << " ms, SIMD " << simdBoundsTime
+        << " ms, " << (boundsMatch ? "match" : "MISMATCH") << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// sceneAllocation: loading and releasing a large scene with one heap allocation per node and mesh
+// and a recursive delete (the previous layout) vs the scene object pools
+
+// CPU side of a Mesh, the real one needs a device
+struct MeshStandIn {
+    vector<float> vertices;
+    void* buffers[4] = {};
+    AABB localBounds = AABB(glm::vec3(-1.0f), glm::vec3(1.0f));
+
+    explicit MeshStandIn(size_t vertexFloats) : vertices(vertexFloats, 1.0f) {}
+};
+
+static void deleteHeapScene(SceneObject* node, TransformStore& transforms, vector<MeshStandIn*>& meshes) {
+    for (SceneObject* child : node->getChildren()) {
+        deleteHeapScene(child, transforms, meshes);
+    }
+    delete meshes[node->getTransformId()];
+    transforms.destroy(node->getTransformId());
+    delete node;
+}
+
+static void benchmarkSceneAllocation() {
+    const uint32_t nodeCount = 200000;
+    const size_t vertexFloats = 96;
+    const int iterations = 5;
+    vector<uint32_t> parents = makeRandomHierarchy(nodeCount, 5, 1024);
+
+    //the loader creates nodes depth first, a parent before its children
+    vector<vector<uint32_t>> children(nodeCount);
+    for (uint32_t i = 1; i < nodeCount; ++i) children[parents[i]].push_back(i);
+    vector<uint32_t> order;
+    vector<uint32_t> stack = { 0 };
+    while (!stack.empty()) {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        order.push_back(node);
+        stack.insert(stack.end(), children[node].rbegin(), children[node].rend());
+    }
+
+    //builds the scene with `create` and returns the root, nodes[i] is the node of hierarchy index i;
+    //like the loader, the children of a node are added one after the other once they all exist
+    vector<SceneObject*> nodes(nodeCount);
+    auto load = [&](const std::function<SceneObject*()>& createNode, const std::function<void(SceneObject*)>& createMesh) {
+        for (uint32_t index : order) {
+            nodes[index] = createNode();
+            createMesh(nodes[index]);
+        }
+        for (uint32_t index : order) {
+            for (uint32_t child : children[index]) nodes[index]->addChild(nodes[child]);
+        }
+        return nodes[0];
+    };
+    //what a per frame system touches: every node and its mesh, in tree order
+    auto walk = [&](SceneObject* root, const std::function<const MeshStandIn*(SceneObject*)>& getMesh) {
+        float sum = 0.0f;
+        vector<SceneObject*> walkStack = { root };
+        while (!walkStack.empty()) {
+            SceneObject* node = walkStack.back();
+            walkStack.pop_back();
+            sum += getMesh(node)->vertices[0];
+            walkStack.insert(walkStack.end(), node->getChildren().begin(), node->getChildren().end());
+        }
+        return sum;
+    };
+
+    TransformStore transforms;
+    SceneLists lists;
+    double heapLoad = 0.0, heapWalk = 0.0, heapTeardown = 0.0;
+    uint64_t heapAllocations = 0;
+    vector<MeshStandIn*> heapMeshes(nodeCount);
+    for (int i = 0; i < iterations; ++i) {
+        AllocationCounter::Scope allocations;
+        SceneObject* root = nullptr;
+        heapLoad += timeMilliseconds(1, [&]() {
+            root = load([&]() { return new SceneObject(&transforms, &lists); },
+                [&](SceneObject* node) { heapMeshes[node->getTransformId()] = new MeshStandIn(vertexFloats); });
+            });
+        heapAllocations = allocations.getCount();
+        heapWalk += timeMilliseconds(1, [&]() { walk(root, [&](SceneObject* node) { return heapMeshes[node->getTransformId()]; }); });
+        heapTeardown += timeMilliseconds(1, [&]() {
+            deleteHeapScene(root, transforms, heapMeshes);
+            lists.clear();
+            });
+        transforms.clear();
+    }
+
+    ObjectPool<SceneObject> sceneObjects;
+    ObjectPool<MeshStandIn> meshes;
+    vector<MeshStandIn*> poolMeshes(nodeCount);
+    double poolLoad = 0.0, poolWalk = 0.0, poolTeardown = 0.0;
+    uint64_t poolAllocations = 0;
+    for (int i = 0; i < iterations; ++i) {
+        AllocationCounter::Scope allocations;
+        SceneObject* root = nullptr;
+        poolLoad += timeMilliseconds(1, [&]() {
+            root = load([&]() { return sceneObjects.create(&transforms, &lists); },
+                [&](SceneObject* node) { poolMeshes[node->getTransformId()] = meshes.create(vertexFloats); });
+            });
+        poolAllocations = allocations.getCount();
+        poolWalk += timeMilliseconds(1, [&]() { walk(root, [&](SceneObject* node) { return poolMeshes[node->getTransformId()]; }); });
+        poolTeardown += timeMilliseconds(1, [&]() {
+            meshes.clear();
+            sceneObjects.clear();
+            lists.clear();
+            transforms.clear();
+            });
+    }
+
+    //the pools are reused after the first load, the counts are those of the last one
+    cout << "sceneAllocation (" << nodeCount << " nodes with one mesh each, average of " << iterations << " loads)" << endl;
+    cout << "  heap: load " << heapLoad / iterations << " ms, walk " << heapWalk / iterations << " ms, teardown " << heapTeardown / iterations << " ms";
+    if (AllocationCounter::isEnabled()) cout << ", " << heapAllocations << " allocations per load";
+    cout << endl;
+    cout << "  pool: load " << poolLoad / iterations << " ms, walk " << poolWalk / iterations << " ms, teardown " << poolTeardown / iterations << " ms";
+    if (AllocationCounter::isEnabled()) cout << ", " << poolAllocations << " allocations per load";
+    cout << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// entities: per frame systems over the archetype entity store vs a walk over the scene object tree
+
+static void benchmarkEntities() {
+    const uint32_t entityCount = 100000;
+    const uint32_t dynamicEvery = 10;	//one moving entity in ten
+    const int iterations = 50;
+    vector<uint32_t> parents = makeRandomHierarchy(entityCount, 8, 1024);
+
+    //one scene object with one mesh per entity, created in hierarchy order as the loader does
+    TransformStore transforms;
+    SceneLists lists;
+    ObjectPool<SceneObject> sceneObjects;
+    ObjectPool<MeshStandIn> meshes;
+    vector<SceneObject*> nodes(entityCount);
+    vector<vector<uint32_t>> children(entityCount);
+    vector<MeshStandIn*> nodeMeshes(entityCount);	//by transform id, SceneObject only holds real meshes
+    vector<uint8_t> nodeDynamic(entityCount);
+    EntityStore entities;
+    mt19937 random(8);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (uint32_t i = 0; i < entityCount; ++i) {
+        nodes[i] = sceneObjects.create(&transforms, &lists);
+        nodes[i]->setTranslation(glm::vec3(distribution(random), distribution(random), distribution(random)) * 10.0f);
+        if (parents[i] != TransformStore::InvalidIndex) children[parents[i]].push_back(i);
+        MeshStandIn* mesh = meshes.create(96);
+        nodeMeshes[nodes[i]->getTransformId()] = mesh;
+        bool dynamic = i % dynamicEvery == 0;
+        nodeDynamic[nodes[i]->getTransformId()] = dynamic;
+
+        uint32_t entity = entities.create(EntityStore::Transform | EntityStore::MeshRenderer | EntityStore::Bounds
+            | (dynamic ? EntityStore::DynamicTag : EntityStore::StaticTag));
+        entities.getTransform(entity)->transformId = nodes[i]->getTransformId();
+        entities.getMeshRenderer(entity)->mesh = reinterpret_cast<Mesh*>(mesh);	//never dereferenced
+        entities.getBounds(entity)->localBounds = mesh->localBounds;
+    }
+    for (uint32_t i = 0; i < entityCount; ++i) {
+        for (uint32_t child : children[i]) nodes[i]->addChild(nodes[child]);
+    }
+    transforms.update();
+
+    vector<pair<const void*, uint32_t>> treeDraws, entityDraws;
+    vector<AABB> treeBounds(entityCount), entityBounds(entityCount);
+    treeDraws.reserve(entityCount);
+    entityDraws.reserve(entityCount);
+
+    //draw list: every mesh with its transform slot
+    double treeDrawTime = timeMilliseconds(iterations, [&]() {
+        treeDraws.clear();
+        vector<SceneObject*> stack = { nodes[0] };
+        while (!stack.empty()) {
+            SceneObject* node = stack.back();
+            stack.pop_back();
+            treeDraws.push_back({ nodeMeshes[node->getTransformId()], node->getTransformSlot() });
+            stack.insert(stack.end(), node->getChildren().rbegin(), node->getChildren().rend());
+        }
+        });
+    double entityDrawTime = timeMilliseconds(iterations, [&]() {
+        entityDraws.clear();
+        entities.forEachChunk(EntityStore::Transform | EntityStore::MeshRenderer, 0, [&](const EntityStore::Chunk& chunk) {
+            for (uint32_t row = 0; row < chunk.count; ++row) {
+                entityDraws.push_back({ chunk.meshRenderers[row].mesh, transforms.getSlot(chunk.transforms[row].transformId) });
+            }
+            });
+        });
+
+    //bounds: world boxes of the moving entities
+    uint32_t treeUpdated = 0, entityUpdated = 0;
+    double treeBoundsTime = timeMilliseconds(iterations, [&]() {
+        treeUpdated = 0;
+        vector<SceneObject*> stack = { nodes[0] };
+        while (!stack.empty()) {
+            SceneObject* node = stack.back();
+            stack.pop_back();
+            uint32_t id = node->getTransformId();
+            if (nodeDynamic[id]) treeBounds[treeUpdated++] = nodeMeshes[id]->localBounds.transformed(node->getWorldMatrix());
+            stack.insert(stack.end(), node->getChildren().rbegin(), node->getChildren().rend());
+        }
+        });
+    double entityBoundsTime = timeMilliseconds(iterations, [&]() {
+        entityUpdated = 0;
+        entities.forEachChunk(EntityStore::Transform | EntityStore::Bounds | EntityStore::DynamicTag, 0, [&](const EntityStore::Chunk& chunk) {
+            for (uint32_t row = 0; row < chunk.count; ++row) {
+                entityBounds[entityUpdated++] = chunk.bounds[row].localBounds.transformed(transforms.getWorldMatrix(chunk.transforms[row].transformId));
+            }
+            });
+        });
+
+    //both visit the same draws and the same moving entities, in different orders
+    auto sortedDraws = [](vector<pair<const void*, uint32_t>> draws) {
+        std::sort(draws.begin(), draws.end());
+        return draws;
+    };
+    bool passed = treeDraws.size() == entityCount && sortedDraws(treeDraws) == sortedDraws(entityDraws) && treeUpdated == entityUpdated;
+    if (!passed) checksFailed = true;
+
+    cout << "entities (" << entityCount << " entities, " << entityUpdated << " dynamic, " << EntityStore::ChunkCapacity << " per chunk)" << endl;
+    cout << "  draw list: tree walk " << treeDrawTime << " ms, entity chunks " << entityDrawTime << " ms" << endl;
+    cout << "  dynamic bounds: tree walk " << treeBoundsTime << " ms, entity chunks " << entityBoundsTime << " ms" << endl;
+    cout << "  same draws and entities: " << (passed ? "passed" : "FAILED") << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// gpuTransforms: CPU side of the GPU transform update (change tracking and level sort only) vs the
+// full CPU update, and the level by level propagation of shader_transform_propagate.wgsl replayed
+// on the CPU against the store's matrices
+
+// localMatrix() of the shader
+static glm::mat4 shaderLocalMatrix(const glm::vec3& translation, const glm::quat& q, const glm::vec3& scale) {
+    float x2 = q.x + q.x, y2 = q.y + q.y, z2 = q.z + q.z;
+    float xx = q.x * x2, yy = q.y * y2, zz = q.z * z2;
+    float xy = q.x * y2, xz = q.x * z2, yz = q.y * z2;
+    float wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+    return glm::mat4(
+        glm::vec4(1.0f - yy - zz, xy + wz, xz - wy, 0.0f) * scale.x,
+        glm::vec4(xy - wz, 1.0f - xx - zz, yz + wx, 0.0f) * scale.y,
+        glm::vec4(xz + wy, yz - wx, 1.0f - xx - yy, 0.0f) * scale.z,
+        glm::vec4(translation, 1.0f));
+}
+
+static void benchmarkGpuTransforms() {
+    const uint32_t nodeCount = 200000;
+    const int iterations = 20;
+    const uint32_t movedPerFrame = 10000;
+    vector<uint32_t> parents = makeRandomHierarchy(nodeCount, 21, 256);
+
+    mt19937 random(21);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    TransformStore cpuStore, gpuStore;
+    gpuStore.setCpuWorldMatrices(false);
+    vector<uint32_t> ids(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        glm::vec3 translation = glm::vec3(distribution(random), distribution(random), distribution(random));
+        glm::quat rotation = glm::angleAxis(distribution(random) * 3.14159f, glm::normalize(glm::vec3(distribution(random), 1.0f, distribution(random))));
+        glm::vec3 scale = glm::vec3(1.0f + 0.1f * distribution(random));
+        for (TransformStore* store : { &cpuStore, &gpuStore }) {
+            ids[i] = store->create();
+            if (parents[i] != TransformStore::InvalidIndex) store->setParent(ids[i], ids[parents[i]]);
+            store->setTranslation(ids[i], translation);
+            store->setRotation(ids[i], rotation);
+            store->setScale(ids[i], scale);
+        }
+    }
+    cpuStore.update();
+    gpuStore.update();
+
+    //frames where some nodes move
+    int frame = 0;
+    auto move = [&](TransformStore& store) {
+        for (uint32_t i = 0; i < movedPerFrame; ++i) {
+            store.setTranslation(ids[(i * 7919u + (uint32_t)frame * 31u) % nodeCount], glm::vec3((float)frame, (float)i, 0.0f));
+        }
+    };
+    double cpuTime = timeMilliseconds(iterations, [&]() { move(cpuStore); cpuStore.update(); frame++; });
+    frame = 0;
+    double gpuSideTime = timeMilliseconds(iterations, [&]() { move(gpuStore); gpuStore.update(); frame++; });
+
+    //replay of the dispatches: every level after the one before it, all slots from the locals
+    uint32_t levelCount = gpuStore.getLevelCount();
+    const vector<uint32_t>& levelStarts = gpuStore.getLevelStarts();
+    vector<glm::mat4> worlds(gpuStore.getSlotCount());
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        for (uint32_t slot = levelStarts[level]; slot < levelStarts[level + 1]; ++slot) {
+            glm::mat4 local = shaderLocalMatrix(gpuStore.getTranslations()[slot], gpuStore.getRotations()[slot], gpuStore.getScales()[slot]);
+            uint32_t parent = gpuStore.getParents()[slot];
+            worlds[slot] = parent == TransformStore::InvalidIndex ? local : worlds[parent] * local;
+        }
+    }
+    //relative to the largest element of the matrix, the products are ordered differently than in the
+    //CPU kernels and the rounding of near zero elements says nothing about the result
+    float maxError = 0.0f;
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        const glm::mat4& expected = cpuStore.getWorldMatrix(ids[i]);
+        const glm::mat4& replayed = worlds[gpuStore.getSlot(ids[i])];
+        float magnitude = 1.0f;
+        float difference = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) {
+                magnitude = std::max(magnitude, std::abs(expected[c][r]));
+                difference = std::max(difference, std::abs(expected[c][r] - replayed[c][r]));
+            }
+        }
+        maxError = std::max(maxError, difference / magnitude);
+    }
+    const float tolerance = 1e-4f;
+    bool passed = levelCount > 0 && maxError <= tolerance;
+    if (!passed) checksFailed = true;
+
+    //only the locals that were set are uploaded, not the subtrees below them
+    size_t uploadedLocals = gpuStore.getLocalChangedSlots().size();
+    bool uploadPassed = uploadedLocals > 0 && uploadedLocals <= movedPerFrame;
+    if (!uploadPassed) checksFailed = true;
+
+    cout << "gpuTransforms (" << nodeCount << " nodes in " << levelCount << " levels, " << movedPerFrame << " moved per frame)" << endl;
+    cout << "  CPU update:             " << cpuTime << " ms" << endl;
+    cout << "  CPU side of GPU update: " << gpuSideTime << " ms, " << uploadedLocals << " local transforms to upload ("
+        << cpuStore.getComputedCount() << " world matrices changed, " << (uploadPassed ? "passed" : "FAILED") << ")" << endl;
+    cout << "  level replay vs CPU matrices: max relative error " << maxError << " (" << (passed ? "passed" : "FAILED") << ")" << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// drawSort: radix sort of the 64 bit draw keys vs std::stable_sort, and the state changes of a
+// scene ordered draw list before and after sorting
+
+static void benchmarkDrawSort() {
+    const uint32_t drawCount = 100000;
+    const uint32_t materialCount = 64;
+    const uint32_t geometryCount = 2000;
+    const int iterations = 50;
+
+    //scene order: each geometry keeps one material, the draws come in random geometry order
+    mt19937 random(43);
+    uniform_real_distribution<float> depthDistribution(0.1f, 500.0f);
+    vector<uint32_t> geometryMaterials(geometryCount);
+    for (uint32_t& material : geometryMaterials) material = random() % materialCount;
+    vector<DrawSort::Packet> scenePackets(drawCount);
+    for (uint32_t i = 0; i < drawCount; ++i) {
+        uint32_t geometry = random() % geometryCount;
+        scenePackets[i].key = DrawSort::makeKey(DrawSort::Opaque, 0, geometryMaterials[geometry], geometry, depthDistribution(random));
+        scenePackets[i].draw = i;
+    }
+
+    vector<DrawSort::Packet> packets, scratch;
+    double radixTime = timeMilliseconds(iterations, [&]() {
+        packets = scenePackets;
+        DrawSort::sort(packets, scratch);
+    });
+    vector<DrawSort::Packet> reference;
+    double stdTime = timeMilliseconds(iterations, [&]() {
+        reference = scenePackets;
+        std::stable_sort(reference.begin(), reference.end(), [](const DrawSort::Packet& a, const DrawSort::Packet& b) { return a.key < b.key; });
+    });
+
+    bool passed = true;
+    for (uint32_t i = 0; i < drawCount; ++i) {
+        passed = passed && packets[i].key == reference[i].key && packets[i].draw == reference[i].draw;
+    }
+    if (!passed) checksFailed = true;
+
+    //a change is a draw whose material or geometry differs from the one before
+    auto countChanges = [](const vector<DrawSort::Packet>& order, uint32_t shift, uint32_t bits) {
+        uint32_t changes = 0;
+        uint64_t previous = ~0ull;
+        for (const DrawSort::Packet& packet : order) {
+            uint64_t field = (packet.key >> shift) & ((1ull << bits) - 1);
+            if (field != previous) changes++;
+            previous = field;
+        }
+        return changes;
+    };
+    uint32_t geometryShift = DrawSort::DepthBits;
+    uint32_t materialShift = geometryShift + DrawSort::GeometryBits;
+
+    //front to back inside each geometry group
+    uint32_t depthInversions = 0;
+    for (uint32_t i = 1; i < drawCount; ++i) {
+        bool sameGroup = (packets[i].key >> geometryShift) == (packets[i - 1].key >> geometryShift);
+        if (sameGroup && (packets[i].key & ((1ull << DrawSort::DepthBits) - 1)) < (packets[i - 1].key & ((1ull << DrawSort::DepthBits) - 1))) depthInversions++;
+    }
+    passed = passed && depthInversions == 0;
+    if (!passed) checksFailed = true;
+
+    cout << "drawSort (" << drawCount << " draws, " << materialCount << " materials, " << geometryCount << " geometries)" << endl;
+    cout << "  radix sort:       " << radixTime << " ms" << endl;
+    cout << "  std::stable_sort: " << stdTime << " ms" << endl;
+    cout << "  scene order: " << countChanges(scenePackets, materialShift, DrawSort::MaterialBits) << " material changes, "
+        << countChanges(scenePackets, geometryShift, DrawSort::GeometryBits) << " geometry changes" << endl;
+    cout << "  sorted:      " << countChanges(packets, materialShift, DrawSort::MaterialBits) << " material changes, "
+        << countChanges(packets, geometryShift, DrawSort::GeometryBits) << " geometry changes ("
+        << (passed ? "same order as std::stable_sort, front to back" : "FAILED") << ")" << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// benchmarkRun: the config parsing, camera path sampling and percentiles of the App benchmark mode
+// against values worked out by hand, and the cost of summarizing a long run
+
+static void benchmarkBenchmarkRun() {
+    const char* configText = R"({
+        "model": "scene.gltf",
+        "presentMode": "mailbox",
+        "warmupFrames": 10,
+        "frames": 5,
+        "camera": [
+            { "time": 2.0, "position": [10, 0, 0], "target": [0, 0, 10] },
+            { "time": 0.0, "position": [0, 0, 0], "target": [0, 0, 0] }
+        ]
+    })";
+
+    BenchmarkRun::Config config;
+    string error;
+    bool passed = BenchmarkRun::parseConfig(configText, config, error);
+    passed = passed && config.model == "scene.gltf" && config.presentMode == BenchmarkRun::PresentMode::Mailbox
+        && config.warmupFrames == 10 && config.frames == 5 && config.output == "benchmark"
+        && config.camera.size() == 2 && config.camera[0].time == 0.0f;
+    BenchmarkRun::Config invalid;
+    passed = passed && !BenchmarkRun::parseConfig(R"({ "presentMode": "vsync" })", invalid, error)
+        && !BenchmarkRun::parseConfig(R"({ "frames": -1 })", invalid, error)
+        && !BenchmarkRun::parseConfig("[]", invalid, error);
+
+    //the warm-up stays on the first keyframe, the 5 measured frames are at 0, 1/4 ... 1 of the path
+    BenchmarkRun run;
+    run.begin(config);
+    vector<float> cameraX;
+    while (!run.isFinished()) {
+        cameraX.push_back(run.getCamera().position.x);
+        run.recordCpuTime(1.0);
+    }
+    const float expectedX[] = { 0.0f, 2.5f, 5.0f, 7.5f, 10.0f };
+    passed = passed && cameraX.size() == 15;
+    for (uint32_t i = 0; i < 5 && passed; ++i) {
+        passed = cameraX[i] == 0.0f && std::abs(cameraX[10 + i] - expectedX[i]) < 1e-5f;
+    }
+
+    //1 to 100 ms, nearest rank percentiles are the values themselves; frames without GPU time are skipped
+    vector<double> values(100);
+    for (uint32_t i = 0; i < 100; ++i) values[i] = 100.0 - i;
+    values.push_back(-1.0);
+    BenchmarkRun::Summary summary = BenchmarkRun::summarize(values);
+    passed = passed && summary.count == 100 && summary.p50 == 50.0 && summary.p95 == 95.0 && summary.p99 == 99.0
+        && summary.min == 1.0 && summary.max == 100.0 && summary.mean == 50.5;
+    if (!passed) checksFailed = true;
+
+    const uint32_t frameCount = 100000;
+    const int iterations = 20;
+    mt19937 random(44);
+    lognormal_distribution<double> frameTimes(2.0, 0.3);
+    vector<double> frames(frameCount);
+    for (double& frame : frames) frame = frameTimes(random);
+    double summarizeTime = timeMilliseconds(iterations, [&]() {
+        summary = BenchmarkRun::summarize(frames);
+    });
+
+    cout << "benchmarkRun (" << frameCount << " frames)" << endl;
+    cout << "  summary: " << summarizeTime << " ms (p50 " << summary.p50 << ", p95 " << summary.p95 << ", p99 " << summary.p99 << " ms)" << endl;
+    cout << "  config, camera path and percentiles " << (passed ? "match" : "FAILED") << endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    vector<pair<string, std::function<void()>>> benchmarks = {
+        { "transforms", benchmarkTransforms },
+        { "dirtyTransforms", benchmarkDirtyTransforms },
+        { "transformKernels", benchmarkTransformKernels },
+        { "parallelTransforms", benchmarkParallelTransforms },
+        { "jobSystem", benchmarkJobSystem },
+        { "frameAllocations", benchmarkFrameAllocations },
+        { "sceneBvh", benchmarkSceneBvh },
+        { "raycast", benchmarkRaycast },
+        { "occlusion", benchmarkOcclusion },
+        { "frustumCulling", benchmarkFrustumCulling },
+        { "sceneAllocation", benchmarkSceneAllocation },
+        { "entities", benchmarkEntities },
+        { "gpuTransforms", benchmarkGpuTransforms },
+        { "drawSort", benchmarkDrawSort },
+        { "benchmarkRun", benchmarkBenchmarkRun },
+    };
+
+    for (const auto& benchmark : benchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            if (benchmark.first == argv[i]) selected = true;
+        }
+        if (selected) benchmark.second();
+    }
+
+    return checksFailed ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+
+float AABB::getSurfaceArea() const
+{
+	if (isEmpty()) return 0.0f;
+	glm::vec3 size = this->max - this->min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool AABB::overlaps(const AABB& box) const
+{
+	return this->min.x <= box.max.x && this->max.x >= box.min.x
+		&& this->min.y <= box.max.y && this->max.y >= box.min.y
+		&& this->min.z <= box.max.z && this->max.z >= box.min.z;
+}
+
+AABB AABB::transformed(const glm::mat4& matrix) const
+{
+	if (isEmpty()) return AABB();
+
+	//the extents along each new axis are the absolute values of the rotated and scaled extents
+	glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+	glm::vec3 extents = getExtents();
+	glm::vec3 newExtents = glm::abs(glm::vec3(matrix[0])) * extents.x
+		+ glm::abs(glm::vec3(matrix[1])) * extents.y
+		+ glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+	return AABB(center - newExtents, center + newExtents);
+}
+
+Sphere Sphere::transformed(const glm::mat4& matrix) const
+{
+	float scale = glm::sqrt(glm::max(glm::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+		glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))), glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+	return Sphere(glm::vec3(matrix * glm::vec4(this->center, 1.0f)), this->radius * scale);
+}
+
+Ray::Ray(const glm::vec3& origin, const glm::vec3& direction)
+{
+	this->origin = origin;
+	this->direction = direction;
+	//an axis parallel ray gets an infinite inverse, which the slab test handles
+	this->inverseDirection = glm::vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+}
+
+float Ray::intersect(const AABB& box, float maxDistance) const
+{
+	glm::vec3 t0 = (box.min - this->origin) * this->inverseDirection;
+	glm::vec3 t1 = (box.max - this->origin) * this->inverseDirection;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+
+	float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+	return entry <= exit ? entry : FLT_MAX;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+	//rows of the matrix, glm stores columns
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i) {
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];	//left
+	frustum.planes[1] = rows[3] - rows[0];	//right
+	frustum.planes[2] = rows[3] + rows[1];	//bottom
+	frustum.planes[3] = rows[3] - rows[1];	//top
+	frustum.planes[4] = rows[2];	//near, depth goes from 0 to 1
+	frustum.planes[5] = rows[3] - rows[2];	//far
+
+	for (glm::vec4& plane : frustum.planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return frustum;
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+	glm::vec3 center = box.getCenter();
+	glm::vec3 extents = box.getExtents();
+
+	for (const glm::vec4& plane : this->planes) {
+		glm::vec3 normal = glm::vec3(plane);
+		float distance = glm::dot(normal, center) + plane.w;
+		float radius = glm::dot(glm::abs(normal), extents);
+		if (distance + radius < 0.0f) return false;
+	}
+
+	return true;
+}
+
+bool Frustum::intersects(const Sphere& sphere) const
+{
+	for (const glm::vec4& plane : this->planes) {
+		if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+	}
+
+	return true;
+}
+
+bool intersects(const AABB& box, const Sphere& sphere)
+{
+	glm::vec3 closest = glm::clamp(sphere.center, box.min, box.max);
+	glm::vec3 offset = closest - sphere.center;
+	return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cfloat>
+
+//axis aligned bounding box, an empty box has min > max so that expanding it by anything works
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	AABB() = default;
+	AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+	bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+	glm::vec3 getExtents() const { return (max - min) * 0.5f; }
+	float getSurfaceArea() const;
+
+	void expand(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+	void expand(const AABB& box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+	bool overlaps(const AABB& box) const;
+
+	AABB transformed(const glm::mat4& matrix) const;	// Box around this box after the transform
+};
+
+struct Sphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	Sphere() = default;
+	Sphere(const glm::vec3& center, float radius) : center(center), radius(radius) {}
+
+	Sphere transformed(const glm::mat4& matrix) const;	// Scaled by the largest axis scale, so it stays conservative
+};
+
+struct Ray
+{
+	glm::vec3 origin;
+	glm::vec3 direction;
+	glm::vec3 inverseDirection;	//1 / direction, precomputed for the slab test
+
+	Ray(const glm::vec3& origin, const glm::vec3& direction);
+
+	// Entry distance into the box, or FLT_MAX if the ray misses it before maxDistance
+	float intersect(const AABB& box, float maxDistance) const;
+};
+
+//six planes facing inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	static Frustum fromMatrix(const glm::mat4& viewProjection);	// Expects a [0, 1] depth range
+
+	bool intersects(const AABB& box) const;	// Conservative, boxes near the corners may pass
+	bool intersects(const Sphere& sphere) const;
+};
+
+bool intersects(const AABB& box, const Sphere& sphere);
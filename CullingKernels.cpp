@@ -0,0 +1,230 @@
+#include "CullingKernels.h"
+#include <algorithm>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#  define CULLING_KERNELS_AVX2
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define CULLING_KERNELS_SSE
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#  define CULLING_KERNELS_NEON
+#  include <arm_neon.h>
+#endif
+
+void SphereArrays::resize(size_t count)
+{
+	this->centerX.resize(count);
+	this->centerY.resize(count);
+	this->centerZ.resize(count);
+	this->radius.resize(count);
+}
+
+void SphereArrays::set(size_t index, const Sphere& sphere)
+{
+	this->centerX[index] = sphere.center.x;
+	this->centerY[index] = sphere.center.y;
+	this->centerZ[index] = sphere.center.z;
+	this->radius[index] = sphere.radius;
+}
+
+void SphereArrays::add(const Sphere& sphere)
+{
+	this->centerX.push_back(sphere.center.x);
+	this->centerY.push_back(sphere.center.y);
+	this->centerZ.push_back(sphere.center.z);
+	this->radius.push_back(sphere.radius);
+}
+
+//the SIMD paths do the same multiplies and adds in the same order (no FMA), so they agree with
+//this one exactly
+static inline CullingKernels::Result testSphere(const Frustum& frustum, const glm::vec4& wRow, float minRadiusPerW,
+	float x, float y, float z, float r)
+{
+	for (const glm::vec4& plane : frustum.planes) {
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < -r) return CullingKernels::Result::OutsideFrustum;
+	}
+	float w = wRow.x * x + wRow.y * y + wRow.z * z + wRow.w;
+	if (r < minRadiusPerW * w) return CullingKernels::Result::TooSmall;
+	return CullingKernels::Result::Visible;
+}
+
+void CullingKernels::testSpheresScalar(const Frustum& frustum, const glm::vec4& wRow, float minRadiusPerW,
+	const float* centerX, const float* centerY, const float* centerZ, const float* radius, size_t count, Result* results)
+{
+	for (size_t i = 0; i < count; ++i) {
+		results[i] = testSphere(frustum, wRow, minRadiusPerW, centerX[i], centerY[i], centerZ[i], radius[i]);
+	}
+}
+
+//lane masks of the two tests to results, outside wins over too small
+static inline void writeResults(int outsideMask, int smallMask, size_t lanes, CullingKernels::Result* results)
+{
+	for (size_t lane = 0; lane < lanes; ++lane) {
+		if (outsideMask & (1 << lane)) results[lane] = CullingKernels::Result::OutsideFrustum;
+		else if (smallMask & (1 << lane)) results[lane] = CullingKernels::Result::TooSmall;
+		else results[lane] = CullingKernels::Result::Visible;
+	}
+}
+
+void CullingKernels::testSpheres(const Frustum& frustum, const glm::vec4& wRow, float minRadiusPerW,
+	const float* centerX, const float* centerY, const float* centerZ, const float* radius, size_t count, Result* results)
+{
+	size_t i = 0;
+
+#if defined(CULLING_KERNELS_AVX2)
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(centerX + i);
+		__m256 y = _mm256_loadu_ps(centerY + i);
+		__m256 z = _mm256_loadu_ps(centerZ + i);
+		__m256 r = _mm256_loadu_ps(radius + i);
+		__m256 negativeR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+
+		__m256 outside = _mm256_setzero_ps();
+		for (const glm::vec4& plane : frustum.planes) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_set1_ps(plane.x), x), _mm256_mul_ps(_mm256_set1_ps(plane.y), y)),
+				_mm256_mul_ps(_mm256_set1_ps(plane.z), z)), _mm256_set1_ps(plane.w));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeR, _CMP_LT_OQ));
+		}
+		__m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_set1_ps(wRow.x), x), _mm256_mul_ps(_mm256_set1_ps(wRow.y), y)),
+			_mm256_mul_ps(_mm256_set1_ps(wRow.z), z)), _mm256_set1_ps(wRow.w));
+		__m256 small = _mm256_cmp_ps(r, _mm256_mul_ps(_mm256_set1_ps(minRadiusPerW), w), _CMP_LT_OQ);
+
+		writeResults(_mm256_movemask_ps(outside), _mm256_movemask_ps(small), 8, results + i);
+	}
+#elif defined(CULLING_KERNELS_SSE)
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(centerX + i);
+		__m128 y = _mm_loadu_ps(centerY + i);
+		__m128 z = _mm_loadu_ps(centerZ + i);
+		__m128 r = _mm_loadu_ps(radius + i);
+		__m128 negativeR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+		__m128 outside = _mm_setzero_ps();
+		for (const glm::vec4& plane : frustum.planes) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+				_mm_mul_ps(_mm_set1_ps(plane.z), z)), _mm_set1_ps(plane.w));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeR));
+		}
+		__m128 w = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(wRow.x), x), _mm_mul_ps(_mm_set1_ps(wRow.y), y)),
+			_mm_mul_ps(_mm_set1_ps(wRow.z), z)), _mm_set1_ps(wRow.w));
+		__m128 small = _mm_cmplt_ps(r, _mm_mul_ps(_mm_set1_ps(minRadiusPerW), w));
+
+		writeResults(_mm_movemask_ps(outside), _mm_movemask_ps(small), 4, results + i);
+	}
+#elif defined(CULLING_KERNELS_NEON)
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t x = vld1q_f32(centerX + i);
+		float32x4_t y = vld1q_f32(centerY + i);
+		float32x4_t z = vld1q_f32(centerZ + i);
+		float32x4_t r = vld1q_f32(radius + i);
+		float32x4_t negativeR = vnegq_f32(r);
+
+		uint32x4_t outside = vdupq_n_u32(0);
+		for (const glm::vec4& plane : frustum.planes) {
+			float32x4_t distance = vaddq_f32(vaddq_f32(vaddq_f32(
+				vmulq_n_f32(x, plane.x), vmulq_n_f32(y, plane.y)), vmulq_n_f32(z, plane.z)), vdupq_n_f32(plane.w));
+			outside = vorrq_u32(outside, vcltq_f32(distance, negativeR));
+		}
+		float32x4_t w = vaddq_f32(vaddq_f32(vaddq_f32(
+			vmulq_n_f32(x, wRow.x), vmulq_n_f32(y, wRow.y)), vmulq_n_f32(z, wRow.z)), vdupq_n_f32(wRow.w));
+		uint32x4_t small = vcltq_f32(r, vmulq_n_f32(w, minRadiusPerW));
+
+		int outsideMask = (vgetq_lane_u32(outside, 0) & 1) | (vgetq_lane_u32(outside, 1) & 2) | (vgetq_lane_u32(outside, 2) & 4) | (vgetq_lane_u32(outside, 3) & 8);
+		int smallMask = (vgetq_lane_u32(small, 0) & 1) | (vgetq_lane_u32(small, 1) & 2) | (vgetq_lane_u32(small, 2) & 4) | (vgetq_lane_u32(small, 3) & 8);
+		writeResults(outsideMask, smallMask, 4, results + i);
+	}
+#endif
+
+	testSpheresScalar(frustum, wRow, minRadiusPerW, centerX + i, centerY + i, centerZ + i, radius + i, count - i, results + i);
+}
+
+AABB CullingKernels::computeBoundsScalar(const float* positions, size_t vertexCount)
+{
+	AABB bounds;
+	for (size_t i = 0; i < vertexCount; ++i) {
+		bounds.expand(glm::vec3(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]));
+	}
+	return bounds;
+}
+
+AABB CullingKernels::computeBounds(const float* positions, size_t vertexCount)
+{
+	AABB bounds;
+	size_t i = 0;
+
+#if defined(CULLING_KERNELS_SSE) || defined(CULLING_KERNELS_AVX2)
+	//four vertices are three registers: (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3), every lane keeps
+	//the same coordinate for the whole loop and the lanes are regrouped at the end
+	if (vertexCount >= 4) {
+		__m128 min0 = _mm_loadu_ps(positions), max0 = min0;
+		__m128 min1 = _mm_loadu_ps(positions + 4), max1 = min1;
+		__m128 min2 = _mm_loadu_ps(positions + 8), max2 = min2;
+		for (i = 4; i + 4 <= vertexCount; i += 4) {
+			const float* block = positions + 3 * i;
+			__m128 a = _mm_loadu_ps(block);
+			__m128 b = _mm_loadu_ps(block + 4);
+			__m128 c = _mm_loadu_ps(block + 8);
+			min0 = _mm_min_ps(min0, a);
+			max0 = _mm_max_ps(max0, a);
+			min1 = _mm_min_ps(min1, b);
+			max1 = _mm_max_ps(max1, b);
+			min2 = _mm_min_ps(min2, c);
+			max2 = _mm_max_ps(max2, c);
+		}
+
+		alignas(16) float lanes[6][4];
+		_mm_store_ps(lanes[0], min0);
+		_mm_store_ps(lanes[1], min1);
+		_mm_store_ps(lanes[2], min2);
+		_mm_store_ps(lanes[3], max0);
+		_mm_store_ps(lanes[4], max1);
+		_mm_store_ps(lanes[5], max2);
+		for (int side = 0; side < 2; ++side) {
+			float(*l)[4] = lanes + 3 * side;
+			glm::vec3 value(
+				side == 0 ? std::min({ l[0][0], l[0][3], l[1][2], l[2][1] }) : std::max({ l[0][0], l[0][3], l[1][2], l[2][1] }),
+				side == 0 ? std::min({ l[0][1], l[1][0], l[1][3], l[2][2] }) : std::max({ l[0][1], l[1][0], l[1][3], l[2][2] }),
+				side == 0 ? std::min({ l[0][2], l[1][1], l[2][0], l[2][3] }) : std::max({ l[0][2], l[1][1], l[2][0], l[2][3] }));
+			if (side == 0) bounds.min = value;
+			else bounds.max = value;
+		}
+	}
+#elif defined(CULLING_KERNELS_NEON)
+	//vld3 splits four vertices into x, y and z registers
+	if (vertexCount >= 4) {
+		float32x4x3_t first = vld3q_f32(positions);
+		float32x4_t minX = first.val[0], minY = first.val[1], minZ = first.val[2];
+		float32x4_t maxX = minX, maxY = minY, maxZ = minZ;
+		for (i = 4; i + 4 <= vertexCount; i += 4) {
+			float32x4x3_t block = vld3q_f32(positions + 3 * i);
+			minX = vminq_f32(minX, block.val[0]);
+			minY = vminq_f32(minY, block.val[1]);
+			minZ = vminq_f32(minZ, block.val[2]);
+			maxX = vmaxq_f32(maxX, block.val[0]);
+			maxY = vmaxq_f32(maxY, block.val[1]);
+			maxZ = vmaxq_f32(maxZ, block.val[2]);
+		}
+
+		float lanes[6][4];
+		vst1q_f32(lanes[0], minX);
+		vst1q_f32(lanes[1], minY);
+		vst1q_f32(lanes[2], minZ);
+		vst1q_f32(lanes[3], maxX);
+		vst1q_f32(lanes[4], maxY);
+		vst1q_f32(lanes[5], maxZ);
+		for (int axis = 0; axis < 3; ++axis) {
+			bounds.min[axis] = std::min({ lanes[axis][0], lanes[axis][1], lanes[axis][2], lanes[axis][3] });
+			bounds.max[axis] = std::max({ lanes[3 + axis][0], lanes[3 + axis][1], lanes[3 + axis][2], lanes[3 + axis][3] });
+		}
+	}
+#endif
+
+	AABB tail = computeBoundsScalar(positions + 3 * i, vertexCount - i);
+	bounds.expand(tail);
+	return bounds;
+}
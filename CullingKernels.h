@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+
+//bounding spheres as structure of arrays, the layout the culling kernels read several spheres at once from
+struct SphereArrays
+{
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	size_t size() const { return radius.size(); }
+	void resize(size_t count);
+	void set(size_t index, const Sphere& sphere);
+	void add(const Sphere& sphere);
+};
+
+//batched culling kernels, the SIMD path is picked at compile time like the transform kernels:
+//eight spheres per instruction with AVX2, four with SSE or NEON
+class CullingKernels
+{
+public:
+	enum class Result : uint8_t {
+		Visible,
+		OutsideFrustum,
+		TooSmall,	//inside the frustum but below the screen coverage threshold
+	};
+
+	// A sphere is too small when radius < minRadiusPerW * w, where w = dot(wRow, (center, 1)) is its
+	// clip space w, i.e. the fourth row of the view projection matrix (0 disables the test)
+	static void testSpheres(const Frustum& frustum, const glm::vec4& wRow, float minRadiusPerW,
+		const float* centerX, const float* centerY, const float* centerZ, const float* radius, size_t count, Result* results);
+	static void testSpheresScalar(const Frustum& frustum, const glm::vec4& wRow, float minRadiusPerW,
+		const float* centerX, const float* centerY, const float* centerZ, const float* radius, size_t count, Result* results);
+
+	// Box around tightly packed xyz positions
+	static AABB computeBounds(const float* positions, size_t vertexCount);
+	static AABB computeBoundsScalar(const float* positions, size_t vertexCount);
+};
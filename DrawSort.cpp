@@ -0,0 +1,59 @@
+#include "DrawSort.h"
+#include <cstring>
+#include <utility>
+
+static_assert(4 + 4 + DrawSort::MaterialBits + DrawSort::GeometryBits + DrawSort::DepthBits == 64, "DrawSort key fields must fill 64 bits");
+
+uint64_t DrawSort::makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t geometry, float viewDepth)
+{
+	uint64_t key = pass & 0xFu;
+	key = (key << 4) | (pipeline & 0xFu);
+	key = (key << MaterialBits) | (material & ((1u << MaterialBits) - 1));
+	key = (key << GeometryBits) | (geometry & ((1u << GeometryBits) - 1));
+	key = (key << DepthBits) | quantizeDepth(viewDepth);
+	return key;
+}
+
+uint32_t DrawSort::quantizeDepth(float viewDepth)
+{
+	//the bits of a positive float grow with its value, the top 24 of the 31 keep the exponent and
+	//16 bits of mantissa, a relative precision that does not need the near and far planes
+	if (!(viewDepth > 0.0f)) return 0;
+	uint32_t bits;
+	std::memcpy(&bits, &viewDepth, sizeof(bits));
+	return bits >> (31 - DepthBits);
+}
+
+void DrawSort::sort(std::vector<Packet>& packets, std::vector<Packet>& scratch)
+{
+	size_t count = packets.size();
+	if (count < 2) return;
+	scratch.resize(count);
+
+	//one read of the keys builds the histograms of all 8 bytes
+	uint32_t histograms[8][256] = {};
+	for (const Packet& packet : packets) {
+		uint64_t key = packet.key;
+		for (int byte = 0; byte < 8; ++byte) {
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	for (int byte = 0; byte < 8; ++byte) {
+		uint32_t* histogram = histograms[byte];
+		if (histogram[(packets[0].key >> (byte * 8)) & 0xFF] == count) continue;
+
+		uint32_t offset = 0;
+		for (int digit = 0; digit < 256; ++digit) {
+			uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (const Packet& packet : packets) {
+			scratch[histogram[(packet.key >> (byte * 8)) & 0xFF]++] = packet;
+		}
+		//the sorted packets are always in `packets` after a pass, swapping the vectors is free
+		std::swap(packets, scratch);
+	}
+}
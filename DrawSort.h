@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//draw packets ordered by a 64 bit key, most significant field first:
+//  pass (4 bits) | pipeline (4) | material (16) | geometry (16) | depth (24)
+//so the draws of a pass are grouped by pipeline, then by material bind group, then by geometry
+//buffers, and each group is drawn front to back for early depth rejection
+class DrawSort
+{
+public:
+	enum Pass : uint32_t {
+		Opaque = 0,
+	};
+
+	// Key and index of one draw, sorted instead of the draws themselves
+	struct Packet {
+		uint64_t key = 0;
+		uint32_t draw = 0;
+		uint32_t padding = 0;
+	};
+
+	static constexpr uint32_t MaterialBits = 16;
+	static constexpr uint32_t GeometryBits = 16;
+	static constexpr uint32_t DepthBits = 24;
+
+	// Ids above the range of their field wrap around, which only costs grouping
+	static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t geometry, float viewDepth);
+	static uint32_t quantizeDepth(float viewDepth);	// Monotonic in the depth, everything behind the camera is 0
+
+	// Stable least significant digit radix sort on the keys, a byte at a time; bytes that are the same
+	// in every key are skipped, so a frame with a single pipeline pays for 6 passes instead of 8
+	static void sort(std::vector<Packet>& packets, std::vector<Packet>& scratch);
+};
@@ -0,0 +1,134 @@
+#include "EntityStore.h"
+
+uint32_t EntityStore::create(uint32_t components)
+{
+	uint32_t entity;
+	if (!this->freeIds.empty()) {
+		entity = this->freeIds.back();
+		this->freeIds.pop_back();
+	}
+	else {
+		entity = (uint32_t)this->locations.size();
+		this->locations.push_back(Location());
+	}
+
+	this->locations[entity] = addRow(findArchetype(components), entity);
+	this->entityCount++;
+	return entity;
+}
+
+void EntityStore::destroy(uint32_t entity)
+{
+	removeRow(this->locations[entity]);
+	this->locations[entity] = Location();
+	this->freeIds.push_back(entity);
+	this->entityCount--;
+}
+
+void EntityStore::setComponents(uint32_t entity, uint32_t components)
+{
+	Location from = this->locations[entity];
+	uint32_t archetype = findArchetype(components);
+	if (archetype == from.archetype) return;
+
+	Location to = addRow(archetype, entity);
+	Chunk& source = getChunk(from);
+	Chunk& destination = getChunk(to);
+	if (source.transforms && destination.transforms) destination.transforms[to.row] = source.transforms[from.row];
+	if (source.meshRenderers && destination.meshRenderers) destination.meshRenderers[to.row] = source.meshRenderers[from.row];
+	if (source.bounds && destination.bounds) destination.bounds[to.row] = source.bounds[from.row];
+
+	removeRow(from);
+	this->locations[entity] = to;
+}
+
+void EntityStore::clear()
+{
+	this->archetypes.clear();
+	this->locations.clear();
+	this->freeIds.clear();
+	this->entityCount = 0;
+}
+
+TransformComponent* EntityStore::getTransform(uint32_t entity)
+{
+	const Location& location = this->locations[entity];
+	Chunk& chunk = getChunk(location);
+	return chunk.transforms ? &chunk.transforms[location.row] : nullptr;
+}
+
+MeshRendererComponent* EntityStore::getMeshRenderer(uint32_t entity)
+{
+	const Location& location = this->locations[entity];
+	Chunk& chunk = getChunk(location);
+	return chunk.meshRenderers ? &chunk.meshRenderers[location.row] : nullptr;
+}
+
+BoundsComponent* EntityStore::getBounds(uint32_t entity)
+{
+	const Location& location = this->locations[entity];
+	Chunk& chunk = getChunk(location);
+	return chunk.bounds ? &chunk.bounds[location.row] : nullptr;
+}
+
+uint32_t EntityStore::findArchetype(uint32_t components)
+{
+	for (size_t i = 0; i < this->archetypes.size(); ++i) {
+		if (this->archetypes[i].components == components) return (uint32_t)i;
+	}
+
+	Archetype archetype;
+	archetype.components = components;
+	this->archetypes.push_back(std::move(archetype));
+	return (uint32_t)this->archetypes.size() - 1;
+}
+
+EntityStore::Location EntityStore::addRow(uint32_t archetypeIndex, uint32_t entity)
+{
+	Archetype& archetype = this->archetypes[archetypeIndex];
+	if (archetype.chunks.empty() || archetype.chunks.back()->count == ChunkCapacity) {
+		std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>();
+		chunk->components = archetype.components;
+		chunk->entities = std::make_unique<uint32_t[]>(ChunkCapacity);
+		if (archetype.components & Transform) chunk->transforms = std::make_unique<TransformComponent[]>(ChunkCapacity);
+		if (archetype.components & MeshRenderer) chunk->meshRenderers = std::make_unique<MeshRendererComponent[]>(ChunkCapacity);
+		if (archetype.components & Bounds) chunk->bounds = std::make_unique<BoundsComponent[]>(ChunkCapacity);
+		archetype.chunks.push_back(std::move(chunk));
+	}
+
+	Location location;
+	location.archetype = archetypeIndex;
+	location.chunk = (uint32_t)archetype.chunks.size() - 1;
+	Chunk& chunk = *archetype.chunks.back();
+	location.row = chunk.count++;
+
+	//rows are reused, so the components start from their defaults again
+	chunk.entities[location.row] = entity;
+	if (chunk.transforms) chunk.transforms[location.row] = TransformComponent();
+	if (chunk.meshRenderers) chunk.meshRenderers[location.row] = MeshRendererComponent();
+	if (chunk.bounds) chunk.bounds[location.row] = BoundsComponent();
+	return location;
+}
+
+void EntityStore::removeRow(const Location& location)
+{
+	Archetype& archetype = this->archetypes[location.archetype];
+	Chunk& chunk = getChunk(location);
+	Chunk& last = *archetype.chunks.back();
+	uint32_t lastRow = last.count - 1;
+
+	//keeps the chunks packed, only the moved entity changes place
+	if (&chunk != &last || location.row != lastRow) {
+		uint32_t moved = last.entities[lastRow];
+		chunk.entities[location.row] = moved;
+		if (chunk.transforms) chunk.transforms[location.row] = last.transforms[lastRow];
+		if (chunk.meshRenderers) chunk.meshRenderers[location.row] = last.meshRenderers[lastRow];
+		if (chunk.bounds) chunk.bounds[location.row] = last.bounds[lastRow];
+		this->locations[moved] = location;
+	}
+
+	last.count--;
+	if (last.count == 0) {
+		archetype.chunks.pop_back();
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Bounds.h"
+#include "TransformStore.h"
+
+class Mesh;
+
+//components, each kind lives in its own packed array inside the chunks
+struct TransformComponent {
+	uint32_t transformId = TransformStore::InvalidIndex;	//node in the TransformStore
+};
+
+struct MeshRendererComponent {
+	Mesh* mesh = nullptr;
+};
+
+struct BoundsComponent {
+	AABB localBounds;	//model space, copied from the mesh so that the bounds system never touches it
+	Sphere localSphere;
+};
+
+//entities grouped by archetype, the set of components they have: every archetype stores its entities
+//in fixed size chunks with one packed array per component, so a system only streams through the
+//arrays it needs and skips whole archetypes it does not care about, e.g. static geometry
+//the static and dynamic tags have no data, they only select the archetype
+class EntityStore
+{
+public:
+	static constexpr uint32_t InvalidEntity = 0xFFFFFFFFu;
+	static constexpr uint32_t ChunkCapacity = 1024;
+
+	enum Components : uint32_t {
+		Transform = 1 << 0,
+		MeshRenderer = 1 << 1,
+		Bounds = 1 << 2,
+		StaticTag = 1 << 3,	//never moves after loading, its bounds are computed once
+		DynamicTag = 1 << 4,
+	};
+
+	//rows of one archetype, the arrays of components the archetype does not have are null
+	struct Chunk {
+		uint32_t components = 0;
+		uint32_t count = 0;
+		std::unique_ptr<uint32_t[]> entities;
+		std::unique_ptr<TransformComponent[]> transforms;
+		std::unique_ptr<MeshRendererComponent[]> meshRenderers;
+		std::unique_ptr<BoundsComponent[]> bounds;
+	};
+
+	uint32_t create(uint32_t components);	// Returns the id of a new entity with default constructed components
+	void destroy(uint32_t entity);
+	void setComponents(uint32_t entity, uint32_t components);	// Moves the entity to another archetype, keeping the components both have
+	void clear();
+
+	uint32_t getComponents(uint32_t entity) const { return archetypes[locations[entity].archetype].components; }
+	TransformComponent* getTransform(uint32_t entity);	// Null when the entity has no such component
+	MeshRendererComponent* getMeshRenderer(uint32_t entity);
+	BoundsComponent* getBounds(uint32_t entity);
+	size_t getEntityCount() const { return entityCount; }
+
+	// Calls function(chunk) for every chunk whose archetype has all the `required` components and none
+	// of the `excluded` ones, archetypes in creation order and rows in creation order unless entities were destroyed
+	template<typename Function>
+	void forEachChunk(uint32_t required, uint32_t excluded, const Function& function)
+	{
+		for (Archetype& archetype : archetypes) {
+			if ((archetype.components & required) != required || (archetype.components & excluded) != 0) continue;
+			for (std::unique_ptr<Chunk>& chunk : archetype.chunks) {
+				function(*chunk);
+			}
+		}
+	}
+
+private:
+	struct Archetype {
+		uint32_t components = 0;
+		std::vector<std::unique_ptr<Chunk>> chunks;	//every chunk but the last one is full
+	};
+
+	struct Location {
+		uint32_t archetype = InvalidEntity;
+		uint32_t chunk = 0;
+		uint32_t row = 0;
+	};
+
+	uint32_t findArchetype(uint32_t components);	// Creates it on first use
+	Location addRow(uint32_t archetype, uint32_t entity);
+	void removeRow(const Location& location);	// The last row of the archetype moves into the hole
+	Chunk& getChunk(const Location& location) { return *archetypes[location.archetype].chunks[location.chunk]; }
+
+	std::vector<Archetype> archetypes;
+	std::vector<Location> locations;	//indexed by entity id
+	std::vector<uint32_t> freeIds;
+	size_t entityCount = 0;
+};
@@ -0,0 +1,102 @@
+#include "FilteredRenderPass.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace wgpu;
+
+void FilteredRenderPass::begin(RenderPassEncoder encoder)
+{
+	this->encoder = encoder;
+	forgetState();
+}
+
+void FilteredRenderPass::forgetState()
+{
+	this->pipeline = nullptr;
+	std::fill(std::begin(this->bindGroups), std::end(this->bindGroups), BoundGroup());
+	std::fill(std::begin(this->vertexBuffers), std::end(this->vertexBuffers), BoundBuffer());
+	this->indexBuffer = BoundBuffer();
+	this->indexFormat = IndexFormat::Undefined;
+}
+
+void FilteredRenderPass::end()
+{
+	this->encoder.end();
+	this->encoder.release();
+	this->encoder = nullptr;
+}
+
+void FilteredRenderPass::executeBundles(uint32_t bundleCount, const RenderBundle* bundles)
+{
+	this->encoder.executeBundles(bundleCount, bundles);
+	//bundles do not inherit the state of the pass and leave it reset behind them
+	forgetState();
+}
+
+bool FilteredRenderPass::elide(bool unchanged)
+{
+	if (this->filtering && unchanged) {
+		this->counters.elided++;
+		return true;
+	}
+	this->counters.issued++;
+	return false;
+}
+
+void FilteredRenderPass::setPipeline(RenderPipeline pipeline)
+{
+	if (elide(this->pipeline == pipeline)) return;
+
+	this->encoder.setPipeline(pipeline);
+	this->pipeline = pipeline;
+}
+
+void FilteredRenderPass::setBindGroup(uint32_t group, BindGroup bindGroup, uint32_t dynamicOffsetCount, const uint32_t* dynamicOffsets)
+{
+	//groups out of range are passed on and left to the validation of the encoder
+	if (group >= MaxBindGroups || dynamicOffsetCount > MaxDynamicOffsets) {
+		elide(false);
+		this->encoder.setBindGroup(group, bindGroup, dynamicOffsetCount, dynamicOffsets);
+		if (group < MaxBindGroups) this->bindGroups[group] = BoundGroup();
+		return;
+	}
+
+	BoundGroup& bound = this->bindGroups[group];
+	bool unchanged = bound.bindGroup == bindGroup && bound.dynamicOffsetCount == dynamicOffsetCount
+		&& std::equal(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, bound.dynamicOffsets);
+	if (elide(unchanged)) return;
+
+	this->encoder.setBindGroup(group, bindGroup, dynamicOffsetCount, dynamicOffsets);
+	bound.bindGroup = bindGroup;
+	bound.dynamicOffsetCount = dynamicOffsetCount;
+	std::copy(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, bound.dynamicOffsets);
+}
+
+void FilteredRenderPass::setVertexBuffer(uint32_t slot, Buffer buffer, uint64_t offset, uint64_t size)
+{
+	if (slot >= MaxVertexBuffers) {
+		elide(false);
+		this->encoder.setVertexBuffer(slot, buffer, offset, size);
+		return;
+	}
+
+	BoundBuffer& bound = this->vertexBuffers[slot];
+	if (elide(bound.buffer == buffer && bound.offset == offset && bound.size == size)) return;
+
+	this->encoder.setVertexBuffer(slot, buffer, offset, size);
+	bound.buffer = buffer;
+	bound.offset = offset;
+	bound.size = size;
+}
+
+void FilteredRenderPass::setIndexBuffer(Buffer buffer, IndexFormat format, uint64_t offset, uint64_t size)
+{
+	BoundBuffer& bound = this->indexBuffer;
+	if (elide(bound.buffer == buffer && this->indexFormat == format && bound.offset == offset && bound.size == size)) return;
+
+	this->encoder.setIndexBuffer(buffer, format, offset, size);
+	bound.buffer = buffer;
+	bound.offset = offset;
+	bound.size = size;
+	this->indexFormat = format;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+//thin wrapper around a RenderPassEncoder that remembers the bound pipeline, bind groups with their
+//dynamic offsets, vertex buffers and index buffer, and drops the calls that would bind them again;
+//every state call is counted as issued or elided so the API overhead of a frame can be measured
+class FilteredRenderPass
+{
+public:
+	static constexpr uint32_t MaxBindGroups = 4;
+	static constexpr uint32_t MaxDynamicOffsets = 4;	//per bind group, more are never filtered
+	static constexpr uint32_t MaxVertexBuffers = 8;
+
+	struct Counters {
+		uint32_t issued = 0;	//state calls passed on to the encoder
+		uint32_t elided = 0;	//state calls dropped because nothing changed
+	};
+
+	void begin(wgpu::RenderPassEncoder encoder);	// Starts filtering a new pass, nothing is bound in it yet
+	void end();	// Ends and releases the encoder
+
+	void setFiltering(bool filtering) { this->filtering = filtering; }	// When off every call is passed on, still counted
+	bool isFiltering() const { return filtering; }
+	const Counters& getCounters() const { return counters; }	// Sums of every pass since the last reset
+	void resetCounters() { counters = Counters(); }
+
+	void setPipeline(wgpu::RenderPipeline pipeline);
+	void setBindGroup(uint32_t group, wgpu::BindGroup bindGroup, uint32_t dynamicOffsetCount, const uint32_t* dynamicOffsets);
+	void setVertexBuffer(uint32_t slot, wgpu::Buffer buffer, uint64_t offset, uint64_t size);
+	void setIndexBuffer(wgpu::Buffer buffer, wgpu::IndexFormat format, uint64_t offset, uint64_t size);
+
+	void executeBundles(uint32_t bundleCount, const wgpu::RenderBundle* bundles);	// The pass has nothing bound afterwards
+
+	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) {
+		encoder.drawIndexed(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+	}
+	void drawIndexedIndirect(wgpu::Buffer indirectBuffer, uint64_t indirectOffset) {
+		encoder.drawIndexedIndirect(indirectBuffer, indirectOffset);
+	}
+
+private:
+	struct BoundGroup {
+		wgpu::BindGroup bindGroup = nullptr;
+		uint32_t dynamicOffsetCount = 0;
+		uint32_t dynamicOffsets[MaxDynamicOffsets] = {};
+	};
+
+	struct BoundBuffer {
+		wgpu::Buffer buffer = nullptr;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	bool elide(bool unchanged);	// Counts the call, true when it can be dropped
+	void forgetState();
+
+	wgpu::RenderPassEncoder encoder = nullptr;
+	bool filtering = true;
+	Counters counters;
+
+	//what the pass has bound, handles are only compared, the pass keeps them alive until it ends
+	wgpu::RenderPipeline pipeline = nullptr;
+	BoundGroup bindGroups[MaxBindGroups];
+	BoundBuffer vertexBuffers[MaxVertexBuffers];
+	BoundBuffer indexBuffer;
+	wgpu::IndexFormat indexFormat = wgpu::IndexFormat::Undefined;
+};
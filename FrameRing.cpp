@@ -0,0 +1,152 @@
+#include "FrameRing.h"
+#include "ResourceTracker.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace wgpu;
+
+bool FrameRing::initialize(Device device, uint32_t frameCount, uint64_t slotSize)
+{
+	this->device = device;
+	this->slotSize = slotSize;
+
+	//every slot starts mapped, the first frames do not wait
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.label = "Frame Upload Buffer";
+	bufferDescriptor.size = slotSize;
+	bufferDescriptor.usage = BufferUsage::MapWrite | BufferUsage::CopySrc;
+	bufferDescriptor.mappedAtCreation = true;
+
+	for (uint32_t i = 0; i < frameCount; ++i) {
+		std::unique_ptr<Slot> slot(new Slot());
+		slot->buffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Staging);
+		if (!slot->buffer) return false;
+		slot->mapped = true;
+		this->slots.push_back(std::move(slot));
+	}
+
+	//the first beginFrame moves to slot 0
+	this->frameIndex = frameCount - 1;
+	return frameCount > 0;
+}
+
+void FrameRing::terminate()
+{
+	//a fence or map that has not called back yet still points to its slot, so they are waited for
+	//first; a lost device reports both with an error status, the timeout only guards a stuck backend
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	auto isPending = [this]() {
+		for (const std::unique_ptr<Slot>& slot : this->slots) {
+			if (slot->inFlight || slot->mapping) return true;
+		}
+		return false;
+		};
+	while (isPending() && std::chrono::high_resolution_clock::now() - waitStart < std::chrono::seconds(5)) {
+		this->tick();
+	}
+
+	for (std::unique_ptr<Slot>& slot : this->slots) {
+		ResourceTracker::destroyBuffer(slot->buffer);
+	}
+	this->slots.clear();
+	this->copies.clear();
+	this->device = nullptr;
+	this->data = nullptr;
+	this->cursor = 0;
+}
+
+void FrameRing::tick()
+{
+	//the callbacks only run from device ticks
+#if defined(WEBGPU_BACKEND_DAWN)
+	this->device.tick();
+#elif defined(WEBGPU_BACKEND_WGPU)
+	wgpuDevicePoll(this->device, false, nullptr);
+#endif
+	std::this_thread::yield();
+}
+
+void FrameRing::beginFrame()
+{
+	this->frameIndex = (this->frameIndex + 1) % (uint32_t)this->slots.size();
+	this->cursor = 0;
+	this->uploadedBytes = 0;
+	this->overflowBytes = 0;
+	this->copies.clear();
+
+	//the map is requested only after the fence, mapping a buffer the GPU still copies from would fail
+	Slot* slot = this->slots[this->frameIndex].get();
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	while (slot->inFlight) {
+		this->tick();
+	}
+	if (!slot->mapped && !slot->mapping) {
+		slot->mapping = true;
+		wgpuBufferMapAsync(slot->buffer, WGPUMapMode_Write, 0, this->slotSize, &FrameRing::onMapped, slot);
+	}
+	while (slot->mapping) {
+		this->tick();
+	}
+	auto waitEnd = std::chrono::high_resolution_clock::now();
+	this->waitMilliseconds = std::chrono::duration<double, std::milli>(waitEnd - waitStart).count();
+
+	//a failed map leaves the slot unmapped, the frame then writes everything directly
+	this->data = slot->mapped ? (uint8_t*)slot->buffer.getMappedRange(0, this->slotSize) : nullptr;
+}
+
+void FrameRing::endFrame(Queue queue)
+{
+	Slot* slot = this->slots[this->frameIndex].get();
+	if (slot->mapped) {
+		//a frame that never flushed recorded no copies
+		slot->buffer.unmap();
+		slot->mapped = false;
+	}
+	this->data = nullptr;
+
+	slot->inFlight = true;
+	wgpuQueueOnSubmittedWorkDone(queue, &FrameRing::onWorkDone, slot);
+}
+
+void FrameRing::onMapped(WGPUBufferMapAsyncStatus status, void* userdata)
+{
+	Slot* slot = (Slot*)userdata;
+	slot->mapped = status == WGPUBufferMapAsyncStatus_Success;
+	slot->mapping = false;
+}
+
+void FrameRing::onWorkDone(WGPUQueueWorkDoneStatus /*status*/, void* userdata)
+{
+	//an error or a lost device never gets the work done, waiting on it would hang
+	Slot* slot = (Slot*)userdata;
+	slot->inFlight = false;
+}
+
+void FrameRing::upload(Queue queue, Buffer destination, uint64_t destinationOffset, const void* data, uint64_t size)
+{
+	if (!this->data || this->cursor + size > this->slotSize) {
+		queue.writeBuffer(destination, destinationOffset, data, size);
+		this->overflowBytes += size;
+		return;
+	}
+
+	memcpy(this->data + this->cursor, data, size);
+	this->copies.push_back({ this->cursor, destination, destinationOffset, size });
+	this->cursor += (size + 3) & ~(uint64_t)3;
+	this->uploadedBytes += size;
+}
+
+void FrameRing::flush(CommandEncoder encoder)
+{
+	Slot& slot = *this->slots[this->frameIndex];
+	if (!slot.mapped) return;
+
+	//a buffer must be unmapped when the copies from it are submitted
+	slot.buffer.unmap();
+	slot.mapped = false;
+	this->data = nullptr;
+	for (const Copy& copy : this->copies) {
+		encoder.copyBufferToBuffer(slot.buffer, copy.offset, copy.destination, copy.destinationOffset, copy.size);
+	}
+}
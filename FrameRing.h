@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+
+//frames in flight: a ring of mapped upload buffers, one per frame the CPU may record ahead of the GPU
+//the per frame data of a frame is written straight into its own slot through the mapping, and the
+//slot is unmapped and copied by the frame's command buffer into the buffers the shaders bind before
+//any pass reads them, so no byte goes through the queue's own staging and the bind groups (and the
+//render bundles recorded with them) stay the same; once queue.onSubmittedWorkDone reported the frame
+//that used a slot it is mapped again, and the time spent waiting for both is how far the CPU got
+//ahead of the GPU
+class FrameRing
+{
+public:
+	static constexpr uint32_t DefaultFrameCount = 3;
+
+	bool initialize(wgpu::Device device, uint32_t frameCount, uint64_t slotSize);
+	void terminate();	// Waits for the fences and maps still pending
+
+	void beginFrame();	// Moves to the next slot, waits until the GPU is done with it and it is mapped
+	void endFrame(wgpu::Queue queue);	// After the submit, the slot is fenced by the work submitted so far
+
+	// Copies data into the mapped slot, the copy to destination is recorded by flush; writes the
+	// destination directly when the slot is full or already flushed; offsets and size are multiples
+	// of 4 like every buffer copy
+	void upload(wgpu::Queue queue, wgpu::Buffer destination, uint64_t destinationOffset, const void* data, uint64_t size);
+	void flush(wgpu::CommandEncoder encoder);	// Unmaps the slot and records the copies, before the first pass that reads them
+
+	uint32_t getFrameCount() const { return (uint32_t)slots.size(); }
+	uint32_t getFrameIndex() const { return frameIndex; }
+	double getWaitMilliseconds() const { return waitMilliseconds; }	// Of the last beginFrame
+	uint64_t getUploadedBytes() const { return uploadedBytes; }	// Through the slot this frame
+	uint64_t getOverflowBytes() const { return overflowBytes; }	// Written directly this frame because the slot was full or flushed
+
+private:
+	struct Slot {
+		wgpu::Buffer buffer = nullptr;
+		bool inFlight = false;	//submitted and not reported done yet
+		bool mapping = false;	//mapAsync requested and not called back yet
+		bool mapped = false;
+	};
+
+	// A copy recorded by flush
+	struct Copy {
+		uint64_t offset = 0;
+		wgpu::Buffer destination = nullptr;
+		uint64_t destinationOffset = 0;
+		uint64_t size = 0;
+	};
+
+	void tick();
+
+	// The callbacks get their slot as userdata, the wrapper's callbacks would allocate every frame
+	static void onMapped(WGPUBufferMapAsyncStatus status, void* userdata);
+	static void onWorkDone(WGPUQueueWorkDoneStatus status, void* userdata);
+
+	wgpu::Device device = nullptr;
+	std::vector<std::unique_ptr<Slot>> slots;	//the fence and map callbacks point to their slot
+	uint64_t slotSize = 0;
+	uint32_t frameIndex = 0;
+	uint8_t* data = nullptr;	//mapped range of the current slot, null once flushed
+	uint64_t cursor = 0;	//next free byte of the current slot
+	std::vector<Copy> copies;	//of the current slot, kept between frames for the capacity
+
+	double waitMilliseconds = 0.0;
+	uint64_t uploadedBytes = 0;
+	uint64_t overflowBytes = 0;
+};
@@ -0,0 +1,409 @@
+#include "GpuCuller.h"
+#include "ResourceTracker.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace wgpu;
+
+static_assert(sizeof(GpuCuller::Item) == 32, "GpuCuller::Item must match CullItem in shader_cull.wgsl");
+
+static constexpr uint32_t CullWorkgroupSize = 64;
+static constexpr uint32_t PyramidWorkgroupSize = 8;
+
+static uint32_t nextPowerOfTwo(uint32_t value)
+{
+	uint32_t power = 1;
+	while (power < value) power *= 2;
+	return power;
+}
+
+bool GpuCuller::initialize(Device device, Texture depthTexture, uint32_t depthWidth, uint32_t depthHeight)
+{
+	this->device = device;
+	this->depthWidth = depthWidth;
+	this->depthHeight = depthHeight;
+
+	if (!initPipelines()) return false;
+	initPyramid(depthTexture);
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.mappedAtCreation = false;
+
+	bufferDescriptor.label = "Cull Uniform Buffer";
+	bufferDescriptor.size = sizeof(Uniforms);
+	bufferDescriptor.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
+	this->uniformBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	bufferDescriptor.label = "Cull Counter Buffer";
+	bufferDescriptor.size = sizeof(Counters);
+	bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopySrc | BufferUsage::CopyDst;
+	this->counterBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	bufferDescriptor.label = "Cull Counter Readback Buffer";
+	bufferDescriptor.usage = BufferUsage::MapRead | BufferUsage::CopyDst;
+	this->readbackBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Readback);
+
+	resize(1024);
+
+	return this->pyramid && this->cullBindGroup;
+}
+
+void GpuCuller::terminate()
+{
+	//a pending map is cancelled when the buffer goes away, so readbackCallback is kept alive for it
+	if (this->cullBindGroup) this->cullBindGroup.release();
+	ResourceTracker::destroyBuffer(this->itemBuffer);
+	ResourceTracker::destroyBuffer(this->drawBuffer);
+	ResourceTracker::destroyBuffer(this->visibilityBuffer);
+	ResourceTracker::destroyBuffer(this->counterBuffer);
+	ResourceTracker::destroyBuffer(this->readbackBuffer);
+	ResourceTracker::destroyBuffer(this->uniformBuffer);
+	this->cullBindGroup = nullptr;
+	this->itemBuffer = nullptr;
+	this->drawBuffer = nullptr;
+	this->visibilityBuffer = nullptr;
+	this->counterBuffer = nullptr;
+	this->readbackBuffer = nullptr;
+	this->uniformBuffer = nullptr;
+	this->itemCount = 0;
+	this->itemCapacity = 0;
+	this->counterCopyRecorded = false;
+	this->readbackPending = false;
+
+	for (BindGroup& bindGroup : this->levelBindGroups) bindGroup.release();
+	for (TextureView& view : this->levelViews) view.release();
+	this->levelBindGroups.clear();
+	this->levelViews.clear();
+	this->levelSizes.clear();
+	if (this->pyramidView) this->pyramidView.release();
+	if (this->depthView) this->depthView.release();
+	ResourceTracker::destroyTexture(this->pyramid);
+	this->pyramidView = nullptr;
+	this->depthView = nullptr;
+	this->pyramid = nullptr;
+
+	if (this->firstPhasePipeline) this->firstPhasePipeline.release();
+	if (this->secondPhasePipeline) this->secondPhasePipeline.release();
+	if (this->depthDownsamplePipeline) this->depthDownsamplePipeline.release();
+	if (this->downsamplePipeline) this->downsamplePipeline.release();
+	if (this->cullLayout) this->cullLayout.release();
+	if (this->depthDownsampleLayout) this->depthDownsampleLayout.release();
+	if (this->downsampleLayout) this->downsampleLayout.release();
+	if (this->cullShaderModule) this->cullShaderModule.release();
+	if (this->pyramidShaderModule) this->pyramidShaderModule.release();
+	this->firstPhasePipeline = nullptr;
+	this->secondPhasePipeline = nullptr;
+	this->depthDownsamplePipeline = nullptr;
+	this->downsamplePipeline = nullptr;
+	this->cullLayout = nullptr;
+	this->depthDownsampleLayout = nullptr;
+	this->downsampleLayout = nullptr;
+	this->cullShaderModule = nullptr;
+	this->pyramidShaderModule = nullptr;
+}
+
+bool GpuCuller::initPipelines()
+{
+	this->pyramidShaderModule = loadShaderModule(RESOURCE_DIR "/shader_hiz.wgsl", this->device);
+	this->cullShaderModule = loadShaderModule(RESOURCE_DIR "/shader_cull.wgsl", this->device);
+	if (!this->pyramidShaderModule || !this->cullShaderModule) return false;
+
+	//pyramid levels, the first one reads the depth buffer and the others the level before them
+	BindGroupLayoutEntry destinationEntry = Default;
+	destinationEntry.binding = 1;
+	destinationEntry.visibility = ShaderStage::Compute;
+	destinationEntry.storageTexture.access = StorageTextureAccess::WriteOnly;
+	destinationEntry.storageTexture.format = TextureFormat::R32Float;
+	destinationEntry.storageTexture.viewDimension = TextureViewDimension::_2D;
+
+	BindGroupLayoutEntry depthSourceEntry = Default;
+	depthSourceEntry.binding = 2;
+	depthSourceEntry.visibility = ShaderStage::Compute;
+	depthSourceEntry.texture.sampleType = TextureSampleType::Depth;
+	depthSourceEntry.texture.viewDimension = TextureViewDimension::_2D;
+
+	BindGroupLayoutEntry sourceEntry = Default;
+	sourceEntry.binding = 0;
+	sourceEntry.visibility = ShaderStage::Compute;
+	sourceEntry.texture.sampleType = TextureSampleType::UnfilterableFloat;
+	sourceEntry.texture.viewDimension = TextureViewDimension::_2D;
+
+	BindGroupLayoutEntry depthDownsampleEntries[] = { depthSourceEntry, destinationEntry };
+	BindGroupLayoutDescriptor layoutDescriptor = Default;
+	layoutDescriptor.label = "Depth Downsample Bind Group Layout";
+	layoutDescriptor.entryCount = 2;
+	layoutDescriptor.entries = depthDownsampleEntries;
+	this->depthDownsampleLayout = this->device.createBindGroupLayout(layoutDescriptor);
+
+	BindGroupLayoutEntry downsampleEntries[] = { sourceEntry, destinationEntry };
+	layoutDescriptor.label = "Downsample Bind Group Layout";
+	layoutDescriptor.entries = downsampleEntries;
+	this->downsampleLayout = this->device.createBindGroupLayout(layoutDescriptor);
+
+	//cull passes
+	BindGroupLayoutEntry cullEntries[6];
+	for (uint32_t i = 0; i < 6; ++i) {
+		cullEntries[i] = Default;
+		cullEntries[i].binding = i;
+		cullEntries[i].visibility = ShaderStage::Compute;
+	}
+	cullEntries[0].buffer.type = BufferBindingType::Uniform;
+	cullEntries[0].buffer.minBindingSize = sizeof(Uniforms);
+	cullEntries[1].buffer.type = BufferBindingType::ReadOnlyStorage;
+	cullEntries[1].buffer.minBindingSize = sizeof(Item);
+	cullEntries[2].buffer.type = BufferBindingType::Storage;
+	cullEntries[2].buffer.minBindingSize = DrawStride;
+	cullEntries[3].buffer.type = BufferBindingType::Storage;
+	cullEntries[3].buffer.minBindingSize = sizeof(uint32_t);
+	cullEntries[4].buffer.type = BufferBindingType::Storage;
+	cullEntries[4].buffer.minBindingSize = sizeof(Counters);
+	cullEntries[5].texture.sampleType = TextureSampleType::UnfilterableFloat;
+	cullEntries[5].texture.viewDimension = TextureViewDimension::_2D;
+
+	layoutDescriptor.label = "Cull Bind Group Layout";
+	layoutDescriptor.entryCount = 6;
+	layoutDescriptor.entries = cullEntries;
+	this->cullLayout = this->device.createBindGroupLayout(layoutDescriptor);
+
+	PipelineLayoutDescriptor pipelineLayoutDescriptor = Default;
+	pipelineLayoutDescriptor.bindGroupLayoutCount = 1;
+	ComputePipelineDescriptor pipelineDescriptor = Default;
+
+	pipelineLayoutDescriptor.label = "Depth Downsample Pipeline Layout";
+	pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)&this->depthDownsampleLayout;
+	PipelineLayout depthDownsamplePipelineLayout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+	pipelineDescriptor.layout = depthDownsamplePipelineLayout;
+	pipelineDescriptor.compute.module = this->pyramidShaderModule;
+	pipelineDescriptor.compute.entryPoint = "downsample_depth";
+	this->depthDownsamplePipeline = this->device.createComputePipeline(pipelineDescriptor);
+	depthDownsamplePipelineLayout.release();
+
+	pipelineLayoutDescriptor.label = "Downsample Pipeline Layout";
+	pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)&this->downsampleLayout;
+	PipelineLayout downsamplePipelineLayout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+	pipelineDescriptor.layout = downsamplePipelineLayout;
+	pipelineDescriptor.compute.entryPoint = "downsample";
+	this->downsamplePipeline = this->device.createComputePipeline(pipelineDescriptor);
+	downsamplePipelineLayout.release();
+
+	//both phases share the bindings and differ in the entry point
+	pipelineLayoutDescriptor.label = "Cull Pipeline Layout";
+	pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)&this->cullLayout;
+	PipelineLayout cullPipelineLayout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+	pipelineDescriptor.layout = cullPipelineLayout;
+	pipelineDescriptor.compute.module = this->cullShaderModule;
+	pipelineDescriptor.compute.entryPoint = "cull_first_phase";
+	this->firstPhasePipeline = this->device.createComputePipeline(pipelineDescriptor);
+	pipelineDescriptor.compute.entryPoint = "cull_second_phase";
+	this->secondPhasePipeline = this->device.createComputePipeline(pipelineDescriptor);
+	cullPipelineLayout.release();
+
+	return this->depthDownsamplePipeline && this->downsamplePipeline && this->firstPhasePipeline && this->secondPhasePipeline;
+}
+
+void GpuCuller::initPyramid(Texture depthTexture)
+{
+	//a power of two pyramid halves exactly at every level, so a texel of level i always covers
+	//2^(i + 1) pixels of the depth buffer in each direction
+	uint32_t width = std::max(1u, nextPowerOfTwo(this->depthWidth) / 2);
+	uint32_t height = std::max(1u, nextPowerOfTwo(this->depthHeight) / 2);
+	this->levelSizes.push_back({ width, height });
+	while (width > 1 || height > 1) {
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		this->levelSizes.push_back({ width, height });
+	}
+	uint32_t levelCount = (uint32_t)this->levelSizes.size();
+
+	TextureDescriptor textureDescriptor = Default;
+	textureDescriptor.label = "Depth Pyramid";
+	textureDescriptor.dimension = TextureDimension::_2D;
+	textureDescriptor.format = TextureFormat::R32Float;
+	textureDescriptor.mipLevelCount = levelCount;
+	textureDescriptor.sampleCount = 1;
+	textureDescriptor.size = { this->levelSizes[0].x, this->levelSizes[0].y, 1 };
+	textureDescriptor.usage = TextureUsage::StorageBinding | TextureUsage::TextureBinding;
+	textureDescriptor.viewFormatCount = 0;
+	textureDescriptor.viewFormats = nullptr;
+	this->pyramid = ResourceTracker::createTexture(this->device, textureDescriptor, ResourceCategory::Culling);
+
+	TextureViewDescriptor viewDescriptor = Default;
+	viewDescriptor.aspect = TextureAspect::All;
+	viewDescriptor.baseArrayLayer = 0;
+	viewDescriptor.arrayLayerCount = 1;
+	viewDescriptor.dimension = TextureViewDimension::_2D;
+	viewDescriptor.format = TextureFormat::R32Float;
+	viewDescriptor.baseMipLevel = 0;
+	viewDescriptor.mipLevelCount = levelCount;
+	this->pyramidView = this->pyramid.createView(viewDescriptor);
+
+	viewDescriptor.mipLevelCount = 1;
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		viewDescriptor.baseMipLevel = level;
+		this->levelViews.push_back(this->pyramid.createView(viewDescriptor));
+	}
+
+	TextureViewDescriptor depthViewDescriptor = Default;
+	depthViewDescriptor.aspect = TextureAspect::DepthOnly;
+	depthViewDescriptor.baseArrayLayer = 0;
+	depthViewDescriptor.arrayLayerCount = 1;
+	depthViewDescriptor.baseMipLevel = 0;
+	depthViewDescriptor.mipLevelCount = 1;
+	depthViewDescriptor.dimension = TextureViewDimension::_2D;
+	depthViewDescriptor.format = depthTexture.getFormat();
+	this->depthView = depthTexture.createView(depthViewDescriptor);
+
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		BindGroupEntry entries[2];
+		entries[0] = Default;
+		entries[0].binding = level == 0 ? 2 : 0;
+		entries[0].textureView = level == 0 ? this->depthView : this->levelViews[level - 1];
+		entries[1] = Default;
+		entries[1].binding = 1;
+		entries[1].textureView = this->levelViews[level];
+
+		BindGroupDescriptor bindGroupDescriptor = Default;
+		bindGroupDescriptor.label = "Depth Pyramid Level Bind Group";
+		bindGroupDescriptor.layout = level == 0 ? this->depthDownsampleLayout : this->downsampleLayout;
+		bindGroupDescriptor.entryCount = 2;
+		bindGroupDescriptor.entries = entries;
+		this->levelBindGroups.push_back(this->device.createBindGroup(bindGroupDescriptor));
+	}
+}
+
+void GpuCuller::resize(uint32_t itemCapacity)
+{
+	if (this->cullBindGroup) this->cullBindGroup.release();
+	ResourceTracker::destroyBuffer(this->itemBuffer);
+	ResourceTracker::destroyBuffer(this->drawBuffer);
+	ResourceTracker::destroyBuffer(this->visibilityBuffer);
+
+	this->itemCapacity = itemCapacity;
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.mappedAtCreation = false;
+
+	bufferDescriptor.label = "Cull Item Buffer";
+	bufferDescriptor.size = (uint64_t)itemCapacity * sizeof(Item);
+	bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopyDst;
+	this->itemBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	bufferDescriptor.label = "Indirect Draw Buffer";
+	bufferDescriptor.size = 2 * (uint64_t)itemCapacity * DrawStride;
+	bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::Indirect;
+	this->drawBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	bufferDescriptor.label = "Visibility Buffer";
+	bufferDescriptor.size = (uint64_t)itemCapacity * sizeof(uint32_t);
+	bufferDescriptor.usage = BufferUsage::Storage;
+	this->visibilityBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	BindGroupEntry entries[6];
+	for (uint32_t i = 0; i < 6; ++i) {
+		entries[i] = Default;
+		entries[i].binding = i;
+		entries[i].offset = 0;
+	}
+	entries[0].buffer = this->uniformBuffer;
+	entries[0].size = sizeof(Uniforms);
+	entries[1].buffer = this->itemBuffer;
+	entries[1].size = this->itemBuffer.getSize();
+	entries[2].buffer = this->drawBuffer;
+	entries[2].size = this->drawBuffer.getSize();
+	entries[3].buffer = this->visibilityBuffer;
+	entries[3].size = this->visibilityBuffer.getSize();
+	entries[4].buffer = this->counterBuffer;
+	entries[4].size = sizeof(Counters);
+	entries[5].textureView = this->pyramidView;
+
+	BindGroupDescriptor bindGroupDescriptor = Default;
+	bindGroupDescriptor.label = "Cull Bind Group";
+	bindGroupDescriptor.layout = this->cullLayout;
+	bindGroupDescriptor.entryCount = 6;
+	bindGroupDescriptor.entries = entries;
+	this->cullBindGroup = this->device.createBindGroup(bindGroupDescriptor);
+}
+
+void GpuCuller::uploadItems(Queue queue, const std::vector<Item>& items)
+{
+	if (items.size() > this->itemCapacity) {
+		resize(std::max((uint32_t)items.size(), this->itemCapacity * 2));
+	}
+
+	this->itemCount = (uint32_t)items.size();
+	if (this->itemCount > 0) {
+		queue.writeBuffer(this->itemBuffer, 0, items.data(), items.size() * sizeof(Item));
+	}
+}
+
+void GpuCuller::recordFirstPhase(Queue queue, CommandEncoder encoder, const glm::mat4& viewProjection)
+{
+	Uniforms uniforms;
+	uniforms.viewProjection = viewProjection;
+	uniforms.depthSize[0] = this->depthWidth;
+	uniforms.depthSize[1] = this->depthHeight;
+	uniforms.itemCount = this->itemCount;
+	uniforms.levelCount = (uint32_t)this->levelSizes.size();
+	queue.writeBuffer(this->uniformBuffer, 0, &uniforms, sizeof(Uniforms));
+
+	encoder.clearBuffer(this->counterBuffer, 0, sizeof(Counters));
+	recordCull(encoder, this->firstPhasePipeline);
+}
+
+void GpuCuller::recordSecondPhase(CommandEncoder encoder)
+{
+	recordCull(encoder, this->secondPhasePipeline);
+
+	//the readback buffer cannot be written while it is mapped, frames in between are skipped
+	this->counterCopyRecorded = !this->readbackPending;
+	if (this->counterCopyRecorded) {
+		encoder.copyBufferToBuffer(this->counterBuffer, 0, this->readbackBuffer, 0, sizeof(Counters));
+	}
+}
+
+void GpuCuller::recordCull(CommandEncoder encoder, ComputePipeline pipeline)
+{
+	//the pyramid is rebuilt from whatever the depth buffer holds: the previous frame before the
+	//first phase, the items of the first phase before the second
+	ComputePassDescriptor passDescriptor = Default;
+	passDescriptor.label = "Cull Pass";
+	ComputePassEncoder pass = encoder.beginComputePass(passDescriptor);
+
+	recordPyramid(pass);
+
+	if (this->itemCount > 0) {
+		pass.setPipeline(pipeline);
+		pass.setBindGroup(0, this->cullBindGroup, 0, nullptr);
+		pass.dispatchWorkgroups((this->itemCount + CullWorkgroupSize - 1) / CullWorkgroupSize, 1, 1);
+	}
+
+	pass.end();
+	pass.release();
+}
+
+void GpuCuller::recordPyramid(ComputePassEncoder pass)
+{
+	for (size_t level = 0; level < this->levelSizes.size(); ++level) {
+		pass.setPipeline(level == 0 ? this->depthDownsamplePipeline : this->downsamplePipeline);
+		pass.setBindGroup(0, this->levelBindGroups[level], 0, nullptr);
+		pass.dispatchWorkgroups((this->levelSizes[level].x + PyramidWorkgroupSize - 1) / PyramidWorkgroupSize,
+			(this->levelSizes[level].y + PyramidWorkgroupSize - 1) / PyramidWorkgroupSize, 1);
+	}
+}
+
+void GpuCuller::readCounters()
+{
+	if (!this->counterCopyRecorded) return;
+	this->counterCopyRecorded = false;
+	this->readbackPending = true;
+
+	//the callback runs from a later device tick, the counters stay a few frames behind
+	this->readbackCallback = this->readbackBuffer.mapAsync(MapMode::Read, 0, sizeof(Counters), [this](BufferMapAsyncStatus status) {
+		if (status == BufferMapAsyncStatus::Success) {
+			memcpy(&this->counters, this->readbackBuffer.getConstMappedRange(0, sizeof(Counters)), sizeof(Counters));
+			this->readbackBuffer.unmap();
+		}
+		this->readbackPending = false;
+		});
+}
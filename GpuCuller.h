@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <webgpu/webgpu.hpp>
+
+//two phase occlusion culling on the GPU: the scene items are tested against a hierarchical depth
+//pyramid built from the previous frame's depth and write their own drawIndexedIndirect arguments,
+//then the items the first phase rejected are tested again against the depth of what it drew
+class GpuCuller
+{
+public:
+	//one scene item, laid out like CullItem in shader_cull.wgsl
+	struct Item {
+		glm::vec3 boundsMin;	//world space
+		uint32_t indexCount;
+		glm::vec3 boundsMax;
+		uint32_t firstInstance;	//transform slot, read by the transform table shader as the instance index
+	};
+
+	//items counted by the cull passes, they reach the CPU a few frames late
+	struct Counters {
+		uint32_t drawnFirstPhase = 0;
+		uint32_t drawnSecondPhase = 0;	//rejected by the first phase but visible after all
+		uint32_t culled = 0;
+		uint32_t padding = 0;
+	};
+
+	static constexpr uint64_t DrawStride = 5 * sizeof(uint32_t);	//arguments of one drawIndexedIndirect
+
+	// The depth texture needs the TextureBinding usage
+	bool initialize(wgpu::Device device, wgpu::Texture depthTexture, uint32_t depthWidth, uint32_t depthHeight);
+	void terminate();
+
+	void uploadItems(wgpu::Queue queue, const std::vector<Item>& items);	// Whole list, after the scene or its bounds changed
+
+	// Both phases are recorded outside of render passes, the first one before the scene pass and the
+	// second one between it and the pass that draws what the second phase found
+	void recordFirstPhase(wgpu::Queue queue, wgpu::CommandEncoder encoder, const glm::mat4& viewProjection);
+	void recordSecondPhase(wgpu::CommandEncoder encoder);
+	void readCounters();	// After the submit, maps the counters copied this frame unless a read is still pending
+
+	wgpu::Buffer getDrawBuffer() const { return drawBuffer; }
+	uint64_t getDrawOffset(uint32_t phase, uint32_t item) const { return ((uint64_t)phase * itemCount + item) * DrawStride; }
+	uint32_t getItemCount() const { return itemCount; }
+	const Counters& getCounters() const { return counters; }
+
+private:
+	bool initPipelines();
+	void initPyramid(wgpu::Texture depthTexture);
+	void resize(uint32_t itemCapacity);
+	void recordPyramid(wgpu::ComputePassEncoder pass);
+	void recordCull(wgpu::CommandEncoder encoder, wgpu::ComputePipeline pipeline);
+
+	struct Uniforms {
+		glm::mat4 viewProjection;
+		uint32_t depthSize[2];
+		uint32_t itemCount;
+		uint32_t levelCount;
+	};
+
+	wgpu::Device device = nullptr;
+	uint32_t depthWidth = 0;
+	uint32_t depthHeight = 0;
+
+	//pipelines
+	wgpu::ShaderModule pyramidShaderModule = nullptr;
+	wgpu::ShaderModule cullShaderModule = nullptr;
+	wgpu::BindGroupLayout depthDownsampleLayout = nullptr;
+	wgpu::BindGroupLayout downsampleLayout = nullptr;
+	wgpu::BindGroupLayout cullLayout = nullptr;
+	wgpu::ComputePipeline depthDownsamplePipeline = nullptr;
+	wgpu::ComputePipeline downsamplePipeline = nullptr;
+	wgpu::ComputePipeline firstPhasePipeline = nullptr;
+	wgpu::ComputePipeline secondPhasePipeline = nullptr;
+
+	//depth pyramid, level 0 is half of the depth buffer rounded up to a power of two
+	wgpu::Texture pyramid = nullptr;
+	wgpu::TextureView pyramidView = nullptr;	//every level, read by the cull passes
+	std::vector<wgpu::TextureView> levelViews;
+	std::vector<wgpu::BindGroup> levelBindGroups;	//level i is written from level i - 1, level 0 from the depth buffer
+	std::vector<glm::uvec2> levelSizes;
+	wgpu::TextureView depthView = nullptr;
+
+	//buffers
+	wgpu::Buffer uniformBuffer = nullptr;
+	wgpu::Buffer itemBuffer = nullptr;
+	wgpu::Buffer drawBuffer = nullptr;	//two draws per item, one per phase
+	wgpu::Buffer visibilityBuffer = nullptr;
+	wgpu::Buffer counterBuffer = nullptr;
+	wgpu::Buffer readbackBuffer = nullptr;
+	wgpu::BindGroup cullBindGroup = nullptr;
+	uint32_t itemCount = 0;
+	uint32_t itemCapacity = 0;
+
+	//asynchronous counter readback
+	Counters counters;
+	bool counterCopyRecorded = false;
+	bool readbackPending = false;
+	std::unique_ptr<wgpu::BufferMapCallback> readbackCallback;
+};
@@ -0,0 +1,256 @@
+#include "GpuFrustumCuller.h"
+#include "Bounds.h"
+#include "IndirectDraws.h"
+#include "TransformBuffer.h"
+#include "ResourceTracker.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+using namespace wgpu;
+
+static_assert(sizeof(GpuFrustumCuller::Object) == 32, "GpuFrustumCuller::Object must match CullObject in shader_frustum_cull.wgsl");
+
+static constexpr uint32_t FrustumCullWorkgroupSize = 64;
+
+bool GpuFrustumCuller::initialize(Device device)
+{
+	this->device = device;
+
+	this->shaderModule = loadShaderModule(RESOURCE_DIR "/shader_frustum_cull.wgsl", this->device);
+	if (!this->shaderModule) return false;
+
+	BindGroupLayoutEntry entries[6];
+	for (uint32_t i = 0; i < 6; ++i) {
+		entries[i] = Default;
+		entries[i].binding = i;
+		entries[i].visibility = ShaderStage::Compute;
+	}
+	entries[0].buffer.type = BufferBindingType::Uniform;
+	entries[0].buffer.minBindingSize = sizeof(Uniforms);
+	entries[1].buffer.type = BufferBindingType::ReadOnlyStorage;
+	entries[1].buffer.minBindingSize = sizeof(Object);
+	entries[2].buffer.type = BufferBindingType::ReadOnlyStorage;
+	entries[2].buffer.minBindingSize = sizeof(glm::mat4);
+	entries[3].buffer.type = BufferBindingType::Storage;
+	entries[3].buffer.minBindingSize = IndirectDraws::ArgumentStride;
+	entries[4].buffer.type = BufferBindingType::Storage;
+	entries[4].buffer.minBindingSize = sizeof(uint32_t);
+	entries[5].buffer.type = BufferBindingType::Storage;
+	entries[5].buffer.minBindingSize = sizeof(uint32_t);
+
+	BindGroupLayoutDescriptor layoutDescriptor = Default;
+	layoutDescriptor.label = "Frustum Cull Bind Group Layout";
+	layoutDescriptor.entryCount = 6;
+	layoutDescriptor.entries = entries;
+	this->bindGroupLayout = this->device.createBindGroupLayout(layoutDescriptor);
+
+	PipelineLayoutDescriptor pipelineLayoutDescriptor = Default;
+	pipelineLayoutDescriptor.label = "Frustum Cull Pipeline Layout";
+	pipelineLayoutDescriptor.bindGroupLayoutCount = 1;
+	pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)&this->bindGroupLayout;
+	PipelineLayout pipelineLayout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+
+	ComputePipelineDescriptor pipelineDescriptor = Default;
+	pipelineDescriptor.layout = pipelineLayout;
+	pipelineDescriptor.compute.module = this->shaderModule;
+	pipelineDescriptor.compute.entryPoint = "cull";
+	this->pipeline = this->device.createComputePipeline(pipelineDescriptor);
+	pipelineLayout.release();
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.mappedAtCreation = false;
+
+	bufferDescriptor.label = "Frustum Cull Uniform Buffer";
+	bufferDescriptor.size = sizeof(Uniforms);
+	bufferDescriptor.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
+	this->uniformBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	//padded to 4 bytes like every copy needs
+	bufferDescriptor.label = "Frustum Cull Count Buffer";
+	bufferDescriptor.size = sizeof(uint32_t);
+	bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopySrc | BufferUsage::CopyDst;
+	this->countBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	bufferDescriptor.label = "Frustum Cull Count Readback Buffer";
+	bufferDescriptor.usage = BufferUsage::MapRead | BufferUsage::CopyDst;
+	this->readbackBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Readback);
+
+	resize(1024, 256);
+
+	return this->pipeline != nullptr;
+}
+
+void GpuFrustumCuller::terminate()
+{
+	//a pending map is cancelled when the buffer goes away, so readbackCallback is kept alive for it
+	if (this->bindGroup) this->bindGroup.release();
+	ResourceTracker::destroyBuffer(this->uniformBuffer);
+	ResourceTracker::destroyBuffer(this->objectBuffer);
+	ResourceTracker::destroyBuffer(this->argumentTemplateBuffer);
+	ResourceTracker::destroyBuffer(this->countBuffer);
+	ResourceTracker::destroyBuffer(this->readbackBuffer);
+	this->bindGroup = nullptr;
+	this->uniformBuffer = nullptr;
+	this->objectBuffer = nullptr;
+	this->argumentTemplateBuffer = nullptr;
+	this->countBuffer = nullptr;
+	this->readbackBuffer = nullptr;
+	this->boundTable = nullptr;
+	this->boundDraws = nullptr;
+	this->objectCapacity = 0;
+	this->groupCapacity = 0;
+	this->objectCount = 0;
+	this->groupCount = 0;
+	this->countCopyRecorded = false;
+	this->readbackPending = false;
+
+	if (this->pipeline) this->pipeline.release();
+	if (this->bindGroupLayout) this->bindGroupLayout.release();
+	if (this->shaderModule) this->shaderModule.release();
+	this->pipeline = nullptr;
+	this->bindGroupLayout = nullptr;
+	this->shaderModule = nullptr;
+}
+
+void GpuFrustumCuller::resize(uint32_t objectCapacity, uint32_t groupCapacity)
+{
+	if (this->bindGroup) this->bindGroup.release();
+	this->bindGroup = nullptr;
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.mappedAtCreation = false;
+
+	if (objectCapacity != this->objectCapacity) {
+		ResourceTracker::destroyBuffer(this->objectBuffer);
+		bufferDescriptor.label = "Frustum Cull Object Buffer";
+		bufferDescriptor.size = (uint64_t)objectCapacity * sizeof(Object);
+		bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopyDst;
+		this->objectBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+		this->objectCapacity = objectCapacity;
+	}
+
+	if (groupCapacity != this->groupCapacity) {
+		ResourceTracker::destroyBuffer(this->argumentTemplateBuffer);
+		bufferDescriptor.label = "Frustum Cull Argument Template Buffer";
+		bufferDescriptor.size = (uint64_t)groupCapacity * IndirectDraws::ArgumentStride;
+		bufferDescriptor.usage = BufferUsage::CopySrc | BufferUsage::CopyDst;
+		this->argumentTemplateBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+		this->groupCapacity = groupCapacity;
+	}
+}
+
+void GpuFrustumCuller::upload(Queue queue, const std::vector<Object>& objects, const std::vector<uint32_t>& groupIndexCounts, IndirectDraws& draws)
+{
+	uint32_t objectCount = (uint32_t)objects.size();
+	uint32_t groupCount = (uint32_t)groupIndexCounts.size();
+	if (objectCount > this->objectCapacity || groupCount > this->groupCapacity) {
+		resize(std::max(objectCount, this->objectCapacity), std::max(groupCount, this->groupCapacity));
+	}
+	draws.reserve(std::max(objectCount, groupCount));
+
+	this->objectCount = objectCount;
+	this->groupCount = groupCount;
+	if (objectCount == 0) return;
+	queue.writeBuffer(this->objectBuffer, 0, objects.data(), (uint64_t)objectCount * sizeof(Object));
+
+	//each group gets the range of object indices its objects can append to, the objects are sorted
+	//by group so the ranges follow each other
+	std::vector<IndirectDraws::Arguments> arguments(groupCount);
+	for (uint32_t group = 0; group < groupCount; ++group) {
+		arguments[group].indexCount = groupIndexCounts[group];
+	}
+	for (uint32_t i = 0; i < objectCount; ++i) {
+		if (i == 0 || objects[i].group != objects[i - 1].group) {
+			arguments[objects[i].group].firstInstance = i;
+		}
+	}
+	queue.writeBuffer(this->argumentTemplateBuffer, 0, arguments.data(), (uint64_t)groupCount * IndirectDraws::ArgumentStride);
+}
+
+void GpuFrustumCuller::updateBindGroup(const TransformBuffer& table, IndirectDraws& draws)
+{
+	if (this->bindGroup) this->bindGroup.release();
+
+	BindGroupEntry entries[6];
+	for (uint32_t i = 0; i < 6; ++i) {
+		entries[i] = Default;
+		entries[i].binding = i;
+		entries[i].offset = 0;
+	}
+	entries[0].buffer = this->uniformBuffer;
+	entries[0].size = sizeof(Uniforms);
+	entries[1].buffer = this->objectBuffer;
+	entries[1].size = this->objectBuffer.getSize();
+	entries[2].buffer = table.getBuffer();
+	entries[2].size = table.getBuffer().getSize();
+	entries[3].buffer = draws.getArgumentBuffer();
+	entries[3].size = draws.getArgumentBuffer().getSize();
+	entries[4].buffer = draws.getObjectIndexBuffer();
+	entries[4].size = draws.getObjectIndexBuffer().getSize();
+	entries[5].buffer = this->countBuffer;
+	entries[5].size = sizeof(uint32_t);
+
+	BindGroupDescriptor bindGroupDescriptor = Default;
+	bindGroupDescriptor.label = "Frustum Cull Bind Group";
+	bindGroupDescriptor.layout = this->bindGroupLayout;
+	bindGroupDescriptor.entryCount = 6;
+	bindGroupDescriptor.entries = entries;
+	this->bindGroup = this->device.createBindGroup(bindGroupDescriptor);
+	this->boundTable = &table;
+	this->boundTableGeneration = table.getGeneration();
+	this->boundDraws = &draws;
+	this->boundDrawsGeneration = draws.getGeneration();
+}
+
+void GpuFrustumCuller::record(Queue queue, CommandEncoder encoder, const glm::mat4& viewProjection, const TransformBuffer& table, IndirectDraws& draws)
+{
+	if (this->groupCount == 0) return;
+
+	if (!this->bindGroup || this->boundTable != &table || this->boundTableGeneration != table.getGeneration()
+		|| this->boundDraws != &draws || this->boundDrawsGeneration != draws.getGeneration()) {
+		updateBindGroup(table, draws);
+	}
+
+	Uniforms uniforms = {};
+	Frustum frustum = Frustum::fromMatrix(viewProjection);
+	std::copy(std::begin(frustum.planes), std::end(frustum.planes), uniforms.planes);
+	uniforms.objectCount = this->objectCount;
+	queue.writeBuffer(this->uniformBuffer, 0, &uniforms, sizeof(Uniforms));
+
+	//the instance counts start from 0 again, everything else in the arguments stays the same
+	encoder.copyBufferToBuffer(this->argumentTemplateBuffer, 0, draws.getArgumentBuffer(), 0, (uint64_t)this->groupCount * IndirectDraws::ArgumentStride);
+	encoder.clearBuffer(this->countBuffer, 0, sizeof(uint32_t));
+
+	ComputePassDescriptor passDescriptor = Default;
+	passDescriptor.label = "Frustum Cull Pass";
+	ComputePassEncoder pass = encoder.beginComputePass(passDescriptor);
+	pass.setPipeline(this->pipeline);
+	pass.setBindGroup(0, this->bindGroup, 0, nullptr);
+	pass.dispatchWorkgroups((this->objectCount + FrustumCullWorkgroupSize - 1) / FrustumCullWorkgroupSize, 1, 1);
+	pass.end();
+	pass.release();
+
+	//the readback buffer cannot be written while it is mapped, frames in between are skipped
+	this->countCopyRecorded = !this->readbackPending;
+	if (this->countCopyRecorded) {
+		encoder.copyBufferToBuffer(this->countBuffer, 0, this->readbackBuffer, 0, sizeof(uint32_t));
+	}
+}
+
+void GpuFrustumCuller::readVisibleCount()
+{
+	if (!this->countCopyRecorded) return;
+	this->countCopyRecorded = false;
+	this->readbackPending = true;
+
+	//the callback runs from a later device tick, the count stays a few frames behind
+	this->readbackCallback = this->readbackBuffer.mapAsync(MapMode::Read, 0, sizeof(uint32_t), [this](BufferMapAsyncStatus status) {
+		if (status == BufferMapAsyncStatus::Success) {
+			memcpy(&this->visibleCount, this->readbackBuffer.getConstMappedRange(0, sizeof(uint32_t)), sizeof(uint32_t));
+			this->readbackBuffer.unmap();
+		}
+		this->readbackPending = false;
+		});
+}
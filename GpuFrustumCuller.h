@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <webgpu/webgpu.hpp>
+
+class IndirectDraws;
+class TransformBuffer;
+
+//frustum culling of every object in a compute pass that compacts the survivors into the buffers of
+//IndirectDraws: the objects are grouped by mesh and each group is one instanced drawIndexedIndirect
+//whose instance count the visible objects increment while appending their transform slot to the
+//group's range of object indices; the bounds are in model space and the world matrices are read
+//from the storage transform table, so the CPU does no per object work once the objects are uploaded
+class GpuFrustumCuller
+{
+public:
+	//one object, laid out like CullObject in shader_frustum_cull.wgsl
+	struct Object {
+		glm::vec3 boundsMin;	//model space
+		uint32_t transformSlot;
+		glm::vec3 boundsMax;
+		uint32_t group;
+	};
+
+	bool initialize(wgpu::Device device);
+	void terminate();
+
+	// Objects sorted by group, groupIndexCounts[g] is the index count of the mesh of group g; sets up
+	// the draw arguments of every group in `draws` after the scene or its transform slots changed
+	void upload(wgpu::Queue queue, const std::vector<Object>& objects, const std::vector<uint32_t>& groupIndexCounts, IndirectDraws& draws);
+
+	// Resets the instance counts and culls; the draws of `draws` are then valid for render passes recorded after it
+	void record(wgpu::Queue queue, wgpu::CommandEncoder encoder, const glm::mat4& viewProjection, const TransformBuffer& table, IndirectDraws& draws);
+	void readVisibleCount();	// After the submit, maps the count copied this frame unless a read is still pending
+
+	uint32_t getObjectCount() const { return objectCount; }
+	uint32_t getGroupCount() const { return groupCount; }
+	uint32_t getVisibleCount() const { return visibleCount; }	// A few frames old
+
+private:
+	struct Uniforms {
+		glm::vec4 planes[6];
+		uint32_t objectCount;
+		uint32_t padding[3];
+	};
+
+	void resize(uint32_t objectCapacity, uint32_t groupCapacity);
+	void updateBindGroup(const TransformBuffer& table, IndirectDraws& draws);
+
+	wgpu::Device device = nullptr;
+	wgpu::ShaderModule shaderModule = nullptr;
+	wgpu::BindGroupLayout bindGroupLayout = nullptr;
+	wgpu::ComputePipeline pipeline = nullptr;
+
+	wgpu::Buffer uniformBuffer = nullptr;
+	wgpu::Buffer objectBuffer = nullptr;
+	wgpu::Buffer argumentTemplateBuffer = nullptr;	//the draw arguments with instance counts of 0, copied over the draws every frame
+	wgpu::Buffer countBuffer = nullptr;
+	wgpu::Buffer readbackBuffer = nullptr;
+	uint32_t objectCapacity = 0;
+	uint32_t groupCapacity = 0;
+	uint32_t objectCount = 0;
+	uint32_t groupCount = 0;
+
+	wgpu::BindGroup bindGroup = nullptr;
+	const TransformBuffer* boundTable = nullptr;	//what the bind group was made for
+	uint32_t boundTableGeneration = 0;
+	const IndirectDraws* boundDraws = nullptr;
+	uint32_t boundDrawsGeneration = 0;
+
+	//asynchronous count readback
+	uint32_t visibleCount = 0;
+	bool countCopyRecorded = false;
+	bool readbackPending = false;
+	std::unique_ptr<wgpu::BufferMapCallback> readbackCallback;
+};
@@ -0,0 +1,150 @@
+#include "GpuTimer.h"
+#include "ResourceTracker.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace wgpu;
+
+bool GpuTimer::initialize(Device device, uint32_t frameCount)
+{
+	this->device = device;
+
+	QuerySetDescriptor querySetDescriptor = Default;
+	querySetDescriptor.label = "Frame Timestamps";
+	querySetDescriptor.type = QueryType::Timestamp;
+	querySetDescriptor.count = 2 * frameCount;
+	this->querySet = this->device.createQuerySet(querySetDescriptor);
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.mappedAtCreation = false;
+
+	bufferDescriptor.label = "Timestamp Resolve Buffer";
+	bufferDescriptor.size = frameCount * ResolveStride;
+	bufferDescriptor.usage = BufferUsage::QueryResolve | BufferUsage::CopySrc;
+	this->resolveBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Readback);
+
+	bufferDescriptor.label = "Timestamp Readback Buffer";
+	bufferDescriptor.size = 2 * sizeof(uint64_t);
+	bufferDescriptor.usage = BufferUsage::MapRead | BufferUsage::CopyDst;
+	for (uint32_t i = 0; i < frameCount; ++i) {
+		std::unique_ptr<Slot> slot(new Slot());
+		slot->readbackBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Readback);
+		this->slots.push_back(std::move(slot));
+	}
+
+	return this->querySet && this->resolveBuffer;
+}
+
+void GpuTimer::terminate()
+{
+	//a map that has not called back yet still points to its slot, so the reads are waited for first;
+	//a copy that was recorded and never submitted keeps its slot busy, the timeout gives up on it
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	while (this->isReading() && std::chrono::high_resolution_clock::now() - waitStart < std::chrono::seconds(5)) {
+		this->tick();
+	}
+
+	for (std::unique_ptr<Slot>& slot : this->slots) {
+		slot->callback.reset();
+		ResourceTracker::destroyBuffer(slot->readbackBuffer);
+	}
+	this->slots.clear();
+	ResourceTracker::destroyBuffer(this->resolveBuffer);
+	this->resolveBuffer = nullptr;
+	if (this->querySet) {
+		this->querySet.destroy();
+		this->querySet.release();
+	}
+	this->querySet = nullptr;
+	this->current = nullptr;
+	this->results.clear();
+}
+
+void GpuTimer::tick()
+{
+	//the callbacks only run from device ticks
+#if defined(WEBGPU_BACKEND_DAWN)
+	this->device.tick();
+#elif defined(WEBGPU_BACKEND_WGPU)
+	wgpuDevicePoll(this->device, false, nullptr);
+#endif
+	std::this_thread::yield();
+}
+
+void GpuTimer::beginFrame(uint32_t frame, CommandEncoder encoder)
+{
+	this->currentIndex = frame % (uint32_t)this->slots.size();
+	this->current = this->slots[this->currentIndex].get();
+	this->resolved = false;
+	if (this->current->busy) {
+		this->current = nullptr;
+		return;
+	}
+	this->current->frame = frame;
+
+	//an empty pass only to write the timestamp, the time then also covers the copies and compute
+	//passes recorded before the scene passes
+	ComputePassTimestampWrites timestampWrites = Default;
+	timestampWrites.querySet = this->querySet;
+	timestampWrites.beginningOfPassWriteIndex = 2 * this->currentIndex;
+	timestampWrites.endOfPassWriteIndex = WGPU_QUERY_SET_INDEX_UNDEFINED;
+
+	ComputePassDescriptor computePassDescriptor = Default;
+	computePassDescriptor.label = "Frame Start Timestamp";
+	computePassDescriptor.timestampWrites = &timestampWrites;
+	ComputePassEncoder computePass = encoder.beginComputePass(computePassDescriptor);
+	computePass.end();
+	computePass.release();
+}
+
+const RenderPassTimestampWrites* GpuTimer::getPassTimestamps(bool lastPass)
+{
+	if (!this->current || !lastPass) return nullptr;
+
+	this->passTimestamps.querySet = this->querySet;
+	this->passTimestamps.beginningOfPassWriteIndex = WGPU_QUERY_SET_INDEX_UNDEFINED;
+	this->passTimestamps.endOfPassWriteIndex = 2 * this->currentIndex + 1;
+	return &this->passTimestamps;
+}
+
+void GpuTimer::resolve(CommandEncoder encoder)
+{
+	if (!this->current) return;
+
+	uint64_t offset = this->currentIndex * ResolveStride;
+	encoder.resolveQuerySet(this->querySet, 2 * this->currentIndex, 2, this->resolveBuffer, offset);
+	encoder.copyBufferToBuffer(this->resolveBuffer, offset, this->current->readbackBuffer, 0, 2 * sizeof(uint64_t));
+	this->current->busy = true;
+	this->resolved = true;
+}
+
+void GpuTimer::read()
+{
+	if (!this->current || !this->resolved) return;
+
+	//the callback runs from a later device tick
+	Slot* slot = this->current;
+	this->current = nullptr;
+	slot->callback = slot->readbackBuffer.mapAsync(MapMode::Read, 0, 2 * sizeof(uint64_t), [this, slot](BufferMapAsyncStatus status) {
+		if (status == BufferMapAsyncStatus::Success) {
+			uint64_t timestamps[2];
+			memcpy(timestamps, slot->readbackBuffer.getConstMappedRange(0, sizeof(timestamps)), sizeof(timestamps));
+			slot->readbackBuffer.unmap();
+
+			//timestamps are in nanoseconds, a pair that goes backwards is dropped
+			if (timestamps[1] >= timestamps[0]) {
+				this->results.push_back({ slot->frame, (timestamps[1] - timestamps[0]) / 1e6 });
+			}
+		}
+		slot->busy = false;
+		});
+}
+
+bool GpuTimer::isReading() const
+{
+	for (const std::unique_ptr<Slot>& slot : this->slots) {
+		if (slot->busy) return true;
+	}
+	return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+
+//GPU time of a frame from timestamp queries (needs the timestamp-query feature): an empty compute
+//pass at the start of the frame's command buffer writes a timestamp before the uploads, the compute
+//passes and the scene passes, and the last scene pass writes one when it ends, the pair is resolved
+//and copied into a readback buffer of the frame and mapped after the submit, so the time of a frame
+//is known a few frames later
+class GpuTimer
+{
+public:
+	// Time of one frame, in the order the reads complete
+	struct Result {
+		uint32_t frame = 0;
+		double milliseconds = 0.0;
+	};
+
+	bool initialize(wgpu::Device device, uint32_t frameCount);	// Readback buffers for frameCount frames in flight
+	void terminate();	// Waits for the maps still pending
+
+	// Records the first timestamp, before anything else of the frame; the frame is not timed when its
+	// readback buffer is still busy
+	void beginFrame(uint32_t frame, wgpu::CommandEncoder encoder);
+	// Timestamp writes of a scene pass, null when the frame is not timed or the pass is not the last
+	const wgpu::RenderPassTimestampWrites* getPassTimestamps(bool lastPass);
+	void resolve(wgpu::CommandEncoder encoder);	// After the last scene pass
+	void read();	// After the submit
+
+	bool isReading() const;	// Copies or maps still pending
+	const std::vector<Result>& getResults() const { return results; }
+	void clearResults() { results.clear(); }
+
+private:
+	struct Slot {
+		wgpu::Buffer readbackBuffer = nullptr;
+		uint32_t frame = 0;
+		bool busy = false;	//copy recorded or map pending
+		std::unique_ptr<wgpu::BufferMapCallback> callback;
+	};
+
+	static constexpr uint64_t ResolveStride = 256;	//resolveQuerySet offsets must be multiples of 256
+
+	void tick();
+
+	wgpu::Device device = nullptr;
+	wgpu::QuerySet querySet = nullptr;	//two timestamps per slot
+	wgpu::Buffer resolveBuffer = nullptr;
+	std::vector<std::unique_ptr<Slot>> slots;	//the map callbacks point to their slot
+	Slot* current = nullptr;	//of the frame being recorded, null when it is not timed
+	uint32_t currentIndex = 0;
+	bool resolved = false;
+	wgpu::RenderPassTimestampWrites passTimestamps;
+
+	std::vector<Result> results;
+};
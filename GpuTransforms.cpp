@@ -0,0 +1,354 @@
+#include "GpuTransforms.h"
+#include "TransformBuffer.h"
+#include "TransformStore.h"
+#include "ResourceTracker.h"
+#include "utils.h"
+#include <algorithm>
+
+using namespace wgpu;
+
+static_assert(sizeof(GpuTransforms::LocalTransform) == 48, "GpuTransforms::LocalTransform must match LocalTransform in shader_transform_propagate.wgsl");
+static_assert(sizeof(GpuTransforms::ChangedLocal) == 64, "GpuTransforms::ChangedLocal must match ChangedLocal in shader_transform_propagate.wgsl");
+
+static constexpr uint32_t PropagateWorkgroupSize = 64;
+static constexpr uint32_t LevelSize = 4 * sizeof(uint32_t);
+static constexpr uint32_t ScatterParamsSize = 4 * sizeof(uint32_t);
+
+bool GpuTransforms::initialize(Device device)
+{
+	this->device = device;
+
+	SupportedLimits limits;
+	this->device.getLimits(&limits);
+	this->levelStride = ceilToNextMultiple(LevelSize, (uint32_t)limits.limits.minUniformBufferOffsetAlignment);
+
+	this->shaderModule = loadShaderModule(RESOURCE_DIR "/shader_transform_propagate.wgsl", this->device);
+	if (!this->shaderModule) return false;
+
+	BindGroupLayoutEntry entries[4];
+	for (uint32_t i = 0; i < 4; ++i) {
+		entries[i] = Default;
+		entries[i].binding = i;
+		entries[i].visibility = ShaderStage::Compute;
+	}
+	entries[0].buffer.type = BufferBindingType::Uniform;
+	entries[0].buffer.hasDynamicOffset = true;
+	entries[0].buffer.minBindingSize = LevelSize;
+	entries[1].buffer.type = BufferBindingType::ReadOnlyStorage;
+	entries[1].buffer.minBindingSize = sizeof(LocalTransform);
+	entries[2].buffer.type = BufferBindingType::ReadOnlyStorage;
+	entries[2].buffer.minBindingSize = sizeof(uint32_t);
+	entries[3].buffer.type = BufferBindingType::Storage;
+	entries[3].buffer.minBindingSize = sizeof(glm::mat4);
+
+	BindGroupLayoutDescriptor layoutDescriptor = Default;
+	layoutDescriptor.label = "Transform Propagation Bind Group Layout";
+	layoutDescriptor.entryCount = 4;
+	layoutDescriptor.entries = entries;
+	this->bindGroupLayout = this->device.createBindGroupLayout(layoutDescriptor);
+
+	PipelineLayoutDescriptor pipelineLayoutDescriptor = Default;
+	pipelineLayoutDescriptor.label = "Transform Propagation Pipeline Layout";
+	pipelineLayoutDescriptor.bindGroupLayoutCount = 1;
+	pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)&this->bindGroupLayout;
+	PipelineLayout pipelineLayout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+
+	ComputePipelineDescriptor pipelineDescriptor = Default;
+	pipelineDescriptor.layout = pipelineLayout;
+	pipelineDescriptor.compute.module = this->shaderModule;
+	pipelineDescriptor.compute.entryPoint = "propagate";
+	this->pipeline = this->device.createComputePipeline(pipelineDescriptor);
+	pipelineLayout.release();
+
+	//the scatter dispatch has its own bindings of the same module
+	BindGroupLayoutEntry scatterEntries[3];
+	for (uint32_t i = 0; i < 3; ++i) {
+		scatterEntries[i] = Default;
+		scatterEntries[i].binding = 4 + i;
+		scatterEntries[i].visibility = ShaderStage::Compute;
+	}
+	scatterEntries[0].buffer.type = BufferBindingType::Uniform;
+	scatterEntries[0].buffer.minBindingSize = ScatterParamsSize;
+	scatterEntries[1].buffer.type = BufferBindingType::ReadOnlyStorage;
+	scatterEntries[1].buffer.minBindingSize = sizeof(ChangedLocal);
+	scatterEntries[2].buffer.type = BufferBindingType::Storage;
+	scatterEntries[2].buffer.minBindingSize = sizeof(LocalTransform);
+
+	layoutDescriptor.label = "Transform Scatter Bind Group Layout";
+	layoutDescriptor.entryCount = 3;
+	layoutDescriptor.entries = scatterEntries;
+	this->scatterBindGroupLayout = this->device.createBindGroupLayout(layoutDescriptor);
+
+	pipelineLayoutDescriptor.label = "Transform Scatter Pipeline Layout";
+	pipelineLayoutDescriptor.bindGroupLayouts = (WGPUBindGroupLayout*)&this->scatterBindGroupLayout;
+	pipelineLayout = this->device.createPipelineLayout(pipelineLayoutDescriptor);
+
+	pipelineDescriptor.layout = pipelineLayout;
+	pipelineDescriptor.compute.entryPoint = "scatter";
+	this->scatterPipeline = this->device.createComputePipeline(pipelineDescriptor);
+	pipelineLayout.release();
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.label = "Transform Scatter Params Buffer";
+	bufferDescriptor.mappedAtCreation = false;
+	bufferDescriptor.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
+	bufferDescriptor.size = ScatterParamsSize;
+	this->scatterParamsBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Uniform);
+
+	resize(1024);
+	resizeLevels(16);
+	resizeChanged(1024);
+
+	return this->pipeline != nullptr && this->scatterPipeline != nullptr;
+}
+
+void GpuTransforms::terminate()
+{
+	if (this->bindGroup) this->bindGroup.release();
+	if (this->scatterBindGroup) this->scatterBindGroup.release();
+	ResourceTracker::destroyBuffer(this->levelBuffer);
+	ResourceTracker::destroyBuffer(this->localBuffer);
+	ResourceTracker::destroyBuffer(this->parentBuffer);
+	ResourceTracker::destroyBuffer(this->changedBuffer);
+	ResourceTracker::destroyBuffer(this->scatterParamsBuffer);
+	this->bindGroup = nullptr;
+	this->scatterBindGroup = nullptr;
+	this->levelBuffer = nullptr;
+	this->localBuffer = nullptr;
+	this->parentBuffer = nullptr;
+	this->changedBuffer = nullptr;
+	this->scatterParamsBuffer = nullptr;
+	this->boundTable = nullptr;
+	this->levelCapacity = 0;
+	this->slotCapacity = 0;
+	this->changedCapacity = 0;
+	this->staging.clear();
+	this->changedStaging.clear();
+	this->levelStaging.clear();
+	reset();
+
+	if (this->pipeline) this->pipeline.release();
+	if (this->scatterPipeline) this->scatterPipeline.release();
+	if (this->bindGroupLayout) this->bindGroupLayout.release();
+	if (this->scatterBindGroupLayout) this->scatterBindGroupLayout.release();
+	if (this->shaderModule) this->shaderModule.release();
+	this->pipeline = nullptr;
+	this->scatterPipeline = nullptr;
+	this->bindGroupLayout = nullptr;
+	this->scatterBindGroupLayout = nullptr;
+	this->shaderModule = nullptr;
+}
+
+void GpuTransforms::resize(uint32_t slotCount)
+{
+	if (this->bindGroup) this->bindGroup.release();
+	this->bindGroup = nullptr;
+	if (this->scatterBindGroup) this->scatterBindGroup.release();
+	this->scatterBindGroup = nullptr;
+	ResourceTracker::destroyBuffer(this->localBuffer);
+	ResourceTracker::destroyBuffer(this->parentBuffer);
+
+	this->slotCapacity = slotCount;
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.mappedAtCreation = false;
+	bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopyDst;
+
+	//written by the scatter dispatch and by whole uploads after a sort
+	bufferDescriptor.label = "Local Transform Buffer";
+	bufferDescriptor.size = (uint64_t)slotCount * sizeof(LocalTransform);
+	this->localBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Storage);
+
+	bufferDescriptor.label = "Transform Parent Buffer";
+	bufferDescriptor.size = (uint64_t)slotCount * sizeof(uint32_t);
+	this->parentBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Storage);
+
+	//the new buffers are empty
+	reset();
+}
+
+void GpuTransforms::resizeLevels(uint32_t levelCount)
+{
+	if (this->bindGroup) this->bindGroup.release();
+	this->bindGroup = nullptr;
+	ResourceTracker::destroyBuffer(this->levelBuffer);
+
+	this->levelCapacity = levelCount;
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.label = "Transform Level Buffer";
+	bufferDescriptor.mappedAtCreation = false;
+	bufferDescriptor.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
+	bufferDescriptor.size = (uint64_t)levelCount * this->levelStride;
+	this->levelBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Uniform);
+
+	reset();
+}
+
+void GpuTransforms::resizeChanged(uint32_t changedCount)
+{
+	if (this->scatterBindGroup) this->scatterBindGroup.release();
+	this->scatterBindGroup = nullptr;
+	ResourceTracker::destroyBuffer(this->changedBuffer);
+
+	this->changedCapacity = changedCount;
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.label = "Changed Local Transform Buffer";
+	bufferDescriptor.mappedAtCreation = false;
+	bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopyDst;
+	bufferDescriptor.size = (uint64_t)changedCount * sizeof(ChangedLocal);
+	this->changedBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Storage);
+}
+
+void GpuTransforms::updateScatterBindGroup()
+{
+	if (this->scatterBindGroup) this->scatterBindGroup.release();
+
+	BindGroupEntry entries[3];
+	for (uint32_t i = 0; i < 3; ++i) {
+		entries[i] = Default;
+		entries[i].binding = 4 + i;
+		entries[i].offset = 0;
+	}
+	entries[0].buffer = this->scatterParamsBuffer;
+	entries[0].size = ScatterParamsSize;
+	entries[1].buffer = this->changedBuffer;
+	entries[1].size = this->changedBuffer.getSize();
+	entries[2].buffer = this->localBuffer;
+	entries[2].size = this->localBuffer.getSize();
+
+	BindGroupDescriptor bindGroupDescriptor = Default;
+	bindGroupDescriptor.label = "Transform Scatter Bind Group";
+	bindGroupDescriptor.layout = this->scatterBindGroupLayout;
+	bindGroupDescriptor.entryCount = 3;
+	bindGroupDescriptor.entries = entries;
+	this->scatterBindGroup = this->device.createBindGroup(bindGroupDescriptor);
+}
+
+void GpuTransforms::updateBindGroup(Buffer tableBuffer)
+{
+	if (this->bindGroup) this->bindGroup.release();
+
+	BindGroupEntry entries[4];
+	for (uint32_t i = 0; i < 4; ++i) {
+		entries[i] = Default;
+		entries[i].binding = i;
+		entries[i].offset = 0;
+	}
+	entries[0].buffer = this->levelBuffer;
+	entries[0].size = LevelSize;
+	entries[1].buffer = this->localBuffer;
+	entries[1].size = this->localBuffer.getSize();
+	entries[2].buffer = this->parentBuffer;
+	entries[2].size = this->parentBuffer.getSize();
+	entries[3].buffer = tableBuffer;
+	entries[3].size = tableBuffer.getSize();
+
+	BindGroupDescriptor bindGroupDescriptor = Default;
+	bindGroupDescriptor.label = "Transform Propagation Bind Group";
+	bindGroupDescriptor.layout = this->bindGroupLayout;
+	bindGroupDescriptor.entryCount = 4;
+	bindGroupDescriptor.entries = entries;
+	this->bindGroup = this->device.createBindGroup(bindGroupDescriptor);
+	this->boundTable = tableBuffer;
+}
+
+uint32_t GpuTransforms::record(Queue queue, CommandEncoder encoder, const TransformStore& transforms, TransformBuffer& table)
+{
+	this->computedCount = 0;
+	this->uploadedLocalCount = 0;
+
+	//levels are only valid after an update of a store without CPU world matrices
+	uint32_t slotCount = (uint32_t)transforms.getSlotCount();
+	uint32_t levelCount = transforms.getLevelCount();
+	if (slotCount == 0 || levelCount == 0) return 0;
+
+	//a replaced table has lost the matrices of the slots that did not change
+	if (table.reserve(slotCount)) reset();
+	if (slotCount > this->slotCapacity) resize(std::max(slotCount, this->slotCapacity * 2));
+	if (levelCount > this->levelCapacity) resizeLevels(std::max(levelCount, this->levelCapacity * 2));
+	if (!this->bindGroup || this->boundTable != table.getBuffer()) {
+		updateBindGroup(table.getBuffer());
+	}
+
+	bool uploadAll = transforms.getSortCount() != this->uploadedSortCount;
+	const std::vector<uint32_t>& localSlots = transforms.getLocalChangedSlots();
+	if (!uploadAll && localSlots.empty()) return 0;
+
+	const glm::vec3* translations = transforms.getTranslations();
+	const glm::quat* rotations = transforms.getRotations();
+	const glm::vec3* scales = transforms.getScales();
+	auto pack = [&](uint32_t slot, LocalTransform& local) {
+		local.translation = glm::vec4(translations[slot], 0.0f);
+		local.rotation = glm::vec4(rotations[slot].x, rotations[slot].y, rotations[slot].z, rotations[slot].w);
+		local.scale = glm::vec4(scales[slot], 0.0f);
+	};
+
+	uint32_t writes = 0;
+	uint32_t scatterCount = 0;
+	if (uploadAll) {
+		this->staging.resize(slotCount);
+		for (uint32_t slot = 0; slot < slotCount; ++slot) pack(slot, this->staging[slot]);
+		queue.writeBuffer(this->localBuffer, 0, this->staging.data(), (uint64_t)slotCount * sizeof(LocalTransform));
+
+		//parents and levels only change when the store sorts
+		queue.writeBuffer(this->parentBuffer, 0, transforms.getParents(), (uint64_t)slotCount * sizeof(uint32_t));
+
+		const std::vector<uint32_t>& levelStarts = transforms.getLevelStarts();
+		uint32_t stride = this->levelStride / sizeof(uint32_t);
+		this->levelStaging.assign((size_t)levelCount * stride, 0);
+		for (uint32_t level = 0; level < levelCount; ++level) {
+			this->levelStaging[level * stride] = levelStarts[level];
+			this->levelStaging[level * stride + 1] = levelStarts[level + 1] - levelStarts[level];
+		}
+		queue.writeBuffer(this->levelBuffer, 0, this->levelStaging.data(), (uint64_t)levelCount * this->levelStride);
+		writes += 3;
+
+		this->uploadedSortCount = transforms.getSortCount();
+	}
+	else {
+		//only the locals that were set go up, their subtrees follow from the propagation
+		scatterCount = (uint32_t)localSlots.size();
+		if (scatterCount > this->changedCapacity) resizeChanged(std::max(scatterCount, this->changedCapacity * 2));
+		if (!this->scatterBindGroup) updateScatterBindGroup();
+
+		this->changedStaging.resize(scatterCount);
+		for (uint32_t i = 0; i < scatterCount; ++i) {
+			ChangedLocal& changed = this->changedStaging[i];
+			pack(localSlots[i], changed.local);
+			changed.slot = localSlots[i];
+		}
+		queue.writeBuffer(this->changedBuffer, 0, this->changedStaging.data(), (uint64_t)scatterCount * sizeof(ChangedLocal));
+		uint32_t params[4] = { scatterCount, 0, 0, 0 };
+		queue.writeBuffer(this->scatterParamsBuffer, 0, params, sizeof(params));
+		writes += 2;
+	}
+	this->uploadedLocalCount = uploadAll ? slotCount : scatterCount;
+
+	//every level is recomputed, a dispatch of a few hundred thousand matrices costs less than
+	//finding the changed subtrees again on the GPU
+	ComputePassDescriptor passDescriptor = Default;
+	passDescriptor.label = "Transform Propagation Pass";
+	ComputePassEncoder pass = encoder.beginComputePass(passDescriptor);
+	if (scatterCount > 0) {
+		pass.setPipeline(this->scatterPipeline);
+		pass.setBindGroup(0, this->scatterBindGroup, 0, nullptr);
+		pass.dispatchWorkgroups((scatterCount + PropagateWorkgroupSize - 1) / PropagateWorkgroupSize, 1, 1);
+	}
+	pass.setPipeline(this->pipeline);
+	const std::vector<uint32_t>& levelStarts = transforms.getLevelStarts();
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		uint32_t levelSlots = levelStarts[level + 1] - levelStarts[level];
+		if (levelSlots == 0) continue;
+
+		uint32_t offset = level * this->levelStride;
+		pass.setBindGroup(0, this->bindGroup, 1, &offset);
+		pass.dispatchWorkgroups((levelSlots + PropagateWorkgroupSize - 1) / PropagateWorkgroupSize, 1, 1);
+	}
+	pass.end();
+	pass.release();
+
+	this->computedCount = slotCount;
+	return writes;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <webgpu/webgpu.hpp>
+
+class TransformStore;
+class TransformBuffer;
+
+//world matrices computed on the GPU: the local transforms and parent slots of a TransformStore are
+//kept in storage buffers and a compute pass walks the hierarchy one depth level per dispatch, writing
+//straight into the storage transform table the vertex shader reads, so the CPU only uploads the
+//local transforms that were set, as a compact list a scatter dispatch copies into their slots
+class GpuTransforms
+{
+public:
+	//one slot, laid out like LocalTransform in shader_transform_propagate.wgsl
+	struct LocalTransform {
+		glm::vec4 translation;
+		glm::vec4 rotation;	//quaternion as x, y, z, w
+		glm::vec4 scale;
+	};
+
+	//one entry of the compact list, laid out like ChangedLocal in shader_transform_propagate.wgsl
+	struct ChangedLocal {
+		LocalTransform local;
+		uint32_t slot;
+		uint32_t padding[3];
+	};
+
+	bool initialize(wgpu::Device device);
+	void terminate();
+
+	void reset() { uploadedSortCount = ~0u; boundTable = nullptr; }	// The next record uploads and recomputes everything
+
+	// After TransformStore::update with CPU world matrices disabled, records the propagation into
+	// `table`, a storage table; returns the number of writeBuffer calls
+	uint32_t record(wgpu::Queue queue, wgpu::CommandEncoder encoder, const TransformStore& transforms, TransformBuffer& table);
+
+	uint32_t getComputedCount() const { return computedCount; }	// Matrices written by the last record
+	uint32_t getUploadedLocalCount() const { return uploadedLocalCount; }	// Local transforms uploaded by the last record
+
+private:
+	void resize(uint32_t slotCount);
+	void resizeLevels(uint32_t levelCount);
+	void resizeChanged(uint32_t changedCount);
+	void updateBindGroup(wgpu::Buffer tableBuffer);
+	void updateScatterBindGroup();
+
+	wgpu::Device device = nullptr;
+	wgpu::ShaderModule shaderModule = nullptr;
+	wgpu::BindGroupLayout bindGroupLayout = nullptr;
+	wgpu::ComputePipeline pipeline = nullptr;
+	wgpu::BindGroupLayout scatterBindGroupLayout = nullptr;
+	wgpu::ComputePipeline scatterPipeline = nullptr;
+
+	wgpu::Buffer levelBuffer = nullptr;	//one Level per dispatch, selected with a dynamic offset
+	wgpu::Buffer localBuffer = nullptr;
+	wgpu::Buffer parentBuffer = nullptr;
+	wgpu::Buffer changedBuffer = nullptr;	//compact list of the locals set since the last record
+	wgpu::Buffer scatterParamsBuffer = nullptr;	//count of the compact list
+	wgpu::BindGroup bindGroup = nullptr;
+	wgpu::BindGroup scatterBindGroup = nullptr;
+	wgpu::Buffer boundTable = nullptr;	//table buffer the bind group was made for
+	uint32_t levelStride = 0;
+	uint32_t levelCapacity = 0;
+	uint32_t slotCapacity = 0;
+	uint32_t changedCapacity = 0;
+
+	std::vector<LocalTransform> staging;	//packed copy of the local transforms, indexed by slot
+	std::vector<ChangedLocal> changedStaging;
+	std::vector<uint32_t> levelStaging;
+	uint32_t uploadedSortCount = ~0u;	//the slots moved when the store sorts, so everything goes up again
+	uint32_t computedCount = 0;
+	uint32_t uploadedLocalCount = 0;
+};
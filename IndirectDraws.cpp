@@ -0,0 +1,105 @@
+#include "IndirectDraws.h"
+#include "TransformBuffer.h"
+#include "ResourceTracker.h"
+#include <algorithm>
+
+using namespace wgpu;
+
+static_assert(sizeof(IndirectDraws::Arguments) == IndirectDraws::ArgumentStride, "IndirectDraws::Arguments must match the drawIndexedIndirect layout");
+
+bool IndirectDraws::initialize(Device device, BindGroupLayout bindGroupLayout)
+{
+	this->device = device;
+	this->bindGroupLayout = bindGroupLayout;
+
+	resize(1024);
+
+	return this->argumentBuffer && this->objectIndexBuffer;
+}
+
+void IndirectDraws::terminate()
+{
+	if (this->bindGroup) this->bindGroup.release();
+	ResourceTracker::destroyBuffer(this->argumentBuffer);
+	ResourceTracker::destroyBuffer(this->objectIndexBuffer);
+
+	this->bindGroup = nullptr;
+	this->argumentBuffer = nullptr;
+	this->objectIndexBuffer = nullptr;
+	this->boundTable = nullptr;
+	this->capacity = 0;
+}
+
+bool IndirectDraws::reserve(uint32_t drawCount)
+{
+	if (drawCount <= this->capacity) return false;
+
+	resize(std::max(drawCount, this->capacity * 2));
+	return true;
+}
+
+void IndirectDraws::resize(uint32_t drawCount)
+{
+	if (this->bindGroup) this->bindGroup.release();
+	this->bindGroup = nullptr;
+	ResourceTracker::destroyBuffer(this->argumentBuffer);
+	ResourceTracker::destroyBuffer(this->objectIndexBuffer);
+
+	this->capacity = drawCount;
+	this->generation++;
+
+	//both are storage buffers too, so that a compute pass can write the draws
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.mappedAtCreation = false;
+
+	bufferDescriptor.label = "Indirect Argument Buffer";
+	bufferDescriptor.size = (uint64_t)drawCount * ArgumentStride;
+	bufferDescriptor.usage = BufferUsage::Indirect | BufferUsage::Storage | BufferUsage::CopyDst;
+	this->argumentBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+
+	bufferDescriptor.label = "Object Index Buffer";
+	bufferDescriptor.size = (uint64_t)drawCount * sizeof(uint32_t);
+	bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopyDst;
+	this->objectIndexBuffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, ResourceCategory::Culling);
+}
+
+uint32_t IndirectDraws::upload(Queue queue, const std::vector<Arguments>& arguments, const std::vector<uint32_t>& objectIndices)
+{
+	uint32_t drawCount = (uint32_t)std::min(arguments.size(), objectIndices.size());
+	if (drawCount == 0) return 0;
+
+	reserve(drawCount);
+	queue.writeBuffer(this->argumentBuffer, 0, arguments.data(), (uint64_t)drawCount * ArgumentStride);
+	queue.writeBuffer(this->objectIndexBuffer, 0, objectIndices.data(), (uint64_t)drawCount * sizeof(uint32_t));
+	return 2;
+}
+
+BindGroup IndirectDraws::getBindGroup(const TransformBuffer& table)
+{
+	if (this->bindGroup && this->boundTable == &table && this->boundTableGeneration == table.getGeneration()) {
+		return this->bindGroup;
+	}
+	if (this->bindGroup) this->bindGroup.release();
+
+	BindGroupEntry entries[2];
+	entries[0] = Default;
+	entries[0].binding = 0;
+	entries[0].buffer = table.getBuffer();
+	entries[0].offset = 0;
+	entries[0].size = table.getBuffer().getSize();
+	entries[1] = Default;
+	entries[1].binding = 1;
+	entries[1].buffer = this->objectIndexBuffer;
+	entries[1].offset = 0;
+	entries[1].size = this->objectIndexBuffer.getSize();
+
+	BindGroupDescriptor bindGroupDescriptor = Default;
+	bindGroupDescriptor.label = "Indirect Objects Bind Group";
+	bindGroupDescriptor.layout = this->bindGroupLayout;
+	bindGroupDescriptor.entryCount = 2;
+	bindGroupDescriptor.entries = entries;
+	this->bindGroup = this->device.createBindGroup(bindGroupDescriptor);
+	this->boundTable = &table;
+	this->boundTableGeneration = table.getGeneration();
+	return this->bindGroup;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+
+class TransformBuffer;
+
+//draws described by a buffer of drawIndexedIndirect arguments and a buffer of object indices, one
+//entry of each per draw: the CPU only issues drawIndexedIndirect at increasing offsets, so whoever
+//fills the buffers, the CPU draw list or a culling pass on the GPU, decides what is drawn and with
+//which transform; the first instance of draw i is i and shader_indirect.wgsl reads the transform
+//slot from objectIndices[i] (needs the indirect-first-instance feature)
+class IndirectDraws
+{
+public:
+	//arguments of one drawIndexedIndirect
+	struct Arguments {
+		uint32_t indexCount = 0;
+		uint32_t instanceCount = 0;	//0 skips the draw
+		uint32_t firstIndex = 0;
+		int32_t baseVertex = 0;
+		uint32_t firstInstance = 0;	//the index of the draw
+	};
+
+	static constexpr uint64_t ArgumentStride = 5 * sizeof(uint32_t);
+
+	bool initialize(wgpu::Device device, wgpu::BindGroupLayout bindGroupLayout);	// The layout of group 1 of shader_indirect.wgsl
+	void terminate();
+
+	// Writes the draws from the CPU, returns the number of writeBuffer calls
+	uint32_t upload(wgpu::Queue queue, const std::vector<Arguments>& arguments, const std::vector<uint32_t>& objectIndices);
+	bool reserve(uint32_t drawCount);	// Returns true when the buffers were replaced, their content is then undefined
+
+	wgpu::BindGroup getBindGroup(const TransformBuffer& table);	// The storage transform table and the object indices
+	wgpu::Buffer getArgumentBuffer() const { return argumentBuffer; }	// Also a storage buffer, for culling passes
+	wgpu::Buffer getObjectIndexBuffer() const { return objectIndexBuffer; }
+	uint64_t getArgumentOffset(uint32_t draw) const { return draw * ArgumentStride; }
+	uint32_t getCapacity() const { return capacity; }
+	uint32_t getGeneration() const { return generation; }	// Changes whenever the buffers are replaced
+
+private:
+	void resize(uint32_t drawCount);
+
+	wgpu::Device device = nullptr;
+	wgpu::BindGroupLayout bindGroupLayout = nullptr;
+	wgpu::Buffer argumentBuffer = nullptr;
+	wgpu::Buffer objectIndexBuffer = nullptr;
+	uint32_t capacity = 0;	//in draws
+	uint32_t generation = 0;
+
+	wgpu::BindGroup bindGroup = nullptr;
+	const TransformBuffer* boundTable = nullptr;	//table and generation the bind group was made for
+	uint32_t boundTableGeneration = 0;
+};
@@ -0,0 +1,98 @@
+#include "JobSystem.h"
+
+void JobSystem::initialize(uint32_t workerCount)
+{
+	terminate();
+
+	this->stopping = false;
+	for (uint32_t i = 0; i < workerCount; ++i) {
+		this->workers.emplace_back(&JobSystem::workerLoop, this);
+	}
+}
+
+void JobSystem::terminate()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+	this->wake.notify_all();
+
+	for (std::thread& worker : this->workers) {
+		worker.join();
+	}
+	this->workers.clear();
+}
+
+void JobSystem::run(size_t count, size_t chunkCount, ChunkFunction function, const void* context)
+{
+	if (count == 0) return;
+	if (chunkCount == 0) chunkCount = 1;
+	if (chunkCount > count) chunkCount = count;
+
+	//not worth waking anyone
+	if (this->workers.empty() || chunkCount == 1) {
+		for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+			function(context, count * chunk / chunkCount, count * (chunk + 1) / chunkCount, chunk);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->function = function;
+		this->context = context;
+		this->count = count;
+		this->chunkCount = chunkCount;
+		this->nextChunk = 0;
+		this->remainingChunks = chunkCount;
+		this->generation++;
+	}
+	this->wake.notify_all();
+
+	runChunks(function, context, count, chunkCount, this->nextChunk, this->remainingChunks);
+
+	//workers still inside runChunks could otherwise pick chunks of the next loop
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->done.wait(lock, [this]() { return this->remainingChunks == 0 && this->activeWorkers == 0; });
+}
+
+void JobSystem::runChunks(ChunkFunction function, const void* context, size_t count, size_t chunkCount,
+	std::atomic<size_t>& nextChunk, std::atomic<size_t>& remainingChunks)
+{
+	while (true) {
+		size_t chunk = nextChunk.fetch_add(1);
+		if (chunk >= chunkCount) return;
+
+		function(context, count * chunk / chunkCount, count * (chunk + 1) / chunkCount, chunk);
+		remainingChunks.fetch_sub(1);
+	}
+}
+
+void JobSystem::workerLoop()
+{
+	uint64_t seenGeneration = 0;
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true) {
+		this->wake.wait(lock, [&]() { return this->stopping || this->generation != seenGeneration; });
+		if (this->stopping) return;
+
+		//a worker that wakes after its loop finished must not touch it, run() may already be
+		//setting up the next one
+		seenGeneration = this->generation;
+		if (this->remainingChunks == 0) continue;
+
+		ChunkFunction function = this->function;
+		const void* context = this->context;
+		size_t count = this->count;
+		size_t chunkCount = this->chunkCount;
+		this->activeWorkers++;
+		lock.unlock();
+
+		runChunks(function, context, count, chunkCount, this->nextChunk, this->remainingChunks);
+
+		lock.lock();
+		this->activeWorkers--;
+		this->done.notify_all();
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//a fixed pool of worker threads for data parallel loops over the scene
+//the calling thread takes part in the work and parallelFor returns once every chunk is done
+class JobSystem
+{
+public:
+	~JobSystem() { terminate(); }
+
+	void initialize(uint32_t workerCount);	// Worker threads in addition to the calling thread
+	void terminate();
+
+	uint32_t getThreadCount() const { return (uint32_t)workers.size() + 1; }
+
+	// Calls function(begin, end, chunk) for chunkCount contiguous ranges covering [0, count)
+	template<typename Function>
+	void parallelFor(size_t count, size_t chunkCount, const Function& function)
+	{
+		run(count, chunkCount, [](const void* context, size_t begin, size_t end, size_t chunk) {
+			(*(const Function*)context)(begin, end, chunk);
+			}, &function);
+	}
+
+private:
+	using ChunkFunction = void(*)(const void* context, size_t begin, size_t end, size_t chunk);
+
+	void run(size_t count, size_t chunkCount, ChunkFunction function, const void* context);
+	static void runChunks(ChunkFunction function, const void* context, size_t count, size_t chunkCount,
+		std::atomic<size_t>& nextChunk, std::atomic<size_t>& remainingChunks);
+	void workerLoop();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	//the loop being executed, only changed under the lock while no worker is running it; a worker
+	//copies it under the lock and only joins a loop that still has chunks left, so run() cannot
+	//return while a worker holds the parameters of its loop
+	ChunkFunction function = nullptr;
+	const void* context = nullptr;
+	size_t count = 0;
+	size_t chunkCount = 0;
+	std::atomic<size_t> nextChunk{ 0 };
+	std::atomic<size_t> remainingChunks{ 0 };
+
+	uint64_t generation = 0;
+	uint32_t activeWorkers = 0;
+	bool stopping = false;
+};
@@ -1,43 +1,45 @@
 #include "Mesh.h"
+#include "CullingKernels.h"
+#include "ResourceTracker.h"
+#include "Texture.h"
 #include <iostream>
 #include <webgpu/webgpu.hpp>
 
 using namespace std;
 using namespace wgpu;
 
-Mesh::Mesh(const float* vertices, size_t numVertices, 
+Mesh::Mesh(const float* vertices, size_t numVertices,
 	const unsigned char* indices, size_t numIndices, IndexFormat indexFormat,
 	const float* normals, size_t numNormals,
 	const float* uvs, size_t numUvs,
-	TextureView textureView, BindGroupLayout textureBindGroupLayout, Device device, Sampler sampler)
+	custom::Texture* texture, BindGroupLayout textureBindGroupLayout, Device device, Sampler sampler,
+	const AABB* bounds)
 {
-	this->vertices = vertices;
-	this->numVertices = numVertices;
-	this->indices = indices;
+	//the source pointers belong to the glTF loader, so we keep our own copies
+	size_t indexSize = indexFormat == IndexFormat::Uint32 ? sizeof(uint32_t) : sizeof(uint16_t);
+	if (vertices) this->vertices.assign(vertices, vertices + numVertices);
+	if (indices) this->indices.assign(indices, indices + numIndices * indexSize);
+	if (normals) this->normals.assign(normals, normals + numNormals);
+	if (uvs) this->uvs.assign(uvs, uvs + numUvs);
 	this->numIndices = numIndices;
 	this->indexFormat = indexFormat;
-	this->normals = normals;
-	this->numNormals = numNormals;
-	this->uvs = uvs;
-	this->numUvs = numUvs;
+
+	this->localBounds = bounds ? *bounds : CullingKernels::computeBounds(this->vertices.data(), this->vertices.size() / 3);
+	if (!this->localBounds.isEmpty()) {
+		this->localSphere.center = this->localBounds.getCenter();
+		this->localSphere.radius = glm::length(this->localBounds.getExtents());
+	}
 
     this->indexBuffer = nullptr;
     this->vertexBuffer = nullptr;
     this->normalBuffer = nullptr;
 	this->uvBuffer = nullptr;
 
-	vector<BindGroupEntry> bindings(2);
-	bindings[0].binding = 0;
-	bindings[0].textureView = textureView;
-
-	bindings[1].binding = 1;
-	bindings[1].sampler = sampler;
+	this->texture = texture;
+	this->textureBindGroupLayout = textureBindGroupLayout;
+	this->sampler = sampler;
 
-	BindGroupDescriptor bindGroupDesc;
-	bindGroupDesc.layout = textureBindGroupLayout;
-	bindGroupDesc.entryCount = (uint32_t)bindings.size();
-	bindGroupDesc.entries = bindings.data();
-	this->textureBindGroup = device.createBindGroup(bindGroupDesc);
+	refreshTextureBindGroup(device);
 
 	cout<<"setting buffers"<<"\n";
 
@@ -46,31 +48,23 @@ Mesh::Mesh(const float* vertices, size_t numVertices,
 
 Mesh::~Mesh()
 {
-    delete[] vertices;
-	delete[] indices;
-	delete[] normals;
-    this->indexBuffer.destroy();
-	this->indexBuffer.release();
-    this->vertexBuffer.destroy();
-	this->vertexBuffer.release();
-    this->normalBuffer.destroy();
-	this->normalBuffer.release();
-	this->textureBindGroup.release();
+	releaseBuffers();
+	if (this->textureBindGroup) this->textureBindGroup.release();
 }
 
 const float* Mesh::getVertices()
 {
-	return vertices;
+	return vertices.data();
 }
 
 size_t Mesh::getNumVertices()
 {
-	return numVertices;
+	return vertices.size();
 }
 
 const unsigned char* Mesh::getIndices()
 {
-	return indices;
+	return indices.data();
 }
 
 size_t Mesh::getNumIndices()
@@ -85,70 +79,142 @@ IndexFormat Mesh::getIndexFormat()
 
 const float* Mesh::getNormals()
 {
-	return normals;
+	return normals.data();
 }
 
 size_t Mesh::getNumNormals()
 {
-	return numNormals;
+	return normals.size();
 }
 
 const float* Mesh::getUVs()
 {
-	return uvs;
+	return uvs.data();
 }
 
 size_t Mesh::getNumUVs()
 {
-	return numUvs;
+	return uvs.size();
+}
+
+const MeshBVH& Mesh::getBVH()
+{
+	if (!this->bvh.isEmpty() || this->numIndices < 3) return this->bvh;
+
+	vector<uint32_t> triangleIndices(this->numIndices);
+	for (size_t i = 0; i < this->numIndices; ++i) {
+		if (this->indexFormat == IndexFormat::Uint32) {
+			triangleIndices[i] = reinterpret_cast<const uint32_t*>(this->indices.data())[i];
+		}
+		else {
+			triangleIndices[i] = reinterpret_cast<const uint16_t*>(this->indices.data())[i];
+		}
+	}
+
+	this->bvh.build(this->vertices.data(), this->vertices.size() / 3, triangleIndices.data(), triangleIndices.size());
+	return this->bvh;
+}
+
+uint64_t Mesh::getGpuBytes()
+{
+	if (!isResident()) return 0;
+
+	return this->vertexBuffer.getSize() + this->normalBuffer.getSize() + this->indexBuffer.getSize() + this->uvBuffer.getSize();
+}
+
+void Mesh::evict()
+{
+	releaseBuffers();
+}
+
+uint64_t Mesh::makeResident(Device device, Queue queue)
+{
+	if (isResident()) return 0;
+
+	setBuffers(device, queue);
+	return getGpuBytes();
+}
+
+void Mesh::refreshTextureBindGroup(Device device)
+{
+	if (this->texture == nullptr) return;
+	if (this->textureBindGroup && this->textureGeneration == this->texture->GetGeneration()) return;
+
+	if (this->textureBindGroup) this->textureBindGroup.release();
+
+	vector<BindGroupEntry> bindings(2);
+	bindings[0].binding = 0;
+	bindings[0].textureView = this->texture->GetTextureView();
+
+	bindings[1].binding = 1;
+	bindings[1].sampler = this->sampler;
+
+	BindGroupDescriptor bindGroupDesc;
+	bindGroupDesc.layout = this->textureBindGroupLayout;
+	bindGroupDesc.entryCount = (uint32_t)bindings.size();
+	bindGroupDesc.entries = bindings.data();
+	this->textureBindGroup = device.createBindGroup(bindGroupDesc);
+	this->textureGeneration = this->texture->GetGeneration();
+	this->gpuGeneration++;
 }
 
 void Mesh::setBuffers(Device device, Queue queue)
 {
+	this->gpuGeneration++;
+
     BufferDescriptor bufferDescriptor = {};
     bufferDescriptor.label = "Vertex Buffer";
-    bufferDescriptor.size = numVertices * sizeof(float);
+    bufferDescriptor.size = (vertices.size() * sizeof(float) + 3) & ~3;
     bufferDescriptor.usage = BufferUsage::Vertex | BufferUsage::CopyDst; //must add vertex usage
     bufferDescriptor.mappedAtCreation = false;
-    this->vertexBuffer = device.createBuffer(bufferDescriptor);
+    this->vertexBuffer = ResourceTracker::createBuffer(device, bufferDescriptor, ResourceCategory::Vertex);
 
 	cout<<"writing vertex buffer"<<"\n";
 
-    queue.writeBuffer(this->vertexBuffer, 0, this->vertices, bufferDescriptor.size);
+    queue.writeBuffer(this->vertexBuffer, 0, this->vertices.data(), vertices.size() * sizeof(float));
 
     //create the normal buffer
     bufferDescriptor.label = "Normal Buffer";
-    bufferDescriptor.size = numNormals * sizeof(float);
+    bufferDescriptor.size = (normals.size() * sizeof(float) + 3) & ~3;
     bufferDescriptor.usage = BufferUsage::Vertex | BufferUsage::CopyDst; //must add vertex usage
-    this->normalBuffer = device.createBuffer(bufferDescriptor);
+    this->normalBuffer = ResourceTracker::createBuffer(device, bufferDescriptor, ResourceCategory::Vertex);
 
 	cout<<"writing normal buffer"<<"\n";
 
-    queue.writeBuffer(this->normalBuffer, 0, this->normals, bufferDescriptor.size);
+    queue.writeBuffer(this->normalBuffer, 0, this->normals.data(), normals.size() * sizeof(float));
 
     //create the index buffer
     bufferDescriptor.label = "Index Buffer";
-	if (this->indexFormat == IndexFormat::Uint16) {
-		bufferDescriptor.size = numIndices * sizeof(uint16_t);
-	}
-	else if(this->indexFormat == IndexFormat::Uint32) {
-		bufferDescriptor.size = numIndices * sizeof(uint32_t);
-	}
-	bufferDescriptor.size = (bufferDescriptor.size + 3) & ~3; // round up to the next multiple of 4
+	bufferDescriptor.size = (indices.size() + 3) & ~3; // round up to the next multiple of 4
     bufferDescriptor.usage = BufferUsage::Index | BufferUsage::CopyDst; //must add index usage
-    this->indexBuffer = device.createBuffer(bufferDescriptor);
+    this->indexBuffer = ResourceTracker::createBuffer(device, bufferDescriptor, ResourceCategory::Index);
 
 	cout<<"writing index buffer and index count : "<<numIndices<<"\n";
 
-    queue.writeBuffer(this->indexBuffer, 0, this->indices, bufferDescriptor.size);
+	//writeBuffer needs a multiple of 4 bytes, so an odd number of 16 bit indices gets a padding index
+	if (indices.size() % 4 != 0) indices.resize(bufferDescriptor.size, 0);
+    queue.writeBuffer(this->indexBuffer, 0, this->indices.data(), bufferDescriptor.size);
 
 	//create the uv buffer
 	bufferDescriptor.label = "UV Buffer";
-	bufferDescriptor.size = numUvs * sizeof(float);
+	bufferDescriptor.size = (uvs.size() * sizeof(float) + 3) & ~3;
 	bufferDescriptor.usage = BufferUsage::Vertex | BufferUsage::CopyDst; //must add vertex usage
-	this->uvBuffer = device.createBuffer(bufferDescriptor);
+	this->uvBuffer = ResourceTracker::createBuffer(device, bufferDescriptor, ResourceCategory::Vertex);
 
 	cout<<"writing uv buffer"<<"\n";
 
-	queue.writeBuffer(this->uvBuffer, 0, this->uvs, bufferDescriptor.size);
+	queue.writeBuffer(this->uvBuffer, 0, this->uvs.data(), uvs.size() * sizeof(float));
+}
+
+void Mesh::releaseBuffers()
+{
+	ResourceTracker::destroyBuffer(this->indexBuffer);
+	ResourceTracker::destroyBuffer(this->vertexBuffer);
+	ResourceTracker::destroyBuffer(this->normalBuffer);
+	ResourceTracker::destroyBuffer(this->uvBuffer);
+
+	this->indexBuffer = nullptr;
+	this->vertexBuffer = nullptr;
+	this->normalBuffer = nullptr;
+	this->uvBuffer = nullptr;
 }
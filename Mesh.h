@@ -1,22 +1,30 @@
 #pragma once
 #include <iostream>
+#include <vector>
 #include <webgpu/webgpu.hpp>
+#include "Bounds.h"
+#include "MeshBVH.h"
 
 using namespace std;
 using namespace wgpu;
 
+namespace custom {
+	class Texture;
+}
+
 class Mesh
 {
 private:
-	const float* vertices;
-	size_t numVertices;
-	const unsigned char* indices;
+	//compact CPU-side copies, kept so that evicted buffers can be uploaded again
+	vector<float> vertices;
+	vector<unsigned char> indices;
 	size_t numIndices;
 	IndexFormat indexFormat = IndexFormat::Uint16;
-	const float* normals;
-	size_t numNormals;
-	const float* uvs;
-	size_t numUvs;
+	vector<float> normals;
+	vector<float> uvs;
+	AABB localBounds;	//bounds of the positions in model space
+	Sphere localSphere;	//around localBounds, tested by the frustum culling kernels
+	MeshBVH bvh;	//built on the first raycast
 
 	Buffer vertexBuffer = nullptr;
 	Buffer indexBuffer = nullptr;
@@ -24,12 +32,19 @@ private:
 	Buffer uvBuffer = nullptr;
 	BindGroup textureBindGroup = nullptr;
 
+	custom::Texture* texture = nullptr;
+	uint32_t textureGeneration = 0; //generation of the texture the bind group was created with
+	uint32_t gpuGeneration = 0;	//changes whenever the buffers or the bind group are created again
+	BindGroupLayout textureBindGroupLayout = nullptr;
+	Sampler sampler = nullptr;
+
 public:
-	Mesh(const float* vertices, size_t numVertices, 
+	Mesh(const float* vertices, size_t numVertices,
 		const unsigned char* indices, size_t numIndices, IndexFormat indexFormat,
-		const float* normals, size_t numNormals, 
+		const float* normals, size_t numNormals,
 		const float* uvs, size_t numUvs,
-		TextureView textureView, BindGroupLayout textureBindGroupLayout, Device device, Sampler sampler);
+		custom::Texture* texture, BindGroupLayout textureBindGroupLayout, Device device, Sampler sampler,
+		const AABB* bounds = nullptr);	// Bounds of the positions if the file has them, computed otherwise
 	~Mesh();
 
 	const float* getVertices();
@@ -41,6 +56,9 @@ public:
 	size_t getNumNormals();
 	const float* getUVs();
 	size_t getNumUVs();
+	const AABB& getLocalBounds() const { return localBounds; }
+	const Sphere& getLocalSphere() const { return localSphere; }
+	const MeshBVH& getBVH();	// Triangle BVH in model space, built from the CPU copies on first use
 
 	Buffer getVertexBuffer() { return vertexBuffer; }
 	Buffer getIndexBuffer() { return indexBuffer; }
@@ -48,8 +66,17 @@ public:
 	Buffer getUVBuffer() { return uvBuffer; }
 
 	BindGroup getTextureBindGroup() { return textureBindGroup; }
+	uint32_t getGpuGeneration() const { return gpuGeneration; }	// Commands recorded with an older generation point to released objects
+	custom::Texture* getTexture() { return texture; }
+
+	//residency
+	bool isResident() { return vertexBuffer != nullptr; }
+	uint64_t getGpuBytes();
+	void evict();
+	uint64_t makeResident(Device device, Queue queue);	// Returns the number of bytes uploaded
+	void refreshTextureBindGroup(Device device);	// Recreate the bind group if the texture was reloaded
 
 private:
 	void setBuffers(Device device, Queue queue);
+	void releaseBuffers();
 };
-
@@ -0,0 +1,307 @@
+#include "MeshBVH.h"
+#include "SceneBVH.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define MESH_BVH_SSE
+#  include <emmintrin.h>
+#endif
+
+//rays that are almost parallel to a triangle are treated as misses
+static constexpr float DeterminantEpsilon = 1e-12f;
+
+void MeshBVH::build(const float* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	this->nodes.clear();
+	this->packets.clear();
+	this->triangleCount = (uint32_t)(indexCount / 3);
+	if (this->triangleCount == 0) return;
+
+	//triangle corners in index order, so that triangle i uses corners 3i, 3i + 1 and 3i + 2
+	std::vector<glm::vec3> corners(3 * (size_t)this->triangleCount);
+	std::vector<AABB> bounds(this->triangleCount);
+	for (uint32_t triangle = 0; triangle < this->triangleCount; ++triangle) {
+		for (uint32_t corner = 0; corner < 3; ++corner) {
+			uint32_t index = indices[3 * (size_t)triangle + corner];
+			glm::vec3 position = index < vertexCount ? glm::vec3(positions[3 * (size_t)index], positions[3 * (size_t)index + 1], positions[3 * (size_t)index + 2]) : glm::vec3(0.0f);
+			corners[3 * (size_t)triangle + corner] = position;
+			bounds[triangle].expand(position);
+		}
+	}
+
+	SceneBVH binary;
+	binary.build(bounds.data(), this->triangleCount);
+
+	this->nodes.reserve(binary.getNodeCount() / 2 + 1);
+	this->packets.reserve(this->triangleCount / 2 + 1);
+	collapse(binary, 0, corners.data(), this->nodes, this->packets);
+}
+
+uint32_t MeshBVH::collapse(const SceneBVH& binary, uint32_t binaryNode, const glm::vec3* corners,
+	std::vector<Node>& nodes, std::vector<TrianglePacket>& packets)
+{
+	uint32_t children[4];
+	uint32_t childCount = 0;
+	const SceneBVH::Node& root = binary.getNode(binaryNode);
+	if (root.count > 0) {
+		children[childCount++] = binaryNode;
+	}
+	else {
+		children[childCount++] = root.first;
+		children[childCount++] = root.first + 1;
+	}
+
+	while (childCount < 4) {
+		int largest = -1;
+		float largestArea = -1.0f;
+		for (uint32_t i = 0; i < childCount; ++i) {
+			const SceneBVH::Node& child = binary.getNode(children[i]);
+			if (child.count == 0 && child.bounds.getSurfaceArea() > largestArea) {
+				largest = (int)i;
+				largestArea = child.bounds.getSurfaceArea();
+			}
+		}
+		if (largest < 0) break;
+
+		uint32_t opened = binary.getNode(children[largest]).first;
+		children[largest] = opened;
+		children[childCount++] = opened + 1;
+	}
+
+	uint32_t nodeIndex = (uint32_t)nodes.size();
+	nodes.emplace_back();
+	for (uint32_t lane = 0; lane < 4; ++lane) {
+		Node& node = nodes[nodeIndex];
+		if (lane >= childCount) {
+			node.minX[lane] = node.minY[lane] = node.minZ[lane] = FLT_MAX;
+			node.maxX[lane] = node.maxY[lane] = node.maxZ[lane] = -FLT_MAX;
+			node.children[lane] = EmptyChild;
+			node.childPacketCounts[lane] = 0;
+			continue;
+		}
+
+		const SceneBVH::Node& child = binary.getNode(children[lane]);
+		node.minX[lane] = child.bounds.min.x;
+		node.minY[lane] = child.bounds.min.y;
+		node.minZ[lane] = child.bounds.min.z;
+		node.maxX[lane] = child.bounds.max.x;
+		node.maxY[lane] = child.bounds.max.y;
+		node.maxZ[lane] = child.bounds.max.z;
+
+		if (child.count == 0) {
+			//the vector may grow while the subtree is built, so the node is looked up again
+			uint32_t childNode = collapse(binary, children[lane], corners, nodes, packets);
+			nodes[nodeIndex].children[lane] = childNode;
+			nodes[nodeIndex].childPacketCounts[lane] = 0;
+			continue;
+		}
+
+		uint32_t firstPacket = (uint32_t)packets.size();
+		for (uint32_t i = 0; i < child.count; i += 4) {
+			TrianglePacket packet = {};
+			for (uint32_t j = 0; j < 4; ++j) {
+				if (i + j >= child.count) {
+					packet.triangles[j] = 0;	//zero edges never hit
+					continue;
+				}
+
+				uint32_t triangle = binary.getLeafItem(child.first + i + j);
+				glm::vec3 v0 = corners[3 * (size_t)triangle];
+				glm::vec3 e1 = corners[3 * (size_t)triangle + 1] - v0;
+				glm::vec3 e2 = corners[3 * (size_t)triangle + 2] - v0;
+				packet.v0x[j] = v0.x; packet.v0y[j] = v0.y; packet.v0z[j] = v0.z;
+				packet.e1x[j] = e1.x; packet.e1y[j] = e1.y; packet.e1z[j] = e1.z;
+				packet.e2x[j] = e2.x; packet.e2y[j] = e2.y; packet.e2z[j] = e2.z;
+				packet.triangles[j] = triangle;
+			}
+			packets.push_back(packet);
+		}
+
+		nodes[nodeIndex].children[lane] = LeafBit | firstPacket;
+		nodes[nodeIndex].childPacketCounts[lane] = (uint32_t)packets.size() - firstPacket;
+	}
+
+	return nodeIndex;
+}
+
+bool MeshBVH::raycast(const Ray& ray, MeshHit& hit) const
+{
+#ifdef MESH_BVH_SSE
+	return traverse<true>(ray, hit);
+#else
+	return traverse<false>(ray, hit);
+#endif
+}
+
+bool MeshBVH::raycastScalar(const Ray& ray, MeshHit& hit) const
+{
+	return traverse<false>(ray, hit);
+}
+
+bool MeshBVH::raycast(const Ray& worldRay, const glm::mat4& worldToModel, MeshHit& hit) const
+{
+	//the direction is not normalized again, so a distance along the model space ray is the same distance in the world
+	glm::vec3 origin = glm::vec3(worldToModel * glm::vec4(worldRay.origin, 1.0f));
+	glm::vec3 direction = glm::vec3(worldToModel * glm::vec4(worldRay.direction, 0.0f));
+	return raycast(Ray(origin, direction), hit);
+}
+
+template<bool Simd>
+bool MeshBVH::traverse(const Ray& ray, MeshHit& hit) const
+{
+	if (this->nodes.empty()) return false;
+
+	struct Entry {
+		uint32_t child;
+		uint32_t packetCount;
+		float distance;
+	};
+	Entry stack[StackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0, 0.0f };
+
+	bool found = false;
+
+#ifdef MESH_BVH_SSE
+	__m128 originX = _mm_set1_ps(ray.origin.x);
+	__m128 originY = _mm_set1_ps(ray.origin.y);
+	__m128 originZ = _mm_set1_ps(ray.origin.z);
+	__m128 inverseX = _mm_set1_ps(ray.inverseDirection.x);
+	__m128 inverseY = _mm_set1_ps(ray.inverseDirection.y);
+	__m128 inverseZ = _mm_set1_ps(ray.inverseDirection.z);
+	__m128 directionX = _mm_set1_ps(ray.direction.x);
+	__m128 directionY = _mm_set1_ps(ray.direction.y);
+	__m128 directionZ = _mm_set1_ps(ray.direction.z);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 epsilon = _mm_set1_ps(DeterminantEpsilon);
+	__m128 signMask = _mm_set1_ps(-0.0f);
+#endif
+
+	while (stackSize > 0) {
+		Entry entry = stack[--stackSize];
+		if (entry.distance >= hit.distance) continue;
+
+		if (entry.child & LeafBit) {
+			uint32_t firstPacket = entry.child & ~LeafBit;
+			for (uint32_t p = firstPacket; p < firstPacket + entry.packetCount; ++p) {
+				const TrianglePacket& packet = this->packets[p];
+				float t[4], u[4], v[4];
+				int mask = 0;
+
+				if (Simd) {
+#ifdef MESH_BVH_SSE
+					__m128 e1x = _mm_load_ps(packet.e1x), e1y = _mm_load_ps(packet.e1y), e1z = _mm_load_ps(packet.e1z);
+					__m128 e2x = _mm_load_ps(packet.e2x), e2y = _mm_load_ps(packet.e2y), e2z = _mm_load_ps(packet.e2z);
+
+					__m128 px = _mm_sub_ps(_mm_mul_ps(directionY, e2z), _mm_mul_ps(directionZ, e2y));
+					__m128 py = _mm_sub_ps(_mm_mul_ps(directionZ, e2x), _mm_mul_ps(directionX, e2z));
+					__m128 pz = _mm_sub_ps(_mm_mul_ps(directionX, e2y), _mm_mul_ps(directionY, e2x));
+					__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+					__m128 inverseDet = _mm_div_ps(one, det);
+
+					__m128 tx = _mm_sub_ps(originX, _mm_load_ps(packet.v0x));
+					__m128 ty = _mm_sub_ps(originY, _mm_load_ps(packet.v0y));
+					__m128 tz = _mm_sub_ps(originZ, _mm_load_ps(packet.v0z));
+					__m128 uValues = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDet);
+
+					__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+					__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+					__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+					__m128 vValues = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qx), _mm_mul_ps(directionY, qy)), _mm_mul_ps(directionZ, qz)), inverseDet);
+					__m128 tValues = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+					__m128 valid = _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), epsilon);
+					valid = _mm_and_ps(valid, _mm_cmpge_ps(uValues, zero));
+					valid = _mm_and_ps(valid, _mm_cmpge_ps(vValues, zero));
+					valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(uValues, vValues), one));
+					valid = _mm_and_ps(valid, _mm_cmpgt_ps(tValues, zero));
+					valid = _mm_and_ps(valid, _mm_cmplt_ps(tValues, _mm_set1_ps(hit.distance)));
+					mask = _mm_movemask_ps(valid);
+
+					_mm_storeu_ps(t, tValues);
+					_mm_storeu_ps(u, uValues);
+					_mm_storeu_ps(v, vValues);
+#endif
+				}
+				else {
+					for (int lane = 0; lane < 4; ++lane) {
+						glm::vec3 e1(packet.e1x[lane], packet.e1y[lane], packet.e1z[lane]);
+						glm::vec3 e2(packet.e2x[lane], packet.e2y[lane], packet.e2z[lane]);
+						glm::vec3 p = glm::cross(ray.direction, e2);
+						float det = glm::dot(e1, p);
+						if (std::abs(det) <= DeterminantEpsilon) continue;
+						float inverseDet = 1.0f / det;
+
+						glm::vec3 s = ray.origin - glm::vec3(packet.v0x[lane], packet.v0y[lane], packet.v0z[lane]);
+						u[lane] = glm::dot(s, p) * inverseDet;
+						glm::vec3 q = glm::cross(s, e1);
+						v[lane] = glm::dot(ray.direction, q) * inverseDet;
+						t[lane] = glm::dot(e2, q) * inverseDet;
+						if (u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f && t[lane] > 0.0f && t[lane] < hit.distance) {
+							mask |= 1 << lane;
+						}
+					}
+				}
+
+				for (int lane = 0; lane < 4; ++lane) {
+					if (!(mask & (1 << lane)) || t[lane] >= hit.distance) continue;
+					hit.distance = t[lane];
+					hit.triangle = packet.triangles[lane];
+					hit.u = u[lane];
+					hit.v = v[lane];
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		const Node& node = this->nodes[entry.child];
+		float entryDistances[4];
+		int mask = 0;
+
+		if (Simd) {
+#ifdef MESH_BVH_SSE
+			__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), originX), inverseX);
+			__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), originX), inverseX);
+			__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), originY), inverseY);
+			__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), originY), inverseY);
+			__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), originZ), inverseZ);
+			__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), originZ), inverseZ);
+
+			__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), zero));
+			__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(hit.distance)));
+			mask = _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+			_mm_storeu_ps(entryDistances, enter);
+#endif
+		}
+		else {
+			for (int lane = 0; lane < 4; ++lane) {
+				AABB box(glm::vec3(node.minX[lane], node.minY[lane], node.minZ[lane]), glm::vec3(node.maxX[lane], node.maxY[lane], node.maxZ[lane]));
+				entryDistances[lane] = ray.intersect(box, hit.distance);
+				if (entryDistances[lane] != FLT_MAX) mask |= 1 << lane;
+			}
+		}
+
+		//push the hit children farthest first so that the nearest is visited next
+		uint32_t lanes[4];
+		uint32_t laneCount = 0;
+		for (uint32_t lane = 0; lane < 4; ++lane) {
+			if (!(mask & (1 << lane)) || node.children[lane] == EmptyChild) continue;
+
+			uint32_t position = laneCount++;
+			while (position > 0 && entryDistances[lanes[position - 1]] < entryDistances[lane]) {
+				lanes[position] = lanes[position - 1];
+				position--;
+			}
+			lanes[position] = lane;
+		}
+
+		for (uint32_t i = 0; i < laneCount && stackSize < StackSize; ++i) {
+			uint32_t lane = lanes[i];
+			stack[stackSize++] = { node.children[lane], node.childPacketCounts[lane], entryDistances[lane] };
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+
+class SceneBVH;
+
+struct MeshHit {
+	float distance = FLT_MAX;	//in units of the ray direction
+	uint32_t triangle = 0;
+	float u = 0.0f;	//barycentric weight of the second vertex
+	float v = 0.0f;	//barycentric weight of the third vertex
+};
+
+//four wide bounding volume hierarchy over the triangles of one mesh, in model space
+//a ray is tested against the four child boxes of a node and against four triangles at a time
+class MeshBVH
+{
+public:
+	void build(const float* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+	bool isEmpty() const { return nodes.empty(); }
+	uint32_t getTriangleCount() const { return triangleCount; }
+
+	// Nearest triangle hit before hit.distance, hit is only written when something closer is found
+	bool raycast(const Ray& ray, MeshHit& hit) const;
+	bool raycastScalar(const Ray& ray, MeshHit& hit) const;	// Same result without SIMD, the reference for the benchmark
+	bool raycast(const Ray& worldRay, const glm::mat4& worldToModel, MeshHit& hit) const;	// For an instance placed in the world, distances stay in world ray units
+
+private:
+	static constexpr uint32_t LeafBit = 0x80000000u;
+	static constexpr uint32_t EmptyChild = 0xFFFFFFFFu;
+	static constexpr uint32_t StackSize = 128;
+
+	//child boxes as structure of arrays, an inner child is a node index and a leaf child is
+	//LeafBit | first packet with childPacketCounts packets
+	struct alignas(16) Node {
+		float minX[4], minY[4], minZ[4];
+		float maxX[4], maxY[4], maxZ[4];
+		uint32_t children[4];
+		uint32_t childPacketCounts[4];
+	};
+
+	//four triangles in the layout of the Moller-Trumbore test, unused lanes have zero edges
+	struct alignas(16) TrianglePacket {
+		float v0x[4], v0y[4], v0z[4];
+		float e1x[4], e1y[4], e1z[4];
+		float e2x[4], e2y[4], e2z[4];
+		uint32_t triangles[4];
+	};
+
+	template<bool Simd>
+	bool traverse(const Ray& ray, MeshHit& hit) const;
+
+	//the binary SAH tree is collapsed into four wide nodes by opening the largest inner children
+	static uint32_t collapse(const SceneBVH& binary, uint32_t binaryNode, const glm::vec3* corners,
+		std::vector<Node>& nodes, std::vector<TrianglePacket>& packets);
+
+	std::vector<Node> nodes;
+	std::vector<TrianglePacket> packets;
+	uint32_t triangleCount = 0;
+};
@@ -6,27 +6,42 @@
 #include "Model.h"
 #include "Mesh.h"
 #include "SceneObject.h"
+#include "ObjectPool.h"
+#include "EntityStore.h"
 
 // Define static members
+TransformStore* Model::transforms = nullptr;
+ObjectPool<SceneObject>* Model::sceneObjects = nullptr;
+ObjectPool<Mesh>* Model::meshes = nullptr;
+SceneLists* Model::lists = nullptr;
+vector<SceneObject*> Model::childStack;
+EntityStore* Model::entities = nullptr;
+vector<bool> Model::animatedNodes;
 wgpu::Device Model::device = nullptr;
 wgpu::BindGroupLayout Model::textureBindGroupLayout = nullptr;
-wgpu::BindGroupLayout Model::modelBindGroupLayout = nullptr;
-wgpu::Buffer Model::modelUniformBuffer = nullptr;
-wgpu::TextureView Model::textureView = nullptr;
+custom::Texture* Model::texture = nullptr;
 wgpu::Sampler Model::sampler = nullptr;
 
 SceneObject* Model::LoadModel(const std::string& filePath,
+    TransformStore* pTransforms,
+    ObjectPool<SceneObject>* pSceneObjects,
+    ObjectPool<Mesh>* pMeshes,
+    SceneLists* pLists,
+    EntityStore* pEntities,
     wgpu::Device pDevice,
     wgpu::BindGroupLayout pTextureBindGroupLayout,
-    wgpu::BindGroupLayout pModelBindGroupLayout,
-    wgpu::TextureView pTextureView,
+    custom::Texture* pTexture,
     wgpu::Sampler pSampler) {
 
     // Use move semantics to avoid unnecessary copying
+    Model::transforms = pTransforms;
+    Model::sceneObjects = pSceneObjects;
+    Model::meshes = pMeshes;
+    Model::lists = pLists;
+    Model::entities = pEntities;
     Model::device = std::move(pDevice);
     Model::textureBindGroupLayout = std::move(pTextureBindGroupLayout);
-    Model::modelBindGroupLayout = std::move(pModelBindGroupLayout);
-    Model::textureView = std::move(pTextureView);
+    Model::texture = pTexture;
     Model::sampler = std::move(pSampler);
 
     tinygltf::Model model;
@@ -48,15 +63,22 @@ SceneObject* Model::LoadModel(const std::string& filePath,
         printf("Warn: %s\n", warn.c_str());
     }
 
-    auto rootSceneObject = std::make_unique<SceneObject>(&Model::device, &Model::modelBindGroupLayout);
-    processData(model, rootSceneObject.get());
+    SceneObject* rootSceneObject = Model::sceneObjects->create(Model::transforms, Model::lists);
+    processData(model, rootSceneObject);
 
-    return rootSceneObject.release();
+    return rootSceneObject;
 }
 
 void Model::processData(const tinygltf::Model& model, SceneObject* rootSceneObject) {
     std::cout << "processing data\n";
 
+    Model::animatedNodes.assign(model.nodes.size(), false);
+    for (const auto& animation : model.animations) {
+        for (const auto& channel : animation.channels) {
+            if (channel.target_node >= 0) Model::animatedNodes[channel.target_node] = true;
+        }
+    }
+
     for (const auto& scene : model.scenes) {
         processScene(scene, model, rootSceneObject);
     }
@@ -67,24 +89,29 @@ void Model::processScene(const tinygltf::Scene& scene, const tinygltf::Model& mo
 
     std::cout << "processing scene\n";
 
+    //the subtrees add their own lists first, so the children of one node stay one range
+    size_t firstChild = Model::childStack.size();
     for (const auto nodeIdx : scene.nodes) {
         auto& node = model.nodes[nodeIdx];
-        auto child = processNode(node, model);
-        rootSceneObject->addChild(child);
+        Model::childStack.push_back(processNode(node, model, Model::animatedNodes[nodeIdx]));
+    }
+    for (size_t i = firstChild; i < Model::childStack.size(); ++i) {
+        rootSceneObject->addChild(Model::childStack[i]);
     }
+    Model::childStack.resize(firstChild);
 }
 
-SceneObject* Model::processNode(const tinygltf::Node& node, const tinygltf::Model& model) {
+SceneObject* Model::processNode(const tinygltf::Node& node, const tinygltf::Model& model, bool dynamic) {
     std::cout << "processing node\n";
 
-    glm::vec3 localTranslation = node.translation.size() == 0 ? glm::vec3() :
+    glm::vec3 localTranslation = node.translation.size() == 0 ? glm::vec3(0.0f) :
         glm::vec3((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]);
-    glm::quat localRotation = node.rotation.size() == 0 ? glm::quat() :
+    glm::quat localRotation = node.rotation.size() == 0 ? glm::quat(1.0f, 0.0f, 0.0f, 0.0f) :
         glm::quat((float)node.rotation[3], (float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2]);
     glm::vec3 localScale = node.scale.size() == 0 ? glm::vec3(1, 1, 1) :
         glm::vec3((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]);
 
-    SceneObject* sceneObject = new SceneObject(&Model::device, &Model::modelBindGroupLayout);
+    SceneObject* sceneObject = Model::sceneObjects->create(Model::transforms, Model::lists);
     sceneObject->setTranslation(localTranslation);
     sceneObject->setRotation(localRotation);
     sceneObject->setScale(localScale);
@@ -93,15 +120,27 @@ SceneObject* Model::processNode(const tinygltf::Node& node, const tinygltf::Mode
         const auto& mesh = model.meshes[node.mesh];
         for (const auto& primitive : mesh.primitives) {
             auto meshPrimitive = processPrimitive(primitive, model);
-            sceneObject->addVisualObject(std::move(meshPrimitive));
+            sceneObject->addVisualObject(meshPrimitive);
+
+            uint32_t entity = Model::entities->create(EntityStore::Transform | EntityStore::MeshRenderer | EntityStore::Bounds
+                | (dynamic ? EntityStore::DynamicTag : EntityStore::StaticTag));
+            Model::entities->getTransform(entity)->transformId = sceneObject->getTransformId();
+            Model::entities->getMeshRenderer(entity)->mesh = meshPrimitive;
+            BoundsComponent* bounds = Model::entities->getBounds(entity);
+            bounds->localBounds = meshPrimitive->getLocalBounds();
+            bounds->localSphere = meshPrimitive->getLocalSphere();
         }
     }
 
+    size_t firstChild = Model::childStack.size();
     for (const auto& childIdx : node.children) {
         auto& childNode = model.nodes[childIdx];
-        auto childResult = processNode(childNode, model);
-        sceneObject->addChild(std::move(childResult));
+        Model::childStack.push_back(processNode(childNode, model, dynamic || Model::animatedNodes[childIdx]));
     }
+    for (size_t i = firstChild; i < Model::childStack.size(); ++i) {
+        sceneObject->addChild(Model::childStack[i]);
+    }
+    Model::childStack.resize(firstChild);
 
     return sceneObject;
 }
@@ -125,6 +164,19 @@ Mesh* Model::processPrimitive(const tinygltf::Primitive& primitive, const tinygl
     size_t vertexCount = 0;
     extractBufferData("POSITION", 3, vertices, vertexCount);
 
+    // glTF requires min/max on POSITION accessors, the mesh only scans the vertices when a file omits them
+    AABB bounds;
+    bool hasBounds = false;
+    auto positionIt = primitive.attributes.find("POSITION");
+    if (positionIt != primitive.attributes.end()) {
+        const auto& accessor = model.accessors[positionIt->second];
+        if (accessor.minValues.size() == 3 && accessor.maxValues.size() == 3) {
+            bounds = AABB(glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]),
+                glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]));
+            hasBounds = true;
+        }
+    }
+
     const float* normals = nullptr;
     size_t normalCount = 0;
     extractBufferData("NORMAL", 3, normals, normalCount);
@@ -140,10 +192,10 @@ Mesh* Model::processPrimitive(const tinygltf::Primitive& primitive, const tinygl
         const auto& accessor = model.accessors[primitive.indices];
         const auto& bufferView = model.bufferViews[accessor.bufferView];
         const auto& buffer = model.buffers[bufferView.buffer];
-        if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_SHORT) {
+        if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_SHORT || accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
             indexFormat = wgpu::IndexFormat::Uint16;
         }
-        else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_INT) {
+        else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_INT || accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
             indexFormat = wgpu::IndexFormat::Uint32;
         }
         indices = &buffer.data[bufferView.byteOffset + accessor.byteOffset];
@@ -151,6 +203,6 @@ Mesh* Model::processPrimitive(const tinygltf::Primitive& primitive, const tinygl
     }
 
     std::cout << "creating mesh\n";
-    return new Mesh(vertices, vertexCount, indices, indexCount, indexFormat, normals, normalCount, uvs, uvCount,
-        Model::textureView, Model::textureBindGroupLayout, Model::device, Model::sampler);
+    return Model::meshes->create(vertices, vertexCount, indices, indexCount, indexFormat, normals, normalCount, uvs, uvCount,
+        Model::texture, Model::textureBindGroupLayout, Model::device, Model::sampler, hasBounds ? &bounds : nullptr);
 }
@@ -4,26 +4,41 @@
 #include <webgpu/webgpu.hpp>
 
 class SceneObject;
+struct SceneLists;
 class Mesh;
+class TransformStore;
+class EntityStore;
+template<typename T> class ObjectPool;
+namespace custom {
+	class Texture;
+}
 
 using namespace std;
 
 class Model
 {
 public:
-	static SceneObject* LoadModel(const string& filePath, wgpu::Device device, wgpu::BindGroupLayout textureBindGroupLayout, 
-		wgpu::BindGroupLayout modelBindGroupLayout, wgpu::TextureView textureView, wgpu::Sampler sampler);
+	// The scene objects and meshes are created in the given pools and their child and mesh lists in
+	// `lists`, all live until they are cleared; every primitive also becomes an entity with transform,
+	// mesh renderer and bounds components
+	static SceneObject* LoadModel(const string& filePath, TransformStore* transforms, ObjectPool<SceneObject>* sceneObjects, ObjectPool<Mesh>* meshes,
+		SceneLists* lists, EntityStore* entities, wgpu::Device device, wgpu::BindGroupLayout textureBindGroupLayout, custom::Texture* texture, wgpu::Sampler sampler);
 
 private:
 	static void processData(const tinygltf::Model& model, SceneObject* rootSceneObject);
 	static void processScene(const tinygltf::Scene& scene, const tinygltf::Model& model, SceneObject* rootSceneObject);
-	static SceneObject* processNode(const tinygltf::Node& node, const tinygltf::Model& model);
+	static SceneObject* processNode(const tinygltf::Node& node, const tinygltf::Model& model, bool dynamic);	// Dynamic when the node or an ancestor is animated
 	static Mesh* processPrimitive(const tinygltf::Primitive& primitive, const tinygltf::Model& model);
+	static TransformStore* transforms;
+	static ObjectPool<SceneObject>* sceneObjects;
+	static ObjectPool<Mesh>* meshes;
+	static SceneLists* lists;
+	static vector<SceneObject*> childStack;	//children of the nodes being processed, added to their parent all at once
+	static EntityStore* entities;
+	static vector<bool> animatedNodes;	//targets of the file's animation channels
 	static wgpu::Device device;
 	static wgpu::BindGroupLayout textureBindGroupLayout;
-	static wgpu::BindGroupLayout modelBindGroupLayout;
-	static wgpu::Buffer modelUniformBuffer;
-	static wgpu::TextureView textureView;
+	static custom::Texture* texture;
 	static wgpu::Sampler sampler;
 };
 
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//typed pool for objects that share a lifetime, e.g. the nodes and meshes of a loaded scene
+//objects are constructed into large chunks in creation order, so a tree built depth first is also
+//laid out depth first, and they are only destroyed all at once by clear(), which keeps the chunks
+//for the next scene: no per object heap allocation on creation and no per object free on teardown
+template<typename T>
+class ObjectPool
+{
+public:
+	explicit ObjectPool(size_t chunkSize = 1024) : chunkSize(chunkSize) {}
+	~ObjectPool() { clear(); }
+
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	template<typename... Args>
+	T* create(Args&&... args)
+	{
+		size_t chunk = this->count / this->chunkSize;
+		if (chunk == this->chunks.size()) {
+			this->chunks.push_back(std::unique_ptr<Slot[]>(new Slot[this->chunkSize]));	//left uninitialized
+		}
+		T* object = new (&this->chunks[chunk][this->count % this->chunkSize]) T(std::forward<Args>(args)...);
+		this->count++;
+		return object;
+	}
+
+	// Destroys every object, newest first, trivially destructible types cost nothing
+	void clear()
+	{
+		if (!std::is_trivially_destructible<T>::value) {
+			for (size_t i = this->count; i-- > 0;) {
+				reinterpret_cast<T*>(&this->chunks[i / this->chunkSize][i % this->chunkSize])->~T();
+			}
+		}
+		this->count = 0;
+	}
+
+	// Also gives the chunks back to the heap
+	void release()
+	{
+		clear();
+		this->chunks.clear();
+		this->chunks.shrink_to_fit();
+	}
+
+	size_t size() const { return count; }
+	size_t getChunkCount() const { return chunks.size(); }
+
+private:
+	struct Slot {
+		alignas(T) unsigned char bytes[sizeof(T)];
+	};
+
+	size_t chunkSize;
+	size_t count = 0;
+	std::vector<std::unique_ptr<Slot[]>> chunks;
+};
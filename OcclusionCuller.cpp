@@ -0,0 +1,313 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define OCCLUSION_CULLER_SSE
+#  include <emmintrin.h>
+#endif
+
+//clip space w below which a vertex counts as behind the camera
+static constexpr float MinClipW = 1e-5f;
+
+static uint32_t nextPowerOfTwo(uint32_t value)
+{
+	uint32_t power = 1;
+	while (power < value) power *= 2;
+	return power;
+}
+
+void OcclusionCuller::initialize(uint32_t width, uint32_t height)
+{
+	//rows are rasterized four pixels at a time and every pyramid level halves the one below
+	this->width = nextPowerOfTwo(std::max(4u, width));
+	this->height = nextPowerOfTwo(std::max(1u, height));
+	this->depth.assign((size_t)this->width * this->height, 1.0f);
+
+	this->levelOffsets.assign(1, 0);
+	uint32_t pyramidSize = 0;
+	uint32_t levelWidth = this->width;
+	uint32_t levelHeight = this->height;
+	while (levelWidth > 1 || levelHeight > 1) {
+		levelWidth = std::max(1u, levelWidth / 2);
+		levelHeight = std::max(1u, levelHeight / 2);
+		this->levelOffsets.push_back(pyramidSize);
+		pyramidSize += levelWidth * levelHeight;
+	}
+	this->levelCount = (uint32_t)this->levelOffsets.size();
+	this->pyramid.assign(pyramidSize, 1.0f);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	this->occluders.clear();
+	this->stats = Stats();
+}
+
+void OcclusionCuller::addOccluder(const float* positions, size_t vertexCount, const void* indices, bool indices32, size_t indexCount, const glm::mat4& world)
+{
+	if (indexCount < 3) return;
+
+	Occluder occluder;
+	occluder.positions = positions;
+	occluder.vertexCount = vertexCount;
+	occluder.indices = indices;
+	occluder.indices32 = indices32;
+	occluder.indexCount = indexCount;
+	occluder.world = world;
+	occluder.firstTriangle = 0;	//assigned by rasterize
+	this->occluders.push_back(occluder);
+}
+
+void OcclusionCuller::rasterize(JobSystem* jobs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//every occluder owns a fixed range of triangle setups, so that they can be filled in parallel
+	uint32_t triangleCount = 0;
+	for (Occluder& occluder : this->occluders) {
+		occluder.firstTriangle = triangleCount;
+		triangleCount += (uint32_t)(occluder.indexCount / 3);
+	}
+	this->triangles.resize(triangleCount);
+	std::fill(this->depth.begin(), this->depth.end(), 1.0f);
+
+	uint32_t threadCount = jobs ? jobs->getThreadCount() : 1;
+	if (threadCount > 1 && this->occluders.size() > 1) {
+		size_t chunkCount = std::min(this->occluders.size(), (size_t)threadCount * 4);
+		jobs->parallelFor(this->occluders.size(), chunkCount, [&](size_t begin, size_t end, size_t) {
+			for (size_t i = begin; i < end; ++i) setupTriangles(this->occluders[i]);
+			});
+	}
+	else {
+		for (const Occluder& occluder : this->occluders) setupTriangles(occluder);
+	}
+
+	//bands of rows are independent, every band walks all triangles and skips the ones outside it
+	if (threadCount > 1) {
+		size_t chunkCount = std::min((size_t)this->height, (size_t)threadCount * 4);
+		jobs->parallelFor(this->height, chunkCount, [&](size_t begin, size_t end, size_t) {
+			rasterizeRows((uint32_t)begin, (uint32_t)end);
+			});
+	}
+	else {
+		rasterizeRows(0, this->height);
+	}
+
+	buildPyramid();
+
+	this->stats.occluders = (uint32_t)this->occluders.size();
+	for (const TriangleSetup& triangle : this->triangles) {
+		if (triangle.minX <= triangle.maxX) this->stats.triangles++;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	this->stats.rasterMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void OcclusionCuller::setupTriangles(const Occluder& occluder)
+{
+	glm::mat4 worldViewProjection = this->viewProjection * occluder.world;
+	float screenScaleX = 0.5f * this->width;
+	float screenScaleY = -0.5f * this->height;
+	size_t triangleCount = occluder.indexCount / 3;
+
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+		TriangleSetup& setup = this->triangles[occluder.firstTriangle + triangle];
+		setup.minX = 1;
+		setup.maxX = 0;
+
+		//screen position in pixels, y down, and depth of the three corners
+		float x[3], y[3], z[3];
+		bool clipped = false;
+		for (uint32_t corner = 0; corner < 3; ++corner) {
+			size_t i = 3 * triangle + corner;
+			uint32_t index = occluder.indices32 ? static_cast<const uint32_t*>(occluder.indices)[i] : static_cast<const uint16_t*>(occluder.indices)[i];
+			if (index >= occluder.vertexCount) {
+				clipped = true;
+				break;
+			}
+			const float* position = occluder.positions + 3 * (size_t)index;
+			glm::vec4 clip = worldViewProjection * glm::vec4(position[0], position[1], position[2], 1.0f);
+
+			//triangles crossing the near plane are dropped instead of clipped, an occluder with
+			//fewer triangles can only hide fewer objects
+			if (clip.w < MinClipW || clip.z < 0.0f) {
+				clipped = true;
+				break;
+			}
+			float inverseW = 1.0f / clip.w;
+			x[corner] = (clip.x * inverseW + 1.0f) * screenScaleX;
+			y[corner] = (clip.y * inverseW - 1.0f) * screenScaleY;
+			z[corner] = clip.z * inverseW;
+		}
+		if (clipped) continue;
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (std::fabs(area) < 1e-8f) continue;
+		//both windings are drawn, flip clockwise triangles so that the inside is positive
+		if (area < 0.0f) {
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		//edge i is opposite to corner i, so its value is the barycentric weight of that corner
+		for (uint32_t edge = 0; edge < 3; ++edge) {
+			uint32_t a = (edge + 1) % 3;
+			uint32_t b = (edge + 2) % 3;
+			setup.edgeA[edge] = y[a] - y[b];
+			setup.edgeB[edge] = x[b] - x[a];
+			setup.edgeC[edge] = -(setup.edgeA[edge] * x[a] + setup.edgeB[edge] * y[a]);
+		}
+		float inverseArea = 1.0f / area;
+		setup.depthA = (setup.edgeA[0] * z[0] + setup.edgeA[1] * z[1] + setup.edgeA[2] * z[2]) * inverseArea;
+		setup.depthB = (setup.edgeB[0] * z[0] + setup.edgeB[1] * z[1] + setup.edgeB[2] * z[2]) * inverseArea;
+		setup.depthC = (setup.edgeC[0] * z[0] + setup.edgeC[1] * z[1] + setup.edgeC[2] * z[2]) * inverseArea;
+
+		//pixels whose centers can lie inside the triangle
+		float minX = std::min({ x[0], x[1], x[2] });
+		float maxX = std::max({ x[0], x[1], x[2] });
+		float minY = std::min({ y[0], y[1], y[2] });
+		float maxY = std::max({ y[0], y[1], y[2] });
+		if (maxX < 0.0f || maxY < 0.0f || minX > (float)this->width || minY > (float)this->height) continue;
+		setup.minX = std::max(0, (int32_t)std::ceil(minX - 0.5f));
+		setup.maxX = std::min((int32_t)this->width - 1, (int32_t)std::floor(maxX - 0.5f));
+		setup.minY = std::max(0, (int32_t)std::ceil(minY - 0.5f));
+		setup.maxY = std::min((int32_t)this->height - 1, (int32_t)std::floor(maxY - 0.5f));
+		if (setup.minY > setup.maxY) setup.maxX = setup.minX - 1;
+	}
+}
+
+void OcclusionCuller::rasterizeRows(uint32_t firstRow, uint32_t lastRow)
+{
+	for (const TriangleSetup& triangle : this->triangles) {
+		if (triangle.minX > triangle.maxX) continue;
+		int32_t rowBegin = std::max(triangle.minY, (int32_t)firstRow);
+		int32_t rowEnd = std::min(triangle.maxY, (int32_t)lastRow - 1);
+		int32_t columnBegin = triangle.minX & ~3;
+
+		for (int32_t row = rowBegin; row <= rowEnd; ++row) {
+			float pixelY = (float)row + 0.5f;
+			float* depthRow = this->depth.data() + (size_t)row * this->width;
+			float rowEdges[3];
+			for (uint32_t edge = 0; edge < 3; ++edge) rowEdges[edge] = triangle.edgeB[edge] * pixelY + triangle.edgeC[edge];
+			float rowDepth = triangle.depthB * pixelY + triangle.depthC;
+
+#ifdef OCCLUSION_CULLER_SSE
+			//four pixels per step, the width is a multiple of four so the last step stays in the row
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+			const __m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+			const __m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+			const __m128 rowEdge0 = _mm_set1_ps(rowEdges[0]);
+			const __m128 rowEdge1 = _mm_set1_ps(rowEdges[1]);
+			const __m128 rowEdge2 = _mm_set1_ps(rowEdges[2]);
+			const __m128 depthA = _mm_set1_ps(triangle.depthA);
+			const __m128 rowDepths = _mm_set1_ps(rowDepth);
+
+			for (int32_t column = columnBegin; column <= triangle.maxX; column += 4) {
+				__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)column), laneOffsets);
+				__m128 edge0 = _mm_add_ps(_mm_mul_ps(edgeA0, pixelX), rowEdge0);
+				__m128 edge1 = _mm_add_ps(_mm_mul_ps(edgeA1, pixelX), rowEdge1);
+				__m128 edge2 = _mm_add_ps(_mm_mul_ps(edgeA2, pixelX), rowEdge2);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+				if (_mm_movemask_ps(inside) == 0) continue;
+
+				__m128 pixelDepth = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepths);
+				__m128 stored = _mm_loadu_ps(depthRow + column);
+				__m128 nearest = _mm_min_ps(stored, pixelDepth);
+				_mm_storeu_ps(depthRow + column, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+			}
+#else
+			for (int32_t column = columnBegin; column <= triangle.maxX; ++column) {
+				float pixelX = (float)column + 0.5f;
+				if (triangle.edgeA[0] * pixelX + rowEdges[0] < 0.0f) continue;
+				if (triangle.edgeA[1] * pixelX + rowEdges[1] < 0.0f) continue;
+				if (triangle.edgeA[2] * pixelX + rowEdges[2] < 0.0f) continue;
+				depthRow[column] = std::min(depthRow[column], triangle.depthA * pixelX + rowDepth);
+			}
+#endif
+		}
+	}
+}
+
+void OcclusionCuller::buildPyramid()
+{
+	//every texel keeps the farthest depth below it, so that a box in front of it may be visible
+	const float* source = this->depth.data();
+	uint32_t sourceWidth = this->width;
+	uint32_t sourceHeight = this->height;
+
+	for (uint32_t level = 1; level < this->levelCount; ++level) {
+		uint32_t levelWidth = std::max(1u, sourceWidth / 2);
+		uint32_t levelHeight = std::max(1u, sourceHeight / 2);
+		float* destination = this->pyramid.data() + this->levelOffsets[level];
+
+		for (uint32_t y = 0; y < levelHeight; ++y) {
+			const float* row0 = source + (size_t)std::min(2 * y, sourceHeight - 1) * sourceWidth;
+			const float* row1 = source + (size_t)std::min(2 * y + 1, sourceHeight - 1) * sourceWidth;
+			for (uint32_t x = 0; x < levelWidth; ++x) {
+				uint32_t x0 = std::min(2 * x, sourceWidth - 1);
+				uint32_t x1 = std::min(2 * x + 1, sourceWidth - 1);
+				destination[(size_t)y * levelWidth + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+			}
+		}
+
+		source = destination;
+		sourceWidth = levelWidth;
+		sourceHeight = levelHeight;
+	}
+}
+
+bool OcclusionCuller::isVisible(const AABB& worldBounds) const
+{
+	if (this->stats.triangles == 0 || worldBounds.isEmpty()) return true;
+
+	float minX = FLT_MAX, minY = FLT_MAX, minDepth = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (uint32_t corner = 0; corner < 8; ++corner) {
+		glm::vec4 position(
+			corner & 1 ? worldBounds.max.x : worldBounds.min.x,
+			corner & 2 ? worldBounds.max.y : worldBounds.min.y,
+			corner & 4 ? worldBounds.max.z : worldBounds.min.z,
+			1.0f);
+		glm::vec4 clip = this->viewProjection * position;
+		//boxes reaching the near plane cover the whole screen
+		if (clip.w < MinClipW || clip.z < 0.0f) return true;
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW + 1.0f) * 0.5f * this->width;
+		float y = (1.0f - clip.y * inverseW) * 0.5f * this->height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minDepth = std::min(minDepth, clip.z * inverseW);
+	}
+
+	//boxes outside the viewport are left to frustum culling
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)this->width || minY >= (float)this->height) return true;
+
+	//every pixel the box touches, then the pyramid level where that is at most 4x4 texels
+	int32_t x0 = std::max(0, (int32_t)std::floor(minX));
+	int32_t x1 = std::min((int32_t)this->width - 1, (int32_t)std::floor(maxX));
+	int32_t y0 = std::max(0, (int32_t)std::floor(minY));
+	int32_t y1 = std::min((int32_t)this->height - 1, (int32_t)std::floor(maxY));
+	uint32_t level = 0;
+	while (level + 1 < this->levelCount && ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4)) ++level;
+
+	uint32_t levelWidth = std::max(1u, this->width >> level);
+	const float* texels = level == 0 ? this->depth.data() : this->pyramid.data() + this->levelOffsets[level];
+	for (int32_t y = y0 >> level; y <= y1 >> level; ++y) {
+		for (int32_t x = x0 >> level; x <= x1 >> level; ++x) {
+			if (texels[(size_t)y * levelWidth + x] >= minDepth) return true;
+		}
+	}
+	return false;
+}
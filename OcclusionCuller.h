@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+class JobSystem;
+
+//software occlusion culling: a few large occluder meshes are rasterized on the CPU into a low
+//resolution depth buffer, then the bounding boxes of objects are tested against a max depth
+//pyramid of it before their draws are emitted
+//depth follows the GPU convention, 0 at the near plane and 1 at the far plane
+class OcclusionCuller
+{
+public:
+	struct Stats {
+		uint32_t occluders = 0;
+		uint32_t triangles = 0;	//occluder triangles that reached the rasterizer
+		double rasterMilliseconds = 0.0;	//transform, rasterization and pyramid
+	};
+
+	void initialize(uint32_t width, uint32_t height);	// Rounded up to powers of two, the width to at least 4
+	uint32_t getWidth() const { return width; }
+	uint32_t getHeight() const { return height; }
+
+	void beginFrame(const glm::mat4& viewProjection);
+	// The buffers are only read by rasterize(), so they have to stay alive until then
+	void addOccluder(const float* positions, size_t vertexCount, const void* indices, bool indices32, size_t indexCount, const glm::mat4& world);
+	void rasterize(JobSystem* jobs);	// Draw the occluders and build the depth pyramid
+
+	bool isVisible(const AABB& worldBounds) const;	// False only when the box is behind the occluders everywhere
+
+	const Stats& getStats() const { return stats; }
+	const float* getDepth() const { return depth.data(); }	// Level 0, row major, for debugging
+
+private:
+	struct Occluder {
+		const float* positions;
+		size_t vertexCount;
+		const void* indices;
+		bool indices32;
+		size_t indexCount;
+		glm::mat4 world;
+		uint32_t firstTriangle;	//in the triangle setup array
+	};
+
+	//edge functions and depth plane of a screen space triangle, evaluated as a * x + b * y + c
+	struct TriangleSetup {
+		float edgeA[3], edgeB[3], edgeC[3];
+		float depthA, depthB, depthC;
+		int32_t minX, maxX, minY, maxY;	//pixel bounds, minX > maxX when the triangle is skipped
+	};
+
+	void setupTriangles(const Occluder& occluder);
+	void rasterizeRows(uint32_t firstRow, uint32_t lastRow);
+	void buildPyramid();
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+
+	std::vector<Occluder> occluders;
+	std::vector<TriangleSetup> triangles;
+	std::vector<float> depth;	//closest occluder per pixel
+	std::vector<float> pyramid;	//farthest occluder depth per texel of every level, level 1 first
+	std::vector<uint32_t> levelOffsets;	//start of every level in pyramid, level 0 is depth
+	uint32_t levelCount = 0;
+
+	Stats stats;
+};
@@ -0,0 +1,99 @@
+#include "ParallelBundles.h"
+#include "IndirectDraws.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "TransformBuffer.h"
+#include <algorithm>
+
+using namespace wgpu;
+
+void ParallelBundles::terminate()
+{
+	release();
+	this->device = nullptr;
+}
+
+void ParallelBundles::release()
+{
+	for (RenderBundle& bundle : this->bundles) {
+		if (bundle) bundle.release();
+	}
+	this->bundles.clear();
+}
+
+void ParallelBundles::record(const std::vector<Draw>& draws, const Target& target, JobSystem& jobs)
+{
+	release();
+	if (draws.empty()) return;
+
+	//one range per thread, fewer when the ranges would get too small to pay for their bundle
+	size_t bundleCount = std::max<size_t>(1, std::min<size_t>(jobs.getThreadCount(), draws.size() / MinBundleDraws));
+	this->bundles.resize(bundleCount, nullptr);
+	jobs.parallelFor(draws.size(), bundleCount, [&](size_t begin, size_t end, size_t bundle) {
+		this->bundles[bundle] = recordRange(draws.data() + begin, end - begin, target);
+		});
+}
+
+RenderBundle ParallelBundles::recordRange(const Draw* draws, size_t drawCount, const Target& target) const
+{
+	//the same attachments as the scene pass, which writes depth and never stencil
+	WGPUTextureFormat colorFormat = target.colorFormat;
+	RenderBundleEncoderDescriptor encoderDescriptor = Default;
+	encoderDescriptor.label = "Draw List Bundle Encoder";
+	encoderDescriptor.colorFormatCount = 1;
+	encoderDescriptor.colorFormats = &colorFormat;
+	encoderDescriptor.depthStencilFormat = target.depthFormat;
+	encoderDescriptor.sampleCount = 1;
+	encoderDescriptor.depthReadOnly = false;
+	encoderDescriptor.stencilReadOnly = true;
+	RenderBundleEncoder encoder = this->device.createRenderBundleEncoder(encoderDescriptor);
+
+	encoder.setPipeline(target.pipeline);
+	encoder.setBindGroup(0, target.cameraBindGroup, 0, nullptr);
+	if (target.objectBindGroup) {
+		encoder.setBindGroup(1, target.objectBindGroup, 0, nullptr);
+	}
+	Buffer argumentBuffer = target.indirectDraws ? target.indirectDraws->getArgumentBuffer() : nullptr;
+
+	//every bundle starts with nothing bound, so only the changes between its own draws are recorded
+	Mesh* boundMesh = nullptr;
+	custom::Texture* boundTexture = nullptr;
+	for (size_t i = 0; i < drawCount; ++i) {
+		const Draw& draw = draws[i];
+		Mesh* mesh = draw.mesh;
+		if (mesh != boundMesh) {
+			Buffer vertexBuffer = mesh->getVertexBuffer();
+			Buffer normalBuffer = mesh->getNormalBuffer();
+			Buffer uvBuffer = mesh->getUVBuffer();
+			Buffer indexBuffer = mesh->getIndexBuffer();
+			encoder.setVertexBuffer(0, vertexBuffer, 0, vertexBuffer.getSize());
+			encoder.setVertexBuffer(1, normalBuffer, 0, normalBuffer.getSize());
+			encoder.setVertexBuffer(2, uvBuffer, 0, uvBuffer.getSize());
+			encoder.setIndexBuffer(indexBuffer, mesh->getIndexFormat(), 0, indexBuffer.getSize());
+			if (mesh->getTexture() != boundTexture || boundMesh == nullptr) {
+				encoder.setBindGroup(2, mesh->getTextureBindGroup(), 0, nullptr);
+				boundTexture = mesh->getTexture();
+			}
+			boundMesh = mesh;
+		}
+
+		if (argumentBuffer) {
+			encoder.drawIndexedIndirect(argumentBuffer, target.indirectDraws->getArgumentOffset(draw.index));
+			continue;
+		}
+
+		//with the transform table the first instance is the index of the model matrix
+		if (!target.objectBindGroup) {
+			uint32_t modelOffset = target.transforms->getOffset(draw.transformSlot);
+			encoder.setBindGroup(1, target.transforms->getBindGroup(), 1, &modelOffset);
+		}
+		uint32_t firstInstance = target.objectBindGroup ? draw.transformSlot : 0;
+		encoder.drawIndexed((uint32_t)mesh->getNumIndices(), 1, 0, 0, firstInstance);
+	}
+
+	RenderBundleDescriptor bundleDescriptor = Default;
+	bundleDescriptor.label = "Draw List Bundle";
+	RenderBundle bundle = encoder.finish(bundleDescriptor);
+	encoder.release();
+	return bundle;
+}
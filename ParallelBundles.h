@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+
+class IndirectDraws;
+class JobSystem;
+class Mesh;
+class TransformBuffer;
+
+//the draw list of a frame recorded into render bundles on the worker threads: the draws are cut
+//into contiguous ranges in encoding order, each range is recorded by one job into its own bundle and
+//the bundles are executed in range order, so the pass draws what the serial encoding would have
+//drawn; the bundles are recorded again every frame (needs the implicit device synchronization
+//feature, the device is otherwise used from one thread only)
+class ParallelBundles
+{
+public:
+	static constexpr uint32_t MinBundleDraws = 1024;	//smaller ranges cost more in bundles than they save
+
+	// One draw, its mesh already resident
+	struct Draw {
+		Mesh* mesh = nullptr;
+		uint32_t transformSlot = 0;
+		uint32_t index = 0;	//position in the draw list, the indirect arguments of the draw
+	};
+
+	// What the bundles bind
+	struct Target {
+		wgpu::RenderPipeline pipeline = nullptr;
+		wgpu::BindGroup cameraBindGroup = nullptr;
+		wgpu::BindGroup objectBindGroup = nullptr;	//group 1 bound once per bundle, null for a dynamic offset per draw into transforms
+		const TransformBuffer* transforms = nullptr;
+		const IndirectDraws* indirectDraws = nullptr;	//when set each draw is drawIndexedIndirect from the arguments of its index
+		wgpu::TextureFormat colorFormat = wgpu::TextureFormat::Undefined;
+		wgpu::TextureFormat depthFormat = wgpu::TextureFormat::Undefined;
+	};
+
+	void initialize(wgpu::Device device) { this->device = device; }
+	void terminate();
+
+	// Records the draws into one bundle per thread of `jobs` at most, the previous bundles are released
+	void record(const std::vector<Draw>& draws, const Target& target, JobSystem& jobs);
+	const std::vector<wgpu::RenderBundle>& getBundles() const { return bundles; }	// In draw order
+	void release();	// Once the bundles are executed, the pass keeps them alive
+
+private:
+	wgpu::RenderBundle recordRange(const Draw* draws, size_t drawCount, const Target& target) const;
+
+	wgpu::Device device = nullptr;
+	std::vector<wgpu::RenderBundle> bundles;
+};
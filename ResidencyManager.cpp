@@ -0,0 +1,190 @@
+#include "ResidencyManager.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include <chrono>
+#include <iostream>
+
+void ResidencyManager::initialize(wgpu::Device device, uint64_t budgetBytes)
+{
+	this->device = device;
+	this->queue = device.getQueue();
+	this->budgetBytes = budgetBytes;
+}
+
+void ResidencyManager::terminate()
+{
+	this->entries.clear();
+	this->lookup.clear();
+	this->residentBytes = 0;
+
+	if (this->queue) this->queue.release();
+	this->queue = nullptr;
+	this->device = nullptr;
+}
+
+void ResidencyManager::registerMesh(Mesh* mesh)
+{
+	if (this->lookup.count(mesh)) return;
+
+	Entry entry;
+	entry.mesh = mesh;
+	entry.resident = mesh->isResident();
+	entry.bytes = mesh->getGpuBytes();
+	entry.lastUsedFrame = this->frame;
+	this->residentBytes += entry.bytes;
+
+	this->entries.push_front(entry);
+	this->lookup[mesh] = this->entries.begin();
+}
+
+void ResidencyManager::registerTexture(custom::Texture* texture)
+{
+	if (this->lookup.count(texture)) return;
+
+	Entry entry;
+	entry.texture = texture;
+	entry.resident = texture->IsResident();
+	entry.bytes = texture->GetGpuBytes();
+	entry.lastUsedFrame = this->frame;
+	this->residentBytes += entry.bytes;
+
+	this->entries.push_front(entry);
+	this->lookup[texture] = this->entries.begin();
+}
+
+void ResidencyManager::unregisterMesh(Mesh* mesh)
+{
+	auto it = this->lookup.find(mesh);
+	if (it == this->lookup.end()) return;
+
+	this->residentBytes -= it->second->bytes;
+	this->entries.erase(it->second);
+	this->lookup.erase(it);
+}
+
+void ResidencyManager::unregisterTexture(custom::Texture* texture)
+{
+	auto it = this->lookup.find(texture);
+	if (it == this->lookup.end()) return;
+
+	this->residentBytes -= it->second->bytes;
+	this->entries.erase(it->second);
+	this->lookup.erase(it);
+}
+
+void ResidencyManager::beginFrame()
+{
+	this->frame++;
+	this->frameCounters = Counters();
+}
+
+bool ResidencyManager::useMesh(Mesh* mesh)
+{
+	auto it = this->lookup.find(mesh);
+	if (it == this->lookup.end()) return mesh->isResident();
+
+	//the texture goes first so that the mesh bind group can point to the reloaded view; a texture
+	//that could not be reloaded leaves the mesh out instead of binding a released view
+	custom::Texture* texture = mesh->getTexture();
+	if (texture) {
+		auto textureIt = this->lookup.find(texture);
+		if (textureIt != this->lookup.end()) {
+			touch(textureIt->second);
+		}
+		if (!texture->IsResident()) return false;
+	}
+
+	touch(it->second);
+	mesh->refreshTextureBindGroup(this->device);
+
+	return mesh->isResident();
+}
+
+void ResidencyManager::endFrame()
+{
+	//walk from the least recently used entry and never evict anything used this frame
+	auto it = this->entries.end();
+	while (this->residentBytes > this->budgetBytes && it != this->entries.begin()) {
+		--it;
+		if (it->lastUsedFrame >= this->frame) break;
+		if (!it->resident) continue;
+
+		evict(*it);
+	}
+
+	this->totalCounters.misses += this->frameCounters.misses;
+	this->totalCounters.evictions += this->frameCounters.evictions;
+	this->totalCounters.reuploadBytes += this->frameCounters.reuploadBytes;
+	this->totalCounters.reuploadMilliseconds += this->frameCounters.reuploadMilliseconds;
+	this->totalCounters.failures += this->frameCounters.failures;
+}
+
+void ResidencyManager::printCounters() const
+{
+	std::cout << "Residency: " << this->residentBytes << " / " << this->budgetBytes << " bytes resident" << std::endl;
+	std::cout << "  frame: misses " << this->frameCounters.misses
+		<< ", evictions " << this->frameCounters.evictions
+		<< ", re-uploaded " << this->frameCounters.reuploadBytes << " bytes in "
+		<< this->frameCounters.reuploadMilliseconds << " ms, failed " << this->frameCounters.failures << std::endl;
+	std::cout << "  total: misses " << this->totalCounters.misses
+		<< ", evictions " << this->totalCounters.evictions
+		<< ", re-uploaded " << this->totalCounters.reuploadBytes << " bytes in "
+		<< this->totalCounters.reuploadMilliseconds << " ms, failed " << this->totalCounters.failures << std::endl;
+}
+
+void ResidencyManager::touch(EntryList::iterator entry)
+{
+	if (!entry->resident && !entry->failed) {
+		makeResident(*entry);
+	}
+	entry->lastUsedFrame = this->frame;
+
+	//move to the front of the list in O(1)
+	this->entries.splice(this->entries.begin(), this->entries, entry);
+}
+
+void ResidencyManager::makeResident(Entry& entry)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	uint64_t uploaded = 0;
+	if (entry.mesh) {
+		uploaded = entry.mesh->makeResident(this->device, this->queue);
+	}
+	else if (entry.texture) {
+		uploaded = entry.texture->MakeResident(this->device);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	bool resident = entry.mesh ? entry.mesh->isResident() : entry.texture->IsResident();
+	if (!resident) {
+		entry.failed = true;
+		this->frameCounters.failures++;
+		return;
+	}
+
+	entry.resident = true;
+	entry.bytes = uploaded;
+	this->residentBytes += uploaded;
+
+	this->frameCounters.misses++;
+	this->frameCounters.reuploadBytes += uploaded;
+	this->frameCounters.reuploadMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void ResidencyManager::evict(Entry& entry)
+{
+	if (entry.mesh) {
+		entry.mesh->evict();
+	}
+	else if (entry.texture) {
+		entry.texture->Evict();
+	}
+
+	this->residentBytes -= entry.bytes;
+	entry.resident = false;
+	entry.bytes = 0;
+
+	this->frameCounters.evictions++;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <webgpu/webgpu.hpp>
+
+class Mesh;
+namespace custom {
+	class Texture;
+}
+
+//keeps mesh and texture GPU memory under a budget by evicting the least recently used
+//resources and uploading them again from their CPU/disk copies when they are needed
+class ResidencyManager
+{
+public:
+	struct Counters {
+		uint64_t misses = 0;	//resources that had to be uploaded again when used
+		uint64_t evictions = 0;
+		uint64_t reuploadBytes = 0;
+		double reuploadMilliseconds = 0.0;	//frame time spent re-uploading
+		uint64_t failures = 0;	//resources that could not be uploaded again, they are not retried
+	};
+
+	void initialize(wgpu::Device device, uint64_t budgetBytes);
+	void terminate();
+
+	void setBudget(uint64_t budgetBytes) { this->budgetBytes = budgetBytes; }
+	uint64_t getBudget() const { return budgetBytes; }
+	uint64_t getResidentBytes() const { return residentBytes; }
+
+	void registerMesh(Mesh* mesh);
+	void registerTexture(custom::Texture* texture);
+	void unregisterMesh(Mesh* mesh);
+	void unregisterTexture(custom::Texture* texture);
+
+	void beginFrame();
+	bool useMesh(Mesh* mesh);	// Mark the mesh and its texture as used this frame, uploading them if needed; false when they cannot be drawn
+	void endFrame();	// Evict least recently used resources until the budget is met
+
+	const Counters& getFrameCounters() const { return frameCounters; }
+	const Counters& getTotalCounters() const { return totalCounters; }
+	void printCounters() const;
+
+private:
+	struct Entry {
+		Mesh* mesh = nullptr;
+		custom::Texture* texture = nullptr;
+		bool resident = false;
+		bool failed = false;	//an upload failed, the resource stays non-resident
+		uint64_t bytes = 0;	//bytes while resident
+		uint64_t lastUsedFrame = 0;
+	};
+	using EntryList = std::list<Entry>;
+
+	void touch(EntryList::iterator entry);
+	void makeResident(Entry& entry);
+	void evict(Entry& entry);
+
+	wgpu::Device device = nullptr;
+	wgpu::Queue queue = nullptr;
+	uint64_t budgetBytes = 0;
+	uint64_t residentBytes = 0;
+	uint64_t frame = 0;
+
+	//most recently used first, so eviction walks from the back
+	EntryList entries;
+	std::unordered_map<const void*, EntryList::iterator> lookup;
+
+	Counters frameCounters;
+	Counters totalCounters;
+};
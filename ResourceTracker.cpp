@@ -0,0 +1,196 @@
+#include "ResourceTracker.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include "json.hpp"
+
+using namespace wgpu;
+
+// Define static members
+std::unordered_map<WGPUBuffer, ResourceTracker::Allocation> ResourceTracker::buffers;
+std::unordered_map<WGPUTexture, std::vector<ResourceTracker::Allocation>> ResourceTracker::textures;
+ResourceTracker::CategoryStats ResourceTracker::stats[(size_t)ResourceCategory::Count];
+uint64_t ResourceTracker::totalBytes = 0;
+uint64_t ResourceTracker::peakBytes = 0;
+
+Buffer ResourceTracker::createBuffer(Device device, const BufferDescriptor& descriptor, ResourceCategory category)
+{
+	Buffer buffer = device.createBuffer(descriptor);
+	if (!buffer) return buffer;
+
+	Allocation allocation = { category, descriptor.size };
+	buffers[buffer] = allocation;
+	track(category, descriptor.size);
+
+	return buffer;
+}
+
+Texture ResourceTracker::createTexture(Device device, const TextureDescriptor& descriptor, ResourceCategory category)
+{
+	Texture texture = device.createTexture(descriptor);
+	if (!texture) return texture;
+
+	//every mip level is counted on its own, levels after the base one go to the mip category
+	uint64_t texelSize = getBytesPerTexel(descriptor.format) * std::max(descriptor.sampleCount, 1u);
+	uint64_t baseBytes = 0;
+	uint64_t mipBytes = 0;
+	for (uint32_t level = 0; level < descriptor.mipLevelCount; ++level) {
+		uint64_t width = std::max(descriptor.size.width >> level, 1u);
+		uint64_t height = std::max(descriptor.size.height >> level, 1u);
+		uint64_t levelBytes = width * height * descriptor.size.depthOrArrayLayers * texelSize;
+		if (level == 0) baseBytes = levelBytes;
+		else mipBytes += levelBytes;
+	}
+
+	std::vector<Allocation>& allocations = textures[texture];
+	allocations.push_back({ category, baseBytes });
+	track(category, baseBytes);
+
+	if (descriptor.mipLevelCount > 1) {
+		allocations.push_back({ ResourceCategory::MipLevels, mipBytes });
+		track(ResourceCategory::MipLevels, mipBytes);
+	}
+
+	return texture;
+}
+
+void ResourceTracker::destroyBuffer(Buffer buffer)
+{
+	if (!buffer) return;
+
+	auto it = buffers.find(buffer);
+	if (it != buffers.end()) {
+		untrack(it->second);
+		buffers.erase(it);
+	}
+
+	buffer.destroy();
+	buffer.release();
+}
+
+void ResourceTracker::destroyTexture(Texture texture)
+{
+	if (!texture) return;
+
+	auto it = textures.find(texture);
+	if (it != textures.end()) {
+		for (const Allocation& allocation : it->second) {
+			untrack(allocation);
+		}
+		textures.erase(it);
+	}
+
+	texture.destroy();
+	texture.release();
+}
+
+const char* ResourceTracker::getCategoryName(ResourceCategory category)
+{
+	switch (category) {
+	case ResourceCategory::Vertex: return "vertex";
+	case ResourceCategory::Index: return "index";
+	case ResourceCategory::Uniform: return "uniform";
+	case ResourceCategory::Texture: return "texture";
+	case ResourceCategory::MipLevels: return "mipLevels";
+	case ResourceCategory::RenderTarget: return "renderTarget";
+	case ResourceCategory::Culling: return "culling";
+	case ResourceCategory::Storage: return "storage";
+	case ResourceCategory::Staging: return "staging";
+	case ResourceCategory::Readback: return "readback";
+	default: return "unknown";
+	}
+}
+
+uint32_t ResourceTracker::getBytesPerTexel(TextureFormat format)
+{
+	switch (format) {
+	case TextureFormat::R8Unorm:
+	case TextureFormat::R8Snorm:
+	case TextureFormat::R8Uint:
+	case TextureFormat::R8Sint:
+	case TextureFormat::Stencil8:
+		return 1;
+	case TextureFormat::R16Uint:
+	case TextureFormat::R16Sint:
+	case TextureFormat::R16Float:
+	case TextureFormat::RG8Unorm:
+	case TextureFormat::RG8Snorm:
+	case TextureFormat::RG8Uint:
+	case TextureFormat::RG8Sint:
+	case TextureFormat::Depth16Unorm:
+		return 2;
+	case TextureFormat::RGBA16Uint:
+	case TextureFormat::RGBA16Sint:
+	case TextureFormat::RGBA16Float:
+	case TextureFormat::RG32Float:
+	case TextureFormat::RG32Uint:
+	case TextureFormat::RG32Sint:
+	case TextureFormat::Depth32FloatStencil8:
+		return 8;
+	case TextureFormat::RGBA32Float:
+	case TextureFormat::RGBA32Uint:
+	case TextureFormat::RGBA32Sint:
+		return 16;
+	default:
+		//rgba8, bgra8, r32, rg16, depth24/32 and packed formats
+		return 4;
+	}
+}
+
+std::string ResourceTracker::getReportJson(int indent)
+{
+	nlohmann::json report;
+	report["totalBytes"] = totalBytes;
+	report["peakBytes"] = peakBytes;
+	report["liveBuffers"] = buffers.size();
+	report["liveTextures"] = textures.size();
+
+	nlohmann::json categories = nlohmann::json::object();
+	for (size_t i = 0; i < (size_t)ResourceCategory::Count; ++i) {
+		const CategoryStats& categoryStats = stats[i];
+		categories[getCategoryName((ResourceCategory)i)] = {
+			{ "bytes", categoryStats.bytes },
+			{ "peakBytes", categoryStats.peakBytes },
+			{ "objects", categoryStats.objects },
+			{ "peakObjects", categoryStats.peakObjects },
+		};
+	}
+	report["categories"] = categories;
+
+	return report.dump(indent);
+}
+
+bool ResourceTracker::dumpReport(const fs::path& path)
+{
+	std::string report = getReportJson();
+	std::cout << "GPU memory report:\n" << report << std::endl;
+
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		std::cout << "Failed to write the GPU memory report to " << path.string() << std::endl;
+		return false;
+	}
+	file << report << "\n";
+	return true;
+}
+
+void ResourceTracker::track(ResourceCategory category, uint64_t bytes)
+{
+	CategoryStats& categoryStats = stats[(size_t)category];
+	categoryStats.bytes += bytes;
+	categoryStats.objects++;
+	categoryStats.peakBytes = std::max(categoryStats.peakBytes, categoryStats.bytes);
+	categoryStats.peakObjects = std::max(categoryStats.peakObjects, categoryStats.objects);
+
+	totalBytes += bytes;
+	peakBytes = std::max(peakBytes, totalBytes);
+}
+
+void ResourceTracker::untrack(const Allocation& allocation)
+{
+	CategoryStats& categoryStats = stats[(size_t)allocation.category];
+	categoryStats.bytes -= allocation.bytes;
+	categoryStats.objects--;
+
+	totalBytes -= allocation.bytes;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+
+namespace fs = std::filesystem;
+
+enum class ResourceCategory {
+	Vertex,
+	Index,
+	Uniform,
+	Texture,
+	MipLevels,
+	RenderTarget,
+	Culling,
+	Storage,	//storage buffers the shaders read and write
+	Staging,	//CPU written buffers that are only copied from
+	Readback,	//buffers that are only copied to and mapped for reading, query resolves included
+	Count
+};
+
+//keeps byte and object counts of every buffer and texture created through it
+//so that the device memory used by the scene can be reported at any time
+class ResourceTracker
+{
+public:
+	struct CategoryStats {
+		uint64_t bytes = 0;
+		uint64_t peakBytes = 0;
+		uint32_t objects = 0;
+		uint32_t peakObjects = 0;
+	};
+
+	static wgpu::Buffer createBuffer(wgpu::Device device, const wgpu::BufferDescriptor& descriptor, ResourceCategory category);
+	static wgpu::Texture createTexture(wgpu::Device device, const wgpu::TextureDescriptor& descriptor, ResourceCategory category);
+
+	//destroy + release + untrack, null handles are ignored
+	static void destroyBuffer(wgpu::Buffer buffer);
+	static void destroyTexture(wgpu::Texture texture);
+
+	static const CategoryStats& getStats(ResourceCategory category) { return stats[(size_t)category]; }
+	static uint64_t getTotalBytes() { return totalBytes; }
+	static uint64_t getPeakBytes() { return peakBytes; }
+	static uint32_t getLiveObjectCount() { return (uint32_t)(buffers.size() + textures.size()); }
+
+	static const char* getCategoryName(ResourceCategory category);
+	static uint32_t getBytesPerTexel(wgpu::TextureFormat format);
+
+	static std::string getReportJson(int indent = 4);
+	static bool dumpReport(const fs::path& path);
+
+private:
+	struct Allocation {
+		ResourceCategory category;
+		uint64_t bytes;
+	};
+
+	static void track(ResourceCategory category, uint64_t bytes);
+	static void untrack(const Allocation& allocation);
+
+	static std::unordered_map<WGPUBuffer, Allocation> buffers;
+	static std::unordered_map<WGPUTexture, std::vector<Allocation>> textures; //base level + mip levels are tracked separately
+	static CategoryStats stats[(size_t)ResourceCategory::Count];
+	static uint64_t totalBytes;
+	static uint64_t peakBytes;
+};
@@ -0,0 +1,185 @@
+#include "SceneBVH.h"
+#include <algorithm>
+
+void SceneBVH::build(const AABB* bounds, uint32_t itemCount)
+{
+	this->itemBounds.assign(bounds, bounds + itemCount);
+	this->itemIndices.resize(itemCount);
+	this->centroids.resize(itemCount);
+	for (uint32_t i = 0; i < itemCount; ++i) {
+		this->itemIndices[i] = i;
+		this->centroids[i] = bounds[i].getCenter();
+	}
+
+	this->nodes.clear();
+	if (itemCount == 0) return;
+	this->nodes.reserve(2 * (size_t)itemCount);
+
+	Node root;
+	root.first = 0;
+	root.count = itemCount;
+	this->nodes.push_back(root);
+	updateNodeBounds(0);
+	subdivide(0);
+}
+
+void SceneBVH::refit()
+{
+	//children come after their parents, so a backwards walk sees them first
+	for (size_t i = this->nodes.size(); i-- > 0;) {
+		Node& node = this->nodes[i];
+		if (node.count > 0) {
+			updateNodeBounds((uint32_t)i);
+		}
+		else {
+			node.bounds = this->nodes[node.first].bounds;
+			node.bounds.expand(this->nodes[node.first + 1].bounds);
+		}
+	}
+}
+
+void SceneBVH::updateNodeBounds(uint32_t nodeIndex)
+{
+	Node& node = this->nodes[nodeIndex];
+	node.bounds = AABB();
+	for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+		node.bounds.expand(this->itemBounds[this->itemIndices[i]]);
+	}
+}
+
+void SceneBVH::subdivide(uint32_t rootIndex)
+{
+	struct Bin {
+		AABB bounds;
+		uint32_t count = 0;
+	};
+
+	//explicit stack of nodes still to split, each split pushes at most two
+	uint32_t stack[MaxDepth];
+	uint32_t depths[MaxDepth];
+	uint32_t stackSize = 0;
+	stack[stackSize] = rootIndex;
+	depths[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		--stackSize;
+		uint32_t nodeIndex = stack[stackSize];
+		uint32_t depth = depths[stackSize];
+		uint32_t first = this->nodes[nodeIndex].first;
+		uint32_t count = this->nodes[nodeIndex].count;
+		if (count <= MaxLeafSize || depth + 1 >= MaxDepth / 2) continue;
+
+		AABB centroidBounds;
+		for (uint32_t i = first; i < first + count; ++i) {
+			centroidBounds.expand(this->centroids[this->itemIndices[i]]);
+		}
+
+		//cost of a split relative to the parent area, the leaf cost is the item count
+		float bestCost = (float)count;
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		float parentArea = this->nodes[nodeIndex].bounds.getSurfaceArea();
+
+		for (int axis = 0; axis < 3; ++axis) {
+			float axisMin = centroidBounds.min[axis];
+			float axisExtent = centroidBounds.max[axis] - axisMin;
+			if (axisExtent <= 0.0f) continue;
+
+			Bin bins[BinCount];
+			float scale = BinCount / axisExtent;
+			for (uint32_t i = first; i < first + count; ++i) {
+				uint32_t item = this->itemIndices[i];
+				uint32_t bin = std::min(BinCount - 1, (uint32_t)((this->centroids[item][axis] - axisMin) * scale));
+				bins[bin].count++;
+				bins[bin].bounds.expand(this->itemBounds[item]);
+			}
+
+			//sweep from both sides to get the area and count left and right of every split plane
+			float leftAreas[BinCount - 1];
+			uint32_t leftCounts[BinCount - 1];
+			AABB leftBounds;
+			uint32_t leftCount = 0;
+			for (uint32_t i = 0; i < BinCount - 1; ++i) {
+				leftBounds.expand(bins[i].bounds);
+				leftCount += bins[i].count;
+				leftAreas[i] = leftBounds.getSurfaceArea();
+				leftCounts[i] = leftCount;
+			}
+
+			AABB rightBounds;
+			uint32_t rightCount = 0;
+			for (uint32_t i = BinCount - 1; i > 0; --i) {
+				rightBounds.expand(bins[i].bounds);
+				rightCount += bins[i].count;
+				if (leftCounts[i - 1] == 0 || rightCount == 0) continue;
+
+				float cost = 1.0f + (leftAreas[i - 1] * leftCounts[i - 1] + rightBounds.getSurfaceArea() * rightCount) / parentArea;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		if (bestAxis < 0) continue;
+
+		//partition the items of the node around the chosen plane
+		float axisMin = centroidBounds.min[bestAxis];
+		float scale = BinCount / (centroidBounds.max[bestAxis] - axisMin);
+		uint32_t* begin = this->itemIndices.data() + first;
+		uint32_t* middle = std::partition(begin, begin + count, [&](uint32_t item) {
+			return std::min(BinCount - 1, (uint32_t)((this->centroids[item][bestAxis] - axisMin) * scale)) < bestSplit;
+			});
+		uint32_t leftCount = (uint32_t)(middle - begin);
+		if (leftCount == 0 || leftCount == count) continue;
+
+		uint32_t leftIndex = (uint32_t)this->nodes.size();
+		Node left;
+		left.first = first;
+		left.count = leftCount;
+		Node right;
+		right.first = first + leftCount;
+		right.count = count - leftCount;
+		this->nodes.push_back(left);
+		this->nodes.push_back(right);
+		updateNodeBounds(leftIndex);
+		updateNodeBounds(leftIndex + 1);
+
+		this->nodes[nodeIndex].first = leftIndex;
+		this->nodes[nodeIndex].count = 0;
+
+		stack[stackSize] = leftIndex;
+		depths[stackSize++] = depth + 1;
+		stack[stackSize] = leftIndex + 1;
+		depths[stackSize++] = depth + 1;
+	}
+}
+
+void SceneBVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const
+{
+	query([&](const AABB& box) { return frustum.intersects(box); }, items);
+}
+
+void SceneBVH::querySphere(const Sphere& sphere, std::vector<uint32_t>& items) const
+{
+	query([&](const AABB& box) { return intersects(box, sphere); }, items);
+}
+
+void SceneBVH::queryAABB(const AABB& box, std::vector<uint32_t>& items) const
+{
+	query([&](const AABB& nodeBox) { return nodeBox.overlaps(box); }, items);
+}
+
+uint32_t SceneBVH::raycastBounds(const Ray& ray, float& maxDistance) const
+{
+	uint32_t nearest = InvalidItem;
+	raycast(ray, maxDistance, [&](uint32_t item, float& distance) {
+		float entry = ray.intersect(this->itemBounds[item], distance);
+		if (entry >= distance) return false;
+		distance = entry;
+		nearest = item;
+		return true;
+		});
+	return nearest;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+
+//bounding volume hierarchy over the world space boxes of scene items (one item per drawn mesh)
+//built top down with a binned surface area heuristic, moving items only refit the node boxes
+//and a rebuild is needed when items are added or removed
+class SceneBVH
+{
+public:
+	static constexpr uint32_t MaxLeafSize = 4;
+	static constexpr uint32_t BinCount = 16;
+	static constexpr uint32_t MaxDepth = 64;	//traversal stack size
+
+	void build(const AABB* bounds, uint32_t itemCount);
+	void setItemBounds(uint32_t item, const AABB& bounds) { itemBounds[item] = bounds; }
+	void refit();	// Recompute the node boxes after setItemBounds, the tree shape stays the same
+
+	uint32_t getItemCount() const { return (uint32_t)itemBounds.size(); }
+	uint32_t getNodeCount() const { return (uint32_t)nodes.size(); }
+	const AABB& getItemBounds(uint32_t item) const { return itemBounds[item]; }
+	AABB getBounds() const { return nodes.empty() ? AABB() : nodes[0].bounds; }
+
+	//the queries append the items whose boxes pass the test to `items`
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const;
+	void querySphere(const Sphere& sphere, std::vector<uint32_t>& items) const;
+	void queryAABB(const AABB& box, std::vector<uint32_t>& items) const;
+
+	// Visits the items whose boxes the ray enters before maxDistance, nearest nodes first
+	// intersect(item, maxDistance) returns true and shortens maxDistance when it finds a closer hit
+	template<typename Intersect>
+	bool raycast(const Ray& ray, float& maxDistance, const Intersect& intersect) const;
+
+	// Nearest item box along the ray, InvalidItem when nothing is hit
+	uint32_t raycastBounds(const Ray& ray, float& maxDistance) const;
+
+	static constexpr uint32_t InvalidItem = 0xFFFFFFFFu;
+
+	struct Node {
+		AABB bounds;
+		uint32_t first = 0;	//first item for a leaf, left child for an inner node (the right child follows it)
+		uint32_t count = 0;	//items of a leaf, 0 for an inner node
+	};
+
+	//tree layout, for structures built on top of this one, node 0 is the root
+	const Node& getNode(uint32_t node) const { return nodes[node]; }
+	uint32_t getLeafItem(uint32_t index) const { return itemIndices[index]; }	// Item at position index of the leaf order
+
+private:
+	void subdivide(uint32_t nodeIndex);
+	void updateNodeBounds(uint32_t nodeIndex);
+
+	template<typename Test>
+	void query(const Test& test, std::vector<uint32_t>& items) const;
+
+	std::vector<Node> nodes;	//children are always stored after their parent
+	std::vector<uint32_t> itemIndices;	//items ordered by leaf
+	std::vector<AABB> itemBounds;
+	std::vector<glm::vec3> centroids;	//only used while building
+};
+
+template<typename Test>
+void SceneBVH::query(const Test& test, std::vector<uint32_t>& items) const
+{
+	if (this->nodes.empty()) return;
+
+	uint32_t stack[MaxDepth];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const Node& node = this->nodes[stack[--stackSize]];
+		if (!test(node.bounds)) continue;
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				uint32_t item = this->itemIndices[i];
+				if (test(this->itemBounds[item])) items.push_back(item);
+			}
+		}
+		else {
+			stack[stackSize++] = node.first + 1;
+			stack[stackSize++] = node.first;
+		}
+	}
+}
+
+template<typename Intersect>
+bool SceneBVH::raycast(const Ray& ray, float& maxDistance, const Intersect& intersect) const
+{
+	if (this->nodes.empty() || ray.intersect(this->nodes[0].bounds, maxDistance) == FLT_MAX) return false;
+
+	bool hit = false;
+	uint32_t stack[MaxDepth];
+	float stackDistances[MaxDepth];
+	uint32_t stackSize = 0;
+	stack[stackSize] = 0;
+	stackDistances[stackSize++] = 0.0f;
+
+	while (stackSize > 0) {
+		--stackSize;
+		//a closer hit was found after this node was pushed
+		if (stackDistances[stackSize] > maxDistance) continue;
+		const Node& node = this->nodes[stack[stackSize]];
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				uint32_t item = this->itemIndices[i];
+				if (ray.intersect(this->itemBounds[item], maxDistance) == FLT_MAX) continue;
+				if (intersect(item, maxDistance)) hit = true;
+			}
+			continue;
+		}
+
+		//push the far child first so that the near one is visited first
+		uint32_t nearChild = node.first;
+		uint32_t farChild = node.first + 1;
+		float nearDistance = ray.intersect(this->nodes[nearChild].bounds, maxDistance);
+		float farDistance = ray.intersect(this->nodes[farChild].bounds, maxDistance);
+		if (farDistance < nearDistance) {
+			std::swap(nearChild, farChild);
+			std::swap(nearDistance, farDistance);
+		}
+		if (farDistance != FLT_MAX) {
+			stack[stackSize] = farChild;
+			stackDistances[stackSize++] = farDistance;
+		}
+		if (nearDistance != FLT_MAX) {
+			stack[stackSize] = nearChild;
+			stackDistances[stackSize++] = nearDistance;
+		}
+	}
+
+	return hit;
+}
@@ -1,97 +1,61 @@
 #include "SceneObject.h"
-#include "Mesh.h"
+#include <type_traits>
 
+static_assert(std::is_trivially_destructible<SceneObject>::value, "ObjectPool<SceneObject>::clear must not have to visit the scene objects");
 
-SceneObject::SceneObject(wgpu::Device* device, wgpu::BindGroupLayout* modelBindGroupLayout)
+//appends to the range first/count of list, a range that is not at the end of the list moves there
+template<typename T>
+static void appendToRange(vector<T*>& list, uint32_t& first, uint32_t& count, T* item)
 {
-	this->localTranslation = glm::vec3();
-	this->localRotation = glm::quat();
-	this->localScale = glm::vec3(1.0f, 1.0f, 1.0f);
-	this->children = vector<SceneObject*>();
-	this->visualObjects = vector<Mesh*>();
-
-	//model uniform buffer
-	BufferDescriptor bufferDescriptor = Default;
-	bufferDescriptor.label = "Model Uniform Buffer";
-	bufferDescriptor.size = sizeof(glm::mat4);
-	bufferDescriptor.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
-	bufferDescriptor.mappedAtCreation = false;
-
-	this->modelUniformBuffer = device->createBuffer(bufferDescriptor);
-
-	glm::mat4 identityMatrix = glm::mat4(1.0f);
-	device->getQueue().writeBuffer(this->modelUniformBuffer, 0, &identityMatrix, sizeof(glm::mat4));
-
-	wgpu::BindGroupDescriptor desc = wgpu::Default;
-	desc.entryCount = 1;
-	desc.label = "Model Bind Group";
-	desc.layout = *modelBindGroupLayout;
-	
-	wgpu::BindGroupEntry entry = wgpu::Default;
-	entry.binding = 0;
-	entry.buffer = this->modelUniformBuffer;
-	entry.offset = 0;
-	entry.size = sizeof(glm::mat4);
-
-	desc.entries = &entry;
-
-	this->modelBindGroup = device->createBindGroup(desc);
-}
-
-SceneObject::~SceneObject()
-{
-	for (SceneObject* child : this->children) {
-		delete child;
+	if (count == 0) {
+		first = (uint32_t)list.size();
 	}
-	this->children.clear(); // Optional: clear the vector to avoid potential dangling pointers
-
-	// Delete all visual objects
-	for (Mesh* visualObject : this->visualObjects) {
-		delete visualObject;
+	else if (first + count != list.size()) {
+		uint32_t moved = (uint32_t)list.size();
+		for (uint32_t i = 0; i < count; ++i) {
+			T* entry = list[first + i];
+			list.push_back(entry);
+		}
+		first = moved;
 	}
-	this->visualObjects.clear(); // Optional: clear the vector to avoid potential dangling pointers
+	list.push_back(item);
+	count++;
+}
 
-	this->modelUniformBuffer.destroy();
-	this->modelUniformBuffer.release();
-	this->modelBindGroup.release();
+SceneObject::SceneObject(TransformStore* transforms, SceneLists* lists)
+{
+	this->transforms = transforms;
+	this->lists = lists;
+	this->transformId = transforms->create();
 }
 
 void SceneObject::setTranslation(glm::vec3 translation)
 {
-	this->localTranslation = translation;
+	this->transforms->setTranslation(this->transformId, translation);
 }
 
 void SceneObject::setRotation(glm::quat rotation)
 {
-	this->localRotation = rotation;
+	this->transforms->setRotation(this->transformId, rotation);
 }
 
 void SceneObject::setScale(glm::vec3 scale)
 {
-	this->localScale = scale;
+	this->transforms->setScale(this->transformId, scale);
 }
 
 void SceneObject::addChild(SceneObject* child)
 {
-	this->children.push_back(child);
+	appendToRange(this->lists->children, this->firstChild, this->childCount, child);
+	this->transforms->setParent(child->transformId, this->transformId);
 }
 
 void SceneObject::addVisualObject(Mesh* visualObject)
 {
-	this->visualObjects.push_back(visualObject);
+	appendToRange(this->lists->meshes, this->firstMesh, this->meshCount, visualObject);
 }
 
 glm::mat4 SceneObject::calculateModelMatrix()
 {
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, this->localTranslation);
-	model *= glm::mat4_cast(this->localRotation);
-	model = glm::scale(model, this->localScale);
-
-	return model;
-}
-
-void SceneObject::writeModelUniformBuffer(wgpu::Queue queue, glm::mat4* modelMatrix)
-{
-	queue.writeBuffer(this->modelUniformBuffer, 0, modelMatrix, sizeof(glm::mat4));
+	return this->transforms->getLocalMatrix(this->transformId);
 }
@@ -2,39 +2,79 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <iterator>
 #include <vector>
-#include <webgpu/webgpu.hpp>
+#include "TransformStore.h"
 
 using namespace std;
 
 class Mesh;
+class SceneObject;
 
+//child and mesh lists of every scene object of a scene, each object refers to one range of each
+//list, so the objects themselves own no memory; released all at once with the scene
+struct SceneLists {
+	vector<SceneObject*> children;
+	vector<Mesh*> meshes;
+
+	void clear() { children.clear(); meshes.clear(); }
+};
+
+// A range of one of the SceneLists, invalidated when the list grows
+template<typename T>
+class SceneListRange
+{
+public:
+	SceneListRange(T* const* first, uint32_t count) : first(first), count(count) {}
+
+	T* const* begin() const { return first; }
+	T* const* end() const { return first + count; }
+	std::reverse_iterator<T* const*> rbegin() const { return std::reverse_iterator<T* const*>(end()); }
+	std::reverse_iterator<T* const*> rend() const { return std::reverse_iterator<T* const*>(begin()); }
+	uint32_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T* operator[](uint32_t i) const { return first[i]; }
+
+private:
+	T* const* first;
+	uint32_t count;
+};
+
+//a lightweight handle into a TransformStore, the transform data itself lives in the store
+//scene objects and their meshes are owned by the scene's object pools, not by their parent, and
+//are torn down all at once together with the transform store and the scene lists; a scene object
+//is trivially destructible, so releasing the pool never visits it
 class SceneObject
 {
 public:
-	SceneObject(wgpu::Device* device, wgpu::BindGroupLayout* modelBindGroupLayout);
-	~SceneObject();
+	SceneObject(TransformStore* transforms, SceneLists* lists);
 
 	void setTranslation(glm::vec3 translation);
 	void setRotation(glm::quat rotation);
 	void setScale(glm::vec3 scale);
+	glm::vec3 getTranslation() const { return transforms->getTranslation(transformId); }
+	glm::quat getRotation() const { return transforms->getRotation(transformId); }
+	glm::vec3 getScale() const { return transforms->getScale(transformId); }
+	// The children and meshes of one object are best added one after the other: a range that is no
+	// longer at the end of its list is moved there, leaving its old entries unused
 	void addChild(SceneObject* child);
 	void addVisualObject(Mesh* visualObject);
 	glm::mat4 calculateModelMatrix();
-	wgpu::BindGroup getModelBindGroup() { return modelBindGroup; }
-	vector<SceneObject*> getChildren() { return children; }
-	vector<Mesh*> getVisualObjects() { return visualObjects; }
-	void writeModelUniformBuffer(wgpu::Queue queue, glm::mat4* modelMatrix);
+	const glm::mat4& getWorldMatrix() const { return transforms->getWorldMatrix(transformId); }	// Valid after TransformStore::update
+	uint32_t getTransformId() const { return transformId; }
+	uint32_t getTransformSlot() const { return transforms->getSlot(transformId); }	// Index of the model matrix in the transform buffer
+	SceneListRange<SceneObject> getChildren() const { return SceneListRange<SceneObject>(lists->children.data() + firstChild, childCount); }
+	SceneListRange<Mesh> getVisualObjects() const { return SceneListRange<Mesh>(lists->meshes.data() + firstMesh, meshCount); }
+	bool wasTransformChanged() const { return transforms->wasChanged(transformId); }	// World matrix changed in the last TransformStore::update
 
 private:
-	glm::vec3 localTranslation;
-	glm::quat localRotation;
-	glm::vec3 localScale;
+	TransformStore* transforms = nullptr;
+	SceneLists* lists = nullptr;
+	uint32_t transformId = TransformStore::InvalidIndex;
 
-	vector<SceneObject*> children;
-	vector<Mesh*> visualObjects;
-
-	wgpu::Buffer modelUniformBuffer = nullptr;
-	wgpu::BindGroup modelBindGroup = nullptr;
+	//ranges of the scene lists
+	uint32_t firstChild = 0;
+	uint32_t childCount = 0;
+	uint32_t firstMesh = 0;
+	uint32_t meshCount = 0;
 };
-
@@ -0,0 +1,167 @@
+#include "StaticBundles.h"
+#include "Mesh.h"
+#include "ResidencyManager.h"
+#include "TransformBuffer.h"
+#include <algorithm>
+
+using namespace wgpu;
+
+//spreads the low 10 bits of v to every third bit
+static uint32_t expandBits(uint32_t v)
+{
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+void StaticBundles::terminate()
+{
+	invalidate();
+	this->items.clear();
+	this->chunks.clear();
+	this->device = nullptr;
+}
+
+void StaticBundles::build(const std::vector<Item>& items)
+{
+	invalidate();
+	this->items = items;
+	this->chunks.clear();
+	if (this->items.empty()) return;
+
+	//Morton order of the box centers keeps the items of a chunk close to each other
+	AABB sceneBounds;
+	for (const Item& item : this->items) sceneBounds.expand(item.bounds.getCenter());
+	glm::vec3 scale = 1023.0f / glm::max(sceneBounds.max - sceneBounds.min, glm::vec3(1e-6f));
+	std::vector<std::pair<uint32_t, uint32_t>> codes(this->items.size());
+	for (size_t i = 0; i < this->items.size(); ++i) {
+		glm::uvec3 cell = glm::min(glm::uvec3((this->items[i].bounds.getCenter() - sceneBounds.min) * scale), glm::uvec3(1023));
+		codes[i] = { (expandBits(cell.x) << 2) | (expandBits(cell.y) << 1) | expandBits(cell.z), (uint32_t)i };
+	}
+	std::sort(codes.begin(), codes.end());
+
+	std::vector<Item> sorted(this->items.size());
+	for (size_t i = 0; i < codes.size(); ++i) sorted[i] = this->items[codes[i].second];
+	this->items.swap(sorted);
+
+	for (uint32_t first = 0; first < (uint32_t)this->items.size(); first += ChunkItems) {
+		Chunk chunk;
+		chunk.firstItem = first;
+		chunk.itemCount = std::min(ChunkItems, (uint32_t)this->items.size() - first);
+
+		//inside a bundle the state changes are what costs, so the draws are grouped by material and mesh
+		auto begin = this->items.begin() + first;
+		std::sort(begin, begin + chunk.itemCount, [](const Item& a, const Item& b) { return a.sortKey < b.sortKey; });
+
+		for (uint32_t i = first; i < first + chunk.itemCount; ++i) {
+			const Item& item = this->items[i];
+			chunk.bounds.expand(item.bounds);
+			if (chunk.meshes.empty() || chunk.meshes.back().first != item.mesh) {
+				chunk.meshes.push_back({ item.mesh, 0 });
+			}
+		}
+		chunk.sphere = Sphere(chunk.bounds.getCenter(), glm::length(chunk.bounds.getExtents()));
+		this->chunks.push_back(std::move(chunk));
+	}
+}
+
+void StaticBundles::invalidate()
+{
+	for (Chunk& chunk : this->chunks) {
+		if (chunk.bundle) chunk.bundle.release();
+		chunk.bundle = nullptr;
+	}
+}
+
+bool StaticBundles::isTargetCurrent(const Target& target) const
+{
+	return this->target.pipeline == target.pipeline && this->target.cameraBindGroup == target.cameraBindGroup
+		&& this->target.transforms == target.transforms && this->transformGeneration == target.transforms->getGeneration()
+		&& this->target.colorFormat == target.colorFormat && this->target.depthFormat == target.depthFormat;
+}
+
+RenderBundle StaticBundles::prepare(uint32_t chunkIndex, ResidencyManager& residency, const Target& target)
+{
+	if (!isTargetCurrent(target)) {
+		invalidate();
+		this->target = target;
+		this->transformGeneration = target.transforms->getGeneration();
+	}
+
+	//the meshes are used every frame the chunk is drawn, which also keeps them from being evicted
+	//while a recorded bundle still points to their buffers
+	Chunk& chunk = this->chunks[chunkIndex];
+	bool current = chunk.bundle != nullptr;
+	for (std::pair<Mesh*, uint32_t>& mesh : chunk.meshes) {
+		if (!residency.useMesh(mesh.first)) return nullptr;
+		current = current && mesh.second == mesh.first->getGpuGeneration();
+	}
+
+	if (!current) {
+		record(chunk, target);
+	}
+	return chunk.bundle;
+}
+
+void StaticBundles::record(Chunk& chunk, const Target& target)
+{
+	if (chunk.bundle) chunk.bundle.release();
+
+	//the same attachments as the scene pass, which writes depth and never stencil
+	WGPUTextureFormat colorFormat = target.colorFormat;
+	RenderBundleEncoderDescriptor encoderDescriptor = Default;
+	encoderDescriptor.label = "Static Bundle Encoder";
+	encoderDescriptor.colorFormatCount = 1;
+	encoderDescriptor.colorFormats = &colorFormat;
+	encoderDescriptor.depthStencilFormat = target.depthFormat;
+	encoderDescriptor.sampleCount = 1;
+	encoderDescriptor.depthReadOnly = false;
+	encoderDescriptor.stencilReadOnly = true;
+	RenderBundleEncoder encoder = this->device.createRenderBundleEncoder(encoderDescriptor);
+
+	bool useTransformTable = target.transforms->getLayout() == TransformBuffer::Layout::StorageTable;
+	encoder.setPipeline(target.pipeline);
+	encoder.setBindGroup(0, target.cameraBindGroup, 0, nullptr);
+	if (useTransformTable) {
+		encoder.setBindGroup(1, target.transforms->getBindGroup(), 0, nullptr);
+	}
+
+	//a bundle starts with nothing bound, so only the changes between its own draws are recorded
+	Mesh* boundMesh = nullptr;
+	for (uint32_t i = chunk.firstItem; i < chunk.firstItem + chunk.itemCount; ++i) {
+		const Item& item = this->items[i];
+		Mesh* mesh = item.mesh;
+		if (mesh != boundMesh) {
+			Buffer vertexBuffer = mesh->getVertexBuffer();
+			Buffer normalBuffer = mesh->getNormalBuffer();
+			Buffer uvBuffer = mesh->getUVBuffer();
+			Buffer indexBuffer = mesh->getIndexBuffer();
+			encoder.setVertexBuffer(0, vertexBuffer, 0, vertexBuffer.getSize());
+			encoder.setVertexBuffer(1, normalBuffer, 0, normalBuffer.getSize());
+			encoder.setVertexBuffer(2, uvBuffer, 0, uvBuffer.getSize());
+			encoder.setIndexBuffer(indexBuffer, mesh->getIndexFormat(), 0, indexBuffer.getSize());
+			encoder.setBindGroup(2, mesh->getTextureBindGroup(), 0, nullptr);
+			boundMesh = mesh;
+		}
+
+		//with the transform table the first instance is the index of the model matrix
+		if (!useTransformTable) {
+			uint32_t modelOffset = target.transforms->getOffset(item.transformSlot);
+			encoder.setBindGroup(1, target.transforms->getBindGroup(), 1, &modelOffset);
+		}
+		uint32_t firstInstance = useTransformTable ? item.transformSlot : 0;
+		encoder.drawIndexed((uint32_t)mesh->getNumIndices(), 1, 0, 0, firstInstance);
+	}
+
+	RenderBundleDescriptor bundleDescriptor = Default;
+	bundleDescriptor.label = "Static Bundle";
+	chunk.bundle = encoder.finish(bundleDescriptor);
+	encoder.release();
+
+	for (std::pair<Mesh*, uint32_t>& mesh : chunk.meshes) {
+		mesh.second = mesh.first->getGpuGeneration();
+	}
+	this->recordCount++;
+}
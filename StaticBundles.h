@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+#include "Bounds.h"
+
+class Mesh;
+class ResidencyManager;
+class TransformBuffer;
+
+//draws of static geometry recorded once into render bundles and replayed with executeBundles
+//the items are split into chunks of nearby items, so that a chunk outside the view or behind the
+//occluders is skipped as a whole; a bundle is recorded again only when one of its meshes was
+//uploaded again or the pipeline, camera or transform buffer it was recorded with changed
+class StaticBundles
+{
+public:
+	static constexpr uint32_t ChunkItems = 128;
+
+	// One static draw
+	struct Item {
+		Mesh* mesh = nullptr;
+		uint32_t transformSlot = 0;
+		uint64_t sortKey = 0;	//order of the draws inside a chunk, see DrawSort
+		AABB bounds;	//world space
+	};
+
+	// What the bundles bind, any change records them all again
+	struct Target {
+		wgpu::RenderPipeline pipeline = nullptr;
+		wgpu::BindGroup cameraBindGroup = nullptr;
+		const TransformBuffer* transforms = nullptr;	//a storage table is bound once, a uniform buffer per draw
+		wgpu::TextureFormat colorFormat = wgpu::TextureFormat::Undefined;
+		wgpu::TextureFormat depthFormat = wgpu::TextureFormat::Undefined;
+	};
+
+	struct Chunk {
+		uint32_t firstItem = 0;	//into the items in chunk order
+		uint32_t itemCount = 0;
+		AABB bounds;
+		Sphere sphere;
+		wgpu::RenderBundle bundle = nullptr;
+		std::vector<std::pair<Mesh*, uint32_t>> meshes;	//each mesh once, with its GPU generation when recorded
+	};
+
+	void initialize(wgpu::Device device) { this->device = device; }
+	void terminate();
+
+	void build(const std::vector<Item>& items);	// Splits the items into chunks, nothing is recorded until prepare
+	void invalidate();	// Releases every bundle
+
+	// Makes the meshes of the chunk resident and records its bundle if it is missing or stale,
+	// null when a mesh could not be made resident
+	wgpu::RenderBundle prepare(uint32_t chunk, ResidencyManager& residency, const Target& target);
+
+	const std::vector<Chunk>& getChunks() const { return chunks; }
+	uint32_t getRecordCount() const { return recordCount; }	// Bundles recorded since the last reset
+	void resetRecordCount() { recordCount = 0; }
+
+private:
+	void record(Chunk& chunk, const Target& target);
+	bool isTargetCurrent(const Target& target) const;
+
+	wgpu::Device device = nullptr;
+	std::vector<Item> items;	//spatially sorted, then by sort key inside each chunk
+	std::vector<Chunk> chunks;
+
+	Target target;	//of the recorded bundles
+	uint32_t transformGeneration = 0;
+	uint32_t recordCount = 0;
+};
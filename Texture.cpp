@@ -1,24 +1,78 @@
 #include "Texture.h"
 #include "utils.h"
+#include "ResourceTracker.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
 
 custom::Texture::Texture(const fs::path& path, wgpu::Device device)
 {
-	this->texture = loadTexture(path, device, &this->textureView);
+	this->path = path;
+	if (!load(device)) {
+		throw std::runtime_error("Failed to load texture from file: " + this->path.string());
+	}
+}
+
+custom::Texture::~Texture()
+{
+	release();
+}
+
+uint64_t custom::Texture::GetGpuBytes() const
+{
+	if (!IsResident()) return 0;
+
+	wgpu::Texture gpuTexture = this->texture;
+	uint64_t texelSize = ResourceTracker::getBytesPerTexel(gpuTexture.getFormat());
+	uint64_t bytes = 0;
+	for (uint32_t level = 0; level < gpuTexture.getMipLevelCount(); ++level) {
+		uint64_t width = std::max(gpuTexture.getWidth() >> level, 1u);
+		uint64_t height = std::max(gpuTexture.getHeight() >> level, 1u);
+		bytes += width * height * texelSize;
+	}
+	return bytes;
+}
+
+void custom::Texture::Evict()
+{
+	release();
+}
+
+uint64_t custom::Texture::MakeResident(wgpu::Device device)
+{
+	if (IsResident()) return 0;
+
+	//a reload runs while a frame is being encoded, so a missing file is reported and not thrown
+	if (!load(device)) return 0;
+	return GetGpuBytes();
+}
+
+bool custom::Texture::load(wgpu::Device device)
+{
+	this->texture = loadTexture(this->path, device, &this->textureView);
     if(this->texture == nullptr)
 	{
-		throw std::runtime_error("Failed to load texture from file: " + path.string());
+		std::cout << "Failed to load texture from file: " << this->path.string() << std::endl;
+		return false;
 	}
 
     if(this->textureView == nullptr)
     {
-		this->texture.release();
-        throw std::runtime_error("Failed to create texture view");
+		ResourceTracker::destroyTexture(this->texture);
+		this->texture = nullptr;
+		std::cout << "Failed to create the view of texture " << this->path.string() << std::endl;
+		return false;
     }
+
+	this->generation++;
+	return true;
 }
 
-custom::Texture::~Texture()
+void custom::Texture::release()
 {
-	this->textureView.release();
-    this->texture.destroy();
-	this->texture.release();
+	if (this->textureView) this->textureView.release();
+	ResourceTracker::destroyTexture(this->texture);
+
+	this->textureView = nullptr;
+	this->texture = nullptr;
 }
@@ -11,13 +11,27 @@ namespace custom {
 			wgpu::Texture texture = nullptr;
 			wgpu::TextureView textureView = nullptr;
 
+			//kept so that an evicted texture can be loaded again from disk
+			fs::path path;
+			uint32_t generation = 0; //incremented every time the texture is (re)loaded
+
 		public:
-			Texture(const fs::path& path, wgpu::Device device);
+			Texture(const fs::path& path, wgpu::Device device);	// Throws std::runtime_error when the first load fails
 			~Texture();
 
 			wgpu::Texture GetTexture() const { return texture; }
 			wgpu::TextureView GetTextureView() const { return textureView; }
+			uint32_t GetGeneration() const { return generation; }
+
+			//residency
+			bool IsResident() const { return texture != nullptr; }
+			uint64_t GetGpuBytes() const;
+			void Evict();
+			uint64_t MakeResident(wgpu::Device device);	// Returns the number of bytes uploaded, 0 and still not resident when the file could not be loaded
+
+		private:
+			bool load(wgpu::Device device);
+			void release();
 	};
 }
 
-
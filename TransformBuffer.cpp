@@ -0,0 +1,139 @@
+#include "TransformBuffer.h"
+#include "TransformStore.h"
+#include "FrameRing.h"
+#include "ResourceTracker.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace wgpu;
+
+bool TransformBuffer::initialize(Device device, BindGroupLayout bindGroupLayout, Layout layout)
+{
+	this->device = device;
+	this->bindGroupLayout = bindGroupLayout;
+	this->layout = layout;
+
+	SupportedLimits limits;
+	this->device.getLimits(&limits);
+
+	//dynamic offsets must be multiples of the uniform offset alignment
+	if (layout == Layout::DynamicUniform) {
+		this->stride = ceilToNextMultiple((uint32_t)sizeof(glm::mat4), (uint32_t)limits.limits.minUniformBufferOffsetAlignment);
+	}
+	else {
+		this->stride = sizeof(glm::mat4);
+	}
+
+	resize(64);
+
+	return this->buffer && this->bindGroup;
+}
+
+void TransformBuffer::terminate()
+{
+	if (this->bindGroup) this->bindGroup.release();
+	ResourceTracker::destroyBuffer(this->buffer);
+
+	this->bindGroup = nullptr;
+	this->buffer = nullptr;
+	this->capacity = 0;
+	this->staging.clear();
+}
+
+uint32_t TransformBuffer::upload(Queue queue, FrameRing& ring, const TransformStore& transforms)
+{
+	uint32_t slotCount = (uint32_t)transforms.getSlotCount();
+	const std::vector<uint32_t>& changedSlots = transforms.getChangedSlots();
+
+	bool resized = reserve(slotCount);
+
+	//a new buffer has no content, so everything goes up
+	uint32_t firstSlot = resized ? 0 : UINT32_MAX;
+	uint32_t lastSlot = resized ? slotCount : 0;
+	if (!resized) {
+		for (uint32_t slot : changedSlots) {
+			firstSlot = std::min(firstSlot, slot);
+			lastSlot = std::max(lastSlot, slot + 1);
+		}
+	}
+
+	if (firstSlot >= lastSlot) return 0;
+
+	const glm::mat4* worldMatrices = transforms.getWorldMatrices();
+	uint64_t offset = (uint64_t)firstSlot * this->stride;
+	uint64_t size = (uint64_t)(lastSlot - firstSlot) * this->stride;
+
+	//the storage table has the layout of the store, so it is written without a copy
+	if (this->layout == Layout::StorageTable) {
+		ring.upload(queue, this->buffer, offset, &worldMatrices[firstSlot], size);
+		return 1;
+	}
+
+	if (resized) {
+		for (uint32_t slot = 0; slot < slotCount; ++slot) {
+			memcpy(&this->staging[(size_t)slot * this->stride], &worldMatrices[slot], sizeof(glm::mat4));
+		}
+	}
+	else {
+		for (uint32_t slot : changedSlots) {
+			memcpy(&this->staging[(size_t)slot * this->stride], &worldMatrices[slot], sizeof(glm::mat4));
+		}
+	}
+
+	//one write covering every changed slot
+	ring.upload(queue, this->buffer, offset, &this->staging[offset], size);
+
+	return 1;
+}
+
+bool TransformBuffer::reserve(uint32_t slotCount)
+{
+	if (slotCount <= this->capacity) return false;
+
+	resize(std::max(slotCount, this->capacity * 2));
+	return true;
+}
+
+void TransformBuffer::resize(uint32_t slotCount)
+{
+	if (this->bindGroup) this->bindGroup.release();
+	ResourceTracker::destroyBuffer(this->buffer);
+
+	this->capacity = slotCount;
+	this->generation++;
+	if (this->layout == Layout::DynamicUniform) {
+		this->staging.assign((size_t)slotCount * this->stride, 0);
+	}
+
+	BufferDescriptor bufferDescriptor = Default;
+	bufferDescriptor.size = (uint64_t)slotCount * this->stride;
+	bufferDescriptor.mappedAtCreation = false;
+	if (this->layout == Layout::DynamicUniform) {
+		bufferDescriptor.label = "Model Uniform Buffer";
+		bufferDescriptor.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
+	}
+	else {
+		bufferDescriptor.label = "Model Storage Buffer";
+		bufferDescriptor.usage = BufferUsage::Storage | BufferUsage::CopyDst;
+	}
+
+	ResourceCategory category = this->layout == Layout::DynamicUniform ? ResourceCategory::Uniform : ResourceCategory::Storage;
+	this->buffer = ResourceTracker::createBuffer(this->device, bufferDescriptor, category);
+
+	//a uniform binding covers a single matrix and the dynamic offset moves it along the buffer,
+	//a storage binding covers the whole table
+	BindGroupEntry entry = Default;
+	entry.binding = 0;
+	entry.buffer = this->buffer;
+	entry.offset = 0;
+	entry.size = this->layout == Layout::DynamicUniform ? sizeof(glm::mat4) : bufferDescriptor.size;
+
+	BindGroupDescriptor desc = Default;
+	desc.label = "Model Bind Group";
+	desc.layout = this->bindGroupLayout;
+	desc.entryCount = 1;
+	desc.entries = &entry;
+
+	this->bindGroup = this->device.createBindGroup(desc);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <webgpu/webgpu.hpp>
+
+class FrameRing;
+class TransformStore;
+
+//all model matrices packed in one buffer, one slot per transform store slot
+//as a uniform buffer each draw selects its matrix with a dynamic offset, as a storage buffer
+//the whole table is bound once and the shader indexes it with the instance index
+class TransformBuffer
+{
+public:
+	enum class Layout {
+		DynamicUniform,	//slots aligned to minUniformBufferOffsetAlignment
+		StorageTable,	//tightly packed array<mat4x4f>
+	};
+
+	bool initialize(wgpu::Device device, wgpu::BindGroupLayout bindGroupLayout, Layout layout);
+	void terminate();
+
+	// Copies the changed slots through the frame's upload slot, returns the number of writes (0 or 1)
+	uint32_t upload(wgpu::Queue queue, FrameRing& ring, const TransformStore& transforms);
+	bool reserve(uint32_t slotCount);	// Returns true when the buffer was replaced, its content is then undefined
+
+	wgpu::Buffer getBuffer() const { return buffer; }	// Written directly by GpuTransforms when it is a storage table
+
+	wgpu::BindGroup getBindGroup() const { return bindGroup; }
+	Layout getLayout() const { return layout; }
+	uint32_t getOffset(uint32_t slot) const { return slot * stride; }
+	uint32_t getStride() const { return stride; }
+	uint32_t getGeneration() const { return generation; }	// Changes whenever the buffer and bind group are replaced
+
+private:
+	void resize(uint32_t slotCount);
+
+	wgpu::Device device = nullptr;
+	wgpu::BindGroupLayout bindGroupLayout = nullptr;
+	wgpu::Buffer buffer = nullptr;
+	wgpu::BindGroup bindGroup = nullptr;
+
+	Layout layout = Layout::DynamicUniform;
+	uint32_t stride = 0;
+	uint32_t capacity = 0;	//in slots
+	uint32_t generation = 0;
+	std::vector<uint8_t> staging;	//CPU copy with the same layout as the buffer, the storage table uploads straight from the store
+};
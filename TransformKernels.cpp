@@ -0,0 +1,459 @@
+#include "TransformKernels.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#  define TRANSFORM_KERNELS_AVX2
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define TRANSFORM_KERNELS_SSE
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#  define TRANSFORM_KERNELS_NEON
+#  include <arm_neon.h>
+#endif
+
+static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+//the formulas follow glm::translate, glm::mat4_cast and glm::scale term by term so that the
+//scalar path gives the same result as the glm code it replaces
+static inline void composeOne(const glm::vec3& t, const glm::quat& q, const glm::vec3& s, glm::mat4& out)
+{
+	float qxx = q.x * q.x;
+	float qyy = q.y * q.y;
+	float qzz = q.z * q.z;
+	float qxz = q.x * q.z;
+	float qxy = q.x * q.y;
+	float qyz = q.y * q.z;
+	float qwx = q.w * q.x;
+	float qwy = q.w * q.y;
+	float qwz = q.w * q.z;
+
+	out[0] = glm::vec4((1.0f - 2.0f * (qyy + qzz)) * s.x, (2.0f * (qxy + qwz)) * s.x, (2.0f * (qxz - qwy)) * s.x, 0.0f);
+	out[1] = glm::vec4((2.0f * (qxy - qwz)) * s.y, (1.0f - 2.0f * (qxx + qzz)) * s.y, (2.0f * (qyz + qwx)) * s.y, 0.0f);
+	out[2] = glm::vec4((2.0f * (qxz + qwy)) * s.z, (2.0f * (qyz - qwx)) * s.z, (1.0f - 2.0f * (qxx + qyy)) * s.z, 0.0f);
+	out[3] = glm::vec4(t, 1.0f);
+}
+
+static inline void multiplyOne(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+	glm::mat4 result;
+	for (int c = 0; c < 4; ++c) {
+		result[c] = a[0] * b[c][0] + a[1] * b[c][1] + a[2] * b[c][2] + a[3] * b[c][3];
+	}
+	out = result;
+}
+
+#if defined(TRANSFORM_KERNELS_SSE) || defined(TRANSFORM_KERNELS_AVX2)
+
+//columns of a are kept in registers, one column of b is splatted per term
+static inline void multiplySSE(const float* a, const float* b, float* out)
+{
+	__m128 a0 = _mm_loadu_ps(a);
+	__m128 a1 = _mm_loadu_ps(a + 4);
+	__m128 a2 = _mm_loadu_ps(a + 8);
+	__m128 a3 = _mm_loadu_ps(a + 12);
+
+	__m128 c[4];
+	for (int i = 0; i < 4; ++i) {
+		__m128 column = _mm_loadu_ps(b + 4 * i);
+		__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+		c[i] = r;
+	}
+
+	//out may alias a or b
+	for (int i = 0; i < 4; ++i) _mm_storeu_ps(out + 4 * i, c[i]);
+}
+
+//one column of a product whose left matrix is already in registers
+static inline __m128 multiplyColumnSSE(__m128 a0, __m128 a1, __m128 a2, __m128 a3, __m128 column)
+{
+	__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+	r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+	r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+	r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+	return r;
+}
+
+//the columns of a are loaded once for the whole batch, the loop only streams b through; unrolling
+//to two matrices per iteration runs out of the 16 registers and is slower
+static inline void multiplyBatchSSE(const float* a, const glm::mat4* matrices, size_t count, glm::mat4* out)
+{
+	__m128 a0 = _mm_loadu_ps(a);
+	__m128 a1 = _mm_loadu_ps(a + 4);
+	__m128 a2 = _mm_loadu_ps(a + 8);
+	__m128 a3 = _mm_loadu_ps(a + 12);
+
+	for (size_t i = 0; i < count; ++i) {
+		const float* b = &matrices[i][0][0];
+		__m128 c0 = multiplyColumnSSE(a0, a1, a2, a3, _mm_loadu_ps(b));
+		__m128 c1 = multiplyColumnSSE(a0, a1, a2, a3, _mm_loadu_ps(b + 4));
+		__m128 c2 = multiplyColumnSSE(a0, a1, a2, a3, _mm_loadu_ps(b + 8));
+		__m128 c3 = multiplyColumnSSE(a0, a1, a2, a3, _mm_loadu_ps(b + 12));
+
+		//out may alias the matrices
+		float* m = &out[i][0][0];
+		_mm_storeu_ps(m, c0);
+		_mm_storeu_ps(m + 4, c1);
+		_mm_storeu_ps(m + 8, c2);
+		_mm_storeu_ps(m + 12, c3);
+	}
+}
+
+//four entries at a time: the quaternions are loaded as rows and transposed so that every
+//register holds one component of four objects, the columns are transposed back on store
+static inline void composeFourSSE(const glm::vec3* t[4], const glm::quat* q[4], const glm::vec3* s[4], glm::mat4* out[4])
+{
+	__m128 qx = _mm_loadu_ps(&q[0]->x);
+	__m128 qy = _mm_loadu_ps(&q[1]->x);
+	__m128 qz = _mm_loadu_ps(&q[2]->x);
+	__m128 qw = _mm_loadu_ps(&q[3]->x);
+	_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+	__m128 sx = _mm_setr_ps(s[0]->x, s[1]->x, s[2]->x, s[3]->x);
+	__m128 sy = _mm_setr_ps(s[0]->y, s[1]->y, s[2]->y, s[3]->y);
+	__m128 sz = _mm_setr_ps(s[0]->z, s[1]->z, s[2]->z, s[3]->z);
+
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 qxx = _mm_mul_ps(qx, qx);
+	__m128 qyy = _mm_mul_ps(qy, qy);
+	__m128 qzz = _mm_mul_ps(qz, qz);
+	__m128 qxz = _mm_mul_ps(qx, qz);
+	__m128 qxy = _mm_mul_ps(qx, qy);
+	__m128 qyz = _mm_mul_ps(qy, qz);
+	__m128 qwx = _mm_mul_ps(qw, qx);
+	__m128 qwy = _mm_mul_ps(qw, qy);
+	__m128 qwz = _mm_mul_ps(qw, qz);
+
+	__m128 m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qyy, qzz))), sx);
+	__m128 m01 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxy, qwz)), sx);
+	__m128 m02 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxz, qwy)), sx);
+	__m128 m10 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxy, qwz)), sy);
+	__m128 m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qzz))), sy);
+	__m128 m12 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qyz, qwx)), sy);
+	__m128 m20 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxz, qwy)), sz);
+	__m128 m21 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qyz, qwx)), sz);
+	__m128 m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qyy))), sz);
+
+	__m128 z0 = zero, z1 = zero, z2 = zero;
+	_MM_TRANSPOSE4_PS(m00, m01, m02, z0);
+	_MM_TRANSPOSE4_PS(m10, m11, m12, z1);
+	_MM_TRANSPOSE4_PS(m20, m21, m22, z2);
+
+	__m128 column0[4] = { m00, m01, m02, z0 };
+	__m128 column1[4] = { m10, m11, m12, z1 };
+	__m128 column2[4] = { m20, m21, m22, z2 };
+	for (int i = 0; i < 4; ++i) {
+		float* m = &(*out[i])[0][0];
+		_mm_storeu_ps(m, column0[i]);
+		_mm_storeu_ps(m + 4, column1[i]);
+		_mm_storeu_ps(m + 8, column2[i]);
+		_mm_storeu_ps(m + 12, _mm_setr_ps(t[i]->x, t[i]->y, t[i]->z, 1.0f));
+	}
+}
+
+#endif // TRANSFORM_KERNELS_SSE || TRANSFORM_KERNELS_AVX2
+
+#ifdef TRANSFORM_KERNELS_AVX2
+
+//two result columns per register, the columns of a are duplicated in both lanes
+static inline void multiplyAVX2(const float* a, const float* b, float* out)
+{
+	__m256 a0 = _mm256_broadcast_ps((const __m128*)a);
+	__m256 a1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+	__m256 a2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+	__m256 a3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+
+	__m256 b01 = _mm256_loadu_ps(b);
+	__m256 b23 = _mm256_loadu_ps(b + 8);
+
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)));
+	r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1)), r01);
+	r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2)), r01);
+	r01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3)), r01);
+
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)));
+	r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1)), r23);
+	r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2)), r23);
+	r23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3)), r23);
+
+	_mm256_storeu_ps(out, r01);
+	_mm256_storeu_ps(out + 8, r23);
+}
+
+static inline void multiplyBatchAVX2(const float* a, const glm::mat4* matrices, size_t count, glm::mat4* out)
+{
+	__m256 a0 = _mm256_broadcast_ps((const __m128*)a);
+	__m256 a1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+	__m256 a2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+	__m256 a3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+
+	for (size_t i = 0; i < count; ++i) {
+		const float* b = &matrices[i][0][0];
+		__m256 b01 = _mm256_loadu_ps(b);
+		__m256 b23 = _mm256_loadu_ps(b + 8);
+
+		__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)));
+		r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1)), r01);
+		r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2)), r01);
+		r01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3)), r01);
+
+		__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)));
+		r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1)), r23);
+		r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2)), r23);
+		r23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3)), r23);
+
+		float* m = &out[i][0][0];
+		_mm256_storeu_ps(m, r01);
+		_mm256_storeu_ps(m + 8, r23);
+	}
+}
+
+#endif // TRANSFORM_KERNELS_AVX2
+
+#ifdef TRANSFORM_KERNELS_NEON
+
+static inline void multiplyNEON(const float* a, const float* b, float* out)
+{
+	float32x4_t a0 = vld1q_f32(a);
+	float32x4_t a1 = vld1q_f32(a + 4);
+	float32x4_t a2 = vld1q_f32(a + 8);
+	float32x4_t a3 = vld1q_f32(a + 12);
+
+	float32x4_t c[4];
+	for (int i = 0; i < 4; ++i) {
+		float32x4_t column = vld1q_f32(b + 4 * i);
+		float32x4_t r = vmulq_lane_f32(a0, vget_low_f32(column), 0);
+		r = vmlaq_lane_f32(r, a1, vget_low_f32(column), 1);
+		r = vmlaq_lane_f32(r, a2, vget_high_f32(column), 0);
+		r = vmlaq_lane_f32(r, a3, vget_high_f32(column), 1);
+		c[i] = r;
+	}
+
+	for (int i = 0; i < 4; ++i) vst1q_f32(out + 4 * i, c[i]);
+}
+
+static inline void multiplyBatchNEON(const float* a, const glm::mat4* matrices, size_t count, glm::mat4* out)
+{
+	float32x4_t a0 = vld1q_f32(a);
+	float32x4_t a1 = vld1q_f32(a + 4);
+	float32x4_t a2 = vld1q_f32(a + 8);
+	float32x4_t a3 = vld1q_f32(a + 12);
+
+	for (size_t i = 0; i < count; ++i) {
+		const float* b = &matrices[i][0][0];
+		float32x4_t c[4];
+		for (int j = 0; j < 4; ++j) {
+			float32x4_t column = vld1q_f32(b + 4 * j);
+			float32x4_t r = vmulq_lane_f32(a0, vget_low_f32(column), 0);
+			r = vmlaq_lane_f32(r, a1, vget_low_f32(column), 1);
+			r = vmlaq_lane_f32(r, a2, vget_high_f32(column), 0);
+			r = vmlaq_lane_f32(r, a3, vget_high_f32(column), 1);
+			c[j] = r;
+		}
+
+		float* m = &out[i][0][0];
+		for (int j = 0; j < 4; ++j) vst1q_f32(m + 4 * j, c[j]);
+	}
+}
+
+static inline void transposeNEON(float32x4_t& a, float32x4_t& b, float32x4_t& c, float32x4_t& d)
+{
+	float32x4x2_t ab = vtrnq_f32(a, b);
+	float32x4x2_t cd = vtrnq_f32(c, d);
+	a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+	b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+	c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+	d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+static inline void composeFourNEON(const glm::vec3* t[4], const glm::quat* q[4], const glm::vec3* s[4], glm::mat4* out[4])
+{
+	float32x4_t qx = vld1q_f32(&q[0]->x);
+	float32x4_t qy = vld1q_f32(&q[1]->x);
+	float32x4_t qz = vld1q_f32(&q[2]->x);
+	float32x4_t qw = vld1q_f32(&q[3]->x);
+	transposeNEON(qx, qy, qz, qw);
+
+	float sxValues[4] = { s[0]->x, s[1]->x, s[2]->x, s[3]->x };
+	float syValues[4] = { s[0]->y, s[1]->y, s[2]->y, s[3]->y };
+	float szValues[4] = { s[0]->z, s[1]->z, s[2]->z, s[3]->z };
+	float32x4_t sx = vld1q_f32(sxValues);
+	float32x4_t sy = vld1q_f32(syValues);
+	float32x4_t sz = vld1q_f32(szValues);
+
+	float32x4_t one = vdupq_n_f32(1.0f);
+	float32x4_t two = vdupq_n_f32(2.0f);
+	float32x4_t zero = vdupq_n_f32(0.0f);
+
+	float32x4_t qxx = vmulq_f32(qx, qx);
+	float32x4_t qyy = vmulq_f32(qy, qy);
+	float32x4_t qzz = vmulq_f32(qz, qz);
+	float32x4_t qxz = vmulq_f32(qx, qz);
+	float32x4_t qxy = vmulq_f32(qx, qy);
+	float32x4_t qyz = vmulq_f32(qy, qz);
+	float32x4_t qwx = vmulq_f32(qw, qx);
+	float32x4_t qwy = vmulq_f32(qw, qy);
+	float32x4_t qwz = vmulq_f32(qw, qz);
+
+	float32x4_t m00 = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(qyy, qzz))), sx);
+	float32x4_t m01 = vmulq_f32(vmulq_f32(two, vaddq_f32(qxy, qwz)), sx);
+	float32x4_t m02 = vmulq_f32(vmulq_f32(two, vsubq_f32(qxz, qwy)), sx);
+	float32x4_t m10 = vmulq_f32(vmulq_f32(two, vsubq_f32(qxy, qwz)), sy);
+	float32x4_t m11 = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(qxx, qzz))), sy);
+	float32x4_t m12 = vmulq_f32(vmulq_f32(two, vaddq_f32(qyz, qwx)), sy);
+	float32x4_t m20 = vmulq_f32(vmulq_f32(two, vaddq_f32(qxz, qwy)), sz);
+	float32x4_t m21 = vmulq_f32(vmulq_f32(two, vsubq_f32(qyz, qwx)), sz);
+	float32x4_t m22 = vmulq_f32(vsubq_f32(one, vmulq_f32(two, vaddq_f32(qxx, qyy))), sz);
+
+	float32x4_t z0 = zero, z1 = zero, z2 = zero;
+	transposeNEON(m00, m01, m02, z0);
+	transposeNEON(m10, m11, m12, z1);
+	transposeNEON(m20, m21, m22, z2);
+
+	float32x4_t column0[4] = { m00, m01, m02, z0 };
+	float32x4_t column1[4] = { m10, m11, m12, z1 };
+	float32x4_t column2[4] = { m20, m21, m22, z2 };
+	for (int i = 0; i < 4; ++i) {
+		float* m = &(*out[i])[0][0];
+		float translation[4] = { t[i]->x, t[i]->y, t[i]->z, 1.0f };
+		vst1q_f32(m, column0[i]);
+		vst1q_f32(m + 4, column1[i]);
+		vst1q_f32(m + 8, column2[i]);
+		vst1q_f32(m + 12, vld1q_f32(translation));
+	}
+}
+
+#endif // TRANSFORM_KERNELS_NEON
+
+static inline void multiplyFast(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#if defined(TRANSFORM_KERNELS_AVX2)
+	multiplyAVX2(&a[0][0], &b[0][0], &out[0][0]);
+#elif defined(TRANSFORM_KERNELS_SSE)
+	multiplySSE(&a[0][0], &b[0][0], &out[0][0]);
+#elif defined(TRANSFORM_KERNELS_NEON)
+	multiplyNEON(&a[0][0], &b[0][0], &out[0][0]);
+#else
+	multiplyOne(a, b, out);
+#endif
+}
+
+TransformKernels::Isa TransformKernels::getIsa()
+{
+#if defined(TRANSFORM_KERNELS_AVX2)
+	return Isa::AVX2;
+#elif defined(TRANSFORM_KERNELS_SSE)
+	return Isa::SSE;
+#elif defined(TRANSFORM_KERNELS_NEON)
+	return Isa::NEON;
+#else
+	return Isa::Scalar;
+#endif
+}
+
+const char* TransformKernels::getIsaName(Isa isa)
+{
+	switch (isa) {
+	case Isa::Scalar: return "scalar";
+	case Isa::SSE: return "SSE";
+	case Isa::AVX2: return "AVX2";
+	case Isa::NEON: return "NEON";
+	}
+	return "unknown";
+}
+
+void TransformKernels::composeTRS(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+	const uint32_t* indices, size_t count, glm::mat4* out)
+{
+	size_t i = 0;
+#if defined(TRANSFORM_KERNELS_SSE) || defined(TRANSFORM_KERNELS_AVX2) || defined(TRANSFORM_KERNELS_NEON)
+	for (; i + 4 <= count; i += 4) {
+		const glm::vec3* t[4];
+		const glm::quat* q[4];
+		const glm::vec3* s[4];
+		glm::mat4* m[4];
+		for (size_t j = 0; j < 4; ++j) {
+			size_t index = indices ? indices[i + j] : i + j;
+			t[j] = &translations[index];
+			q[j] = &rotations[index];
+			s[j] = &scales[index];
+			m[j] = &out[i + j];
+		}
+#  ifdef TRANSFORM_KERNELS_NEON
+		composeFourNEON(t, q, s, m);
+#  else
+		composeFourSSE(t, q, s, m);
+#  endif
+	}
+#endif
+	//remainder, or everything without SIMD
+	for (; i < count; ++i) {
+		size_t index = indices ? indices[i] : i;
+		composeOne(translations[index], rotations[index], scales[index], out[i]);
+	}
+}
+
+void TransformKernels::composeTRSScalar(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+	const uint32_t* indices, size_t count, glm::mat4* out)
+{
+	for (size_t i = 0; i < count; ++i) {
+		size_t index = indices ? indices[i] : i;
+		composeOne(translations[index], rotations[index], scales[index], out[i]);
+	}
+}
+
+void TransformKernels::propagate(const uint32_t* slots, size_t count, const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds)
+{
+	//in order, a parent listed earlier is already up to date when its children read it
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t slot = slots[i];
+		uint32_t parent = parents[slot];
+		if (parent == InvalidIndex) {
+			worlds[slot] = locals[i];
+		}
+		else {
+			multiplyFast(worlds[parent], locals[i], worlds[slot]);
+		}
+	}
+}
+
+void TransformKernels::propagateScalar(const uint32_t* slots, size_t count, const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds)
+{
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t slot = slots[i];
+		uint32_t parent = parents[slot];
+		if (parent == InvalidIndex) {
+			worlds[slot] = locals[i];
+		}
+		else {
+			multiplyOne(worlds[parent], locals[i], worlds[slot]);
+		}
+	}
+}
+
+void TransformKernels::multiply(const glm::mat4& lhs, const glm::mat4* matrices, size_t count, glm::mat4* out)
+{
+#if defined(TRANSFORM_KERNELS_AVX2)
+	multiplyBatchAVX2(&lhs[0][0], matrices, count, out);
+#elif defined(TRANSFORM_KERNELS_SSE)
+	multiplyBatchSSE(&lhs[0][0], matrices, count, out);
+#elif defined(TRANSFORM_KERNELS_NEON)
+	multiplyBatchNEON(&lhs[0][0], matrices, count, out);
+#else
+	for (size_t i = 0; i < count; ++i) {
+		multiplyOne(lhs, matrices[i], out[i]);
+	}
+#endif
+}
+
+void TransformKernels::multiplyScalar(const glm::mat4& lhs, const glm::mat4* matrices, size_t count, glm::mat4* out)
+{
+	for (size_t i = 0; i < count; ++i) {
+		multiplyOne(lhs, matrices[i], out[i]);
+	}
+}
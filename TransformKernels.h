@@ -0,0 +1,31 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstddef>
+#include <cstdint>
+
+//batched matrix kernels used by the transform store and for precomputing model-view-projection matrices
+//the SIMD path is picked at compile time (AVX2 when enabled, SSE on x86, NEON on ARM), the scalar
+//functions are the reference the SIMD paths are checked against
+class TransformKernels
+{
+public:
+	enum class Isa { Scalar, SSE, AVX2, NEON };
+
+	static Isa getIsa();
+	static const char* getIsaName(Isa isa);
+
+	// out[i] = T * R * S of entry indices[i], or of entry i when indices is null
+	static void composeTRS(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+		const uint32_t* indices, size_t count, glm::mat4* out);
+	static void composeTRSScalar(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales,
+		const uint32_t* indices, size_t count, glm::mat4* out);
+
+	// worlds[slots[i]] = worlds[parents[slots[i]]] * locals[i], slots must list parents before their children
+	static void propagate(const uint32_t* slots, size_t count, const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds);
+	static void propagateScalar(const uint32_t* slots, size_t count, const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds);
+
+	// out[i] = lhs * matrices[i], e.g. the view projection matrix times every model matrix
+	static void multiply(const glm::mat4& lhs, const glm::mat4* matrices, size_t count, glm::mat4* out);
+	static void multiplyScalar(const glm::mat4& lhs, const glm::mat4* matrices, size_t count, glm::mat4* out);
+};
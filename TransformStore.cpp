@@ -0,0 +1,292 @@
+#include "TransformStore.h"
+#include "TransformKernels.h"
+#include "JobSystem.h"
+#include <algorithm>
+
+uint32_t TransformStore::create()
+{
+	uint32_t id;
+	if (!this->freeIds.empty()) {
+		id = this->freeIds.back();
+		this->freeIds.pop_back();
+	}
+	else {
+		id = (uint32_t)this->idToSlot.size();
+		this->idToSlot.push_back(InvalidIndex);
+	}
+
+	uint32_t slot = (uint32_t)this->parents.size();
+	this->idToSlot[id] = slot;
+
+	this->parents.push_back(InvalidIndex);
+	this->translations.push_back(glm::vec3(0.0f));
+	this->rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	this->scales.push_back(glm::vec3(1.0f));
+	this->worldMatrices.push_back(glm::mat4(1.0f));
+	this->slotToId.push_back(id);
+	this->dirty.push_back(1);
+	this->changed.push_back(0);
+	this->localChanged.push_back(0);
+	this->anyDirty = true;
+	this->levelsValid = false;
+
+	return id;
+}
+
+void TransformStore::destroy(uint32_t id)
+{
+	uint32_t slot = this->idToSlot[id];
+
+	//the slot is reclaimed by the next sort
+	this->parents[slot] = InvalidIndex;
+	this->slotToId[slot] = InvalidIndex;
+	this->idToSlot[id] = InvalidIndex;
+	this->freeIds.push_back(id);
+	this->freeSlotCount++;
+
+	this->needsSort = true;
+}
+
+void TransformStore::clear()
+{
+	this->parents.clear();
+	this->translations.clear();
+	this->rotations.clear();
+	this->scales.clear();
+	this->worldMatrices.clear();
+	this->slotToId.clear();
+	this->dirty.clear();
+	this->changed.clear();
+	this->changedSlots.clear();
+	this->localChanged.clear();
+	this->pendingLocalSlots.clear();
+	this->localChangedSlots.clear();
+	this->anyDirty = false;
+
+	this->idToSlot.clear();
+	this->freeIds.clear();
+	this->freeSlotCount = 0;
+
+	this->needsSort = false;
+	this->levelStarts.clear();
+	this->levelsValid = false;
+	this->sortCount++;
+}
+
+void TransformStore::setParent(uint32_t id, uint32_t parentId)
+{
+	uint32_t slot = this->idToSlot[id];
+	uint32_t parentSlot = parentId == InvalidIndex ? InvalidIndex : this->idToSlot[parentId];
+	this->parents[slot] = parentSlot;
+	markDirty(slot);
+	this->levelsValid = false;
+
+	//a parent stored after its child breaks the linear update
+	if (parentSlot != InvalidIndex && parentSlot > slot) {
+		this->needsSort = true;
+	}
+}
+
+glm::mat4 TransformStore::getLocalMatrix(uint32_t id) const
+{
+	uint32_t slot = this->idToSlot[id];
+
+	glm::mat4 model = glm::mat4(1.0f);
+	model = glm::translate(model, this->translations[slot]);
+	model *= glm::mat4_cast(this->rotations[slot]);
+	model = glm::scale(model, this->scales[slot]);
+
+	return model;
+}
+
+void TransformStore::invalidate()
+{
+	std::fill(this->dirty.begin(), this->dirty.end(), 1);
+	this->anyDirty = true;
+}
+
+void TransformStore::update(JobSystem* jobs)
+{
+	//clear the results of the previous update
+	for (uint32_t slot : this->changedSlots) {
+		if (slot < this->changed.size()) this->changed[slot] = 0;
+	}
+	this->changedSlots.clear();
+
+	bool parallel = jobs && jobs->getThreadCount() > 1 && this->parents.size() >= 2 * ParallelBatch;
+
+	//the parallel update and the GPU walk the hierarchy one level at a time
+	if ((parallel || !this->cpuWorldMatrices) && this->anyDirty && !this->levelsValid) {
+		this->needsSort = true;
+	}
+
+	if (this->needsSort) {
+		sort();
+	}
+
+	//the pending list keeps the capacity of the list it replaces
+	for (uint32_t slot : this->pendingLocalSlots) {
+		this->localChanged[slot] = 0;
+	}
+	this->localChangedSlots.swap(this->pendingLocalSlots);
+	this->pendingLocalSlots.clear();
+
+	//the GPU recomputes every level from the locals, so walking the dirty subtrees would only find
+	//slots nobody uploads; the dirty flags stay set for when the CPU matrices are enabled again
+	if (!this->cpuWorldMatrices) return;
+
+	//a static scene does no work at all
+	if (!this->anyDirty) return;
+
+	//sized for the worst case once, so that steady state frames do not allocate
+	this->changedSlots.reserve(this->parents.size());
+
+	if (parallel) {
+		updateParallel(*jobs);
+	}
+	else {
+		updateRange(0, (uint32_t)this->parents.size(), this->serialResult);
+		this->changedSlots.assign(this->serialResult.slots.begin(), this->serialResult.slots.end());
+	}
+
+	this->anyDirty = false;
+}
+
+void TransformStore::updateRange(uint32_t first, uint32_t last, RangeResult& result)
+{
+	result.slots.clear();
+	result.slots.reserve(last - first);
+	result.locals.reserve(last - first);
+
+	//first pass only decides which slots change
+	for (uint32_t slot = first; slot < last; ++slot) {
+		//parents come first, so a changed parent is already flagged when we get to its children
+		uint32_t parent = this->parents[slot];
+		bool parentChanged = parent != InvalidIndex && this->changed[parent];
+		if (!this->dirty[slot] && !parentChanged) continue;
+
+		this->dirty[slot] = 0;
+		this->changed[slot] = 1;
+		result.slots.push_back(slot);
+	}
+
+	if (!this->cpuWorldMatrices) return;
+
+	//then the matrices of the changed slots are built in batches
+	size_t changedCount = result.slots.size();
+	result.locals.resize(changedCount);
+	TransformKernels::composeTRS(this->translations.data(), this->rotations.data(), this->scales.data(),
+		result.slots.data(), changedCount, result.locals.data());
+	TransformKernels::propagate(result.slots.data(), changedCount, this->parents.data(), result.locals.data(), this->worldMatrices.data());
+}
+
+void TransformStore::updateParallel(JobSystem& jobs)
+{
+	size_t maxChunks = (size_t)jobs.getThreadCount() * 4;
+	if (this->chunkResults.size() < maxChunks) {
+		this->chunkResults.resize(maxChunks);
+	}
+
+	//the parents of a level are final once the previous level is done, so its slots can be split freely
+	for (size_t level = 0; level + 1 < this->levelStarts.size(); ++level) {
+		uint32_t levelStart = this->levelStarts[level];
+		size_t levelSize = this->levelStarts[level + 1] - levelStart;
+		size_t chunkCount = std::max<size_t>(1, std::min(maxChunks, levelSize / ParallelBatch));
+
+		jobs.parallelFor(levelSize, chunkCount, [&](size_t begin, size_t end, size_t chunk) {
+			updateRange(levelStart + (uint32_t)begin, levelStart + (uint32_t)end, this->chunkResults[chunk]);
+			});
+
+		for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+			const std::vector<uint32_t>& slots = this->chunkResults[chunk].slots;
+			this->changedSlots.insert(this->changedSlots.end(), slots.begin(), slots.end());
+		}
+	}
+}
+
+void TransformStore::sort()
+{
+	size_t count = this->parents.size();
+
+	//depth of every live slot, a destroyed parent turns its children into roots
+	std::vector<uint32_t> depths(count, InvalidIndex);
+	std::vector<uint32_t> chain;
+	uint32_t maxDepth = 0;
+	for (uint32_t slot = 0; slot < count; ++slot) {
+		if (this->slotToId[slot] == InvalidIndex || depths[slot] != InvalidIndex) continue;
+
+		uint32_t current = slot;
+		while (current != InvalidIndex && depths[current] == InvalidIndex) {
+			chain.push_back(current);
+			uint32_t parent = this->parents[current];
+			if (parent != InvalidIndex && this->slotToId[parent] == InvalidIndex) {
+				this->parents[current] = InvalidIndex;
+				parent = InvalidIndex;
+			}
+			current = parent;
+		}
+
+		uint32_t depth = current == InvalidIndex ? 0 : depths[current] + 1;
+		while (!chain.empty()) {
+			depths[chain.back()] = depth++;
+			chain.pop_back();
+		}
+		maxDepth = std::max(maxDepth, depth - 1);
+	}
+
+	//counting sort by depth keeps the relative order of siblings
+	std::vector<uint32_t> levelStarts(maxDepth + 2, 0);
+	for (uint32_t slot = 0; slot < count; ++slot) {
+		if (depths[slot] != InvalidIndex) levelStarts[depths[slot] + 1]++;
+	}
+	for (size_t level = 1; level < levelStarts.size(); ++level) {
+		levelStarts[level] += levelStarts[level - 1];
+	}
+	this->levelStarts = levelStarts;
+	this->levelsValid = true;
+
+	std::vector<uint32_t> newSlots(count, InvalidIndex);
+	for (uint32_t slot = 0; slot < count; ++slot) {
+		if (depths[slot] != InvalidIndex) newSlots[slot] = levelStarts[depths[slot]]++;
+	}
+
+	size_t liveCount = count - this->freeSlotCount;
+	std::vector<uint32_t> parents(liveCount);
+	std::vector<glm::vec3> translations(liveCount);
+	std::vector<glm::quat> rotations(liveCount);
+	std::vector<glm::vec3> scales(liveCount);
+	std::vector<glm::mat4> worldMatrices(liveCount);
+	std::vector<uint32_t> slotToId(liveCount);
+	std::vector<uint8_t> dirty(liveCount, 1);	//moved slots have to be uploaded again
+	std::vector<uint8_t> changed(liveCount, 0);
+	std::vector<uint8_t> localChanged(liveCount, 0);	//every slot is uploaded after a sort anyway
+	for (uint32_t slot = 0; slot < count; ++slot) {
+		uint32_t newSlot = newSlots[slot];
+		if (newSlot == InvalidIndex) continue;
+
+		uint32_t parent = this->parents[slot];
+		parents[newSlot] = parent == InvalidIndex ? InvalidIndex : newSlots[parent];
+		translations[newSlot] = this->translations[slot];
+		rotations[newSlot] = this->rotations[slot];
+		scales[newSlot] = this->scales[slot];
+		worldMatrices[newSlot] = this->worldMatrices[slot];
+		slotToId[newSlot] = this->slotToId[slot];
+		this->idToSlot[this->slotToId[slot]] = newSlot;
+	}
+
+	this->parents = std::move(parents);
+	this->translations = std::move(translations);
+	this->rotations = std::move(rotations);
+	this->scales = std::move(scales);
+	this->worldMatrices = std::move(worldMatrices);
+	this->slotToId = std::move(slotToId);
+	this->dirty = std::move(dirty);
+	this->changed = std::move(changed);
+	this->localChanged = std::move(localChanged);
+	this->pendingLocalSlots.clear();
+	this->anyDirty = true;
+
+	this->freeSlotCount = 0;
+	this->needsSort = false;
+	this->sortCount++;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+//contiguous storage for the transforms of every scene node
+//nodes are kept topologically sorted (parents before children) so that world matrices
+//are computed by one linear pass instead of a recursive walk over heap allocated nodes
+//only nodes whose local transform changed, and their subtrees, are recomputed
+class TransformStore
+{
+public:
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+	uint32_t create();	// Returns the id of a new root node with an identity transform
+	void destroy(uint32_t id);
+	void clear();	// Destroys every node at once, the storage is kept for the next nodes
+	void setParent(uint32_t id, uint32_t parentId);
+
+	void setTranslation(uint32_t id, const glm::vec3& translation) { translations[idToSlot[id]] = translation; markLocalChanged(idToSlot[id]); }
+	void setRotation(uint32_t id, const glm::quat& rotation) { rotations[idToSlot[id]] = rotation; markLocalChanged(idToSlot[id]); }
+	void setScale(uint32_t id, const glm::vec3& scale) { scales[idToSlot[id]] = scale; markLocalChanged(idToSlot[id]); }
+	const glm::vec3& getTranslation(uint32_t id) const { return translations[idToSlot[id]]; }
+	const glm::quat& getRotation(uint32_t id) const { return rotations[idToSlot[id]]; }
+	const glm::vec3& getScale(uint32_t id) const { return scales[idToSlot[id]]; }
+
+	glm::mat4 getLocalMatrix(uint32_t id) const;
+	const glm::mat4& getWorldMatrix(uint32_t id) const { return worldMatrices[idToSlot[id]]; }
+
+	void invalidate();	// Mark every node dirty so that the next update recomputes everything
+	void update(JobSystem* jobs = nullptr);	// Recompute the world matrices of dirty subtrees, sorting the nodes first if the hierarchy changed
+
+	// Without CPU world matrices, update() only keeps the slots sorted by level and reports the local
+	// transforms that were set, the subtrees are not walked and the matrices are left to the GPU (see
+	// GpuTransforms); they go stale here and catch up once CPU world matrices are enabled again
+	void setCpuWorldMatrices(bool enabled) { cpuWorldMatrices = enabled; }
+	bool hasCpuWorldMatrices() const { return cpuWorldMatrices; }
+
+	//results of the last update
+	bool wasChanged(uint32_t id) const { return changed[idToSlot[id]] != 0; }
+	const std::vector<uint32_t>& getChangedSlots() const { return changedSlots; }
+	uint32_t getComputedCount() const { return (uint32_t)changedSlots.size(); }
+	// Slots whose translation, rotation or scale was set before the last update, without their subtrees;
+	// empty after a sort, every slot moved then
+	const std::vector<uint32_t>& getLocalChangedSlots() const { return localChangedSlots; }
+
+	uint32_t getSlot(uint32_t id) const { return idToSlot[id]; }
+	size_t getSlotCount() const { return parents.size(); }
+	const glm::mat4* getWorldMatrices() const { return worldMatrices.data(); }
+	const uint32_t* getParents() const { return parents.data(); }
+	const glm::vec3* getTranslations() const { return translations.data(); }
+	const glm::quat* getRotations() const { return rotations.data(); }
+	const glm::vec3* getScales() const { return scales.data(); }
+	uint32_t getLevelCount() const { return levelsValid ? (uint32_t)levelStarts.size() - 1 : 0; }	// Depth levels of the last sort, 0 when out of date
+	const std::vector<uint32_t>& getLevelStarts() const { return levelStarts; }	// First slot of every level and the slot count, valid with getLevelCount()
+	uint32_t getSortCount() const { return sortCount; }	// Changes whenever the slots move or their parents change
+
+	static constexpr size_t ParallelBatch = 4096;	//smallest range of slots worth handing to another thread
+
+private:
+	//output of updating a range of slots
+	struct RangeResult {
+		std::vector<uint32_t> slots;
+		std::vector<glm::mat4> locals;
+	};
+
+	void sort();
+	void updateRange(uint32_t first, uint32_t last, RangeResult& result);
+	void updateParallel(JobSystem& jobs);
+	void markDirty(uint32_t slot) { dirty[slot] = 1; anyDirty = true; }
+	void markLocalChanged(uint32_t slot) {
+		if (!localChanged[slot]) {
+			localChanged[slot] = 1;
+			pendingLocalSlots.push_back(slot);
+		}
+		markDirty(slot);
+	}
+
+	//per slot data, the parent is stored as a slot index
+	std::vector<uint32_t> parents;
+	std::vector<glm::vec3> translations;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<uint32_t> slotToId;
+	std::vector<uint8_t> dirty;	//local transform or parent changed since the last update
+	std::vector<uint8_t> changed;	//world matrix recomputed by the last update
+	std::vector<uint32_t> changedSlots;
+	std::vector<uint8_t> localChanged;	//local transform set since the last update
+	std::vector<uint32_t> pendingLocalSlots;	//the slots flagged in localChanged
+	std::vector<uint32_t> localChangedSlots;	//swapped with pendingLocalSlots by update
+	RangeResult serialResult;	//reused between updates
+	std::vector<RangeResult> chunkResults;
+	bool anyDirty = false;
+
+	//ids stay valid when slots move during a sort
+	std::vector<uint32_t> idToSlot;
+	std::vector<uint32_t> freeIds;
+	uint32_t freeSlotCount = 0;
+
+	bool needsSort = false;
+	bool cpuWorldMatrices = true;
+	uint32_t sortCount = 0;
+
+	//first slot of every depth level, nodes of one level never depend on each other
+	std::vector<uint32_t> levelStarts;
+	bool levelsValid = false;
+};
@@ -8,9 +8,20 @@
 #define WINDOW_HEIGHT 720
 
 
-int main() {
+// Usage: App [--benchmark config.json] (see BenchmarkRun.h for the config)
+int main(int argc, char** argv) {
     Application app;
 
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--benchmark" && i + 1 < argc) {
+            BenchmarkRun::Config config;
+            if (!BenchmarkRun::loadConfig(argv[++i], config)) {
+                return 1;
+            }
+            app.setBenchmark(config);
+        }
+    }
+
     if (!app.Initialize(WINDOW_WIDTH, WINDOW_HEIGHT)) {
         return 1;
     }
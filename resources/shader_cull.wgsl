@@ -0,0 +1,131 @@
+// Occlusion culling of the scene items against the hierarchical depth pyramid
+// The first phase tests every item against the pyramid of the previous frame, the second phase
+// tests the items the first one rejected against the pyramid of what the first phase drew
+
+struct CullUniforms {
+	viewProjection: mat4x4f,
+	depthSize: vec2u,	// Pixels of the depth buffer
+	itemCount: u32,
+	levelCount: u32,	// Levels of the pyramid
+};
+
+// World space box and draw arguments of one scene item
+struct CullItem {
+	boundsMin: vec3f,
+	indexCount: u32,
+	boundsMax: vec3f,
+	firstInstance: u32,
+};
+
+// Layout of the arguments of drawIndexedIndirect
+struct DrawIndexedIndirect {
+	indexCount: u32,
+	instanceCount: u32,
+	firstIndex: u32,
+	baseVertex: i32,
+	firstInstance: u32,
+};
+
+struct Counters {
+	drawnFirstPhase: atomic<u32>,
+	drawnSecondPhase: atomic<u32>,
+	culled: atomic<u32>,
+	padding: u32,
+};
+
+@group(0) @binding(0) var<uniform> uniforms: CullUniforms;
+@group(0) @binding(1) var<storage, read> items: array<CullItem>;
+// The first phase writes the first itemCount draws, the second phase the next itemCount
+@group(0) @binding(2) var<storage, read_write> draws: array<DrawIndexedIndirect>;
+@group(0) @binding(3) var<storage, read_write> visibility: array<u32>;
+@group(0) @binding(4) var<storage, read_write> counters: Counters;
+@group(0) @binding(5) var pyramid: texture_2d<f32>;
+
+fn isVisible(item: CullItem) -> bool {
+	var minPixel = vec2f(1e30);
+	var maxPixel = vec2f(-1e30);
+	var minDepth = 1e30;
+	for (var corner = 0u; corner < 8u; corner++) {
+		let position = vec3f(
+			select(item.boundsMin.x, item.boundsMax.x, (corner & 1u) != 0u),
+			select(item.boundsMin.y, item.boundsMax.y, (corner & 2u) != 0u),
+			select(item.boundsMin.z, item.boundsMax.z, (corner & 4u) != 0u));
+		let clip = uniforms.viewProjection * vec4f(position, 1.0);
+		// Boxes reaching the near plane cover the whole screen
+		if (clip.w < 1e-5 || clip.z < 0.0) {
+			return true;
+		}
+		let ndc = clip.xyz / clip.w;
+		let pixel = vec2f(ndc.x * 0.5 + 0.5, 0.5 - ndc.y * 0.5) * vec2f(uniforms.depthSize);
+		minPixel = min(minPixel, pixel);
+		maxPixel = max(maxPixel, pixel);
+		minDepth = min(minDepth, ndc.z);
+	}
+
+	// Outside the frustum
+	let size = vec2f(uniforms.depthSize);
+	if (any(maxPixel < vec2f(0.0)) || any(minPixel >= size) || minDepth > 1.0) {
+		return false;
+	}
+
+	// Level L of the pyramid covers 2^(L + 1) pixels per texel, take the first one where the box
+	// touches at most 2x2 texels
+	let first = vec2u(clamp(floor(minPixel), vec2f(0.0), size - 1.0));
+	let last = vec2u(clamp(floor(maxPixel), vec2f(0.0), size - 1.0));
+	var level = 0u;
+	loop {
+		let span = (last >> vec2u(level + 1u)) - (first >> vec2u(level + 1u));
+		if (all(span <= vec2u(1u)) || level + 1u >= uniforms.levelCount) {
+			break;
+		}
+		level++;
+	}
+
+	let a = first >> vec2u(level + 1u);
+	let b = last >> vec2u(level + 1u);
+	let farthest = max(
+		max(textureLoad(pyramid, a, level).r, textureLoad(pyramid, vec2u(b.x, a.y), level).r),
+		max(textureLoad(pyramid, vec2u(a.x, b.y), level).r, textureLoad(pyramid, b, level).r));
+	return minDepth <= farthest;
+}
+
+fn writeDraw(index: u32, item: CullItem, visible: bool) {
+	draws[index] = DrawIndexedIndirect(item.indexCount, select(0u, 1u, visible), 0u, 0, item.firstInstance);
+}
+
+@compute @workgroup_size(64)
+fn cull_first_phase(@builtin(global_invocation_id) id: vec3u) {
+	let index = id.x;
+	if (index >= uniforms.itemCount) {
+		return;
+	}
+	let item = items[index];
+	let visible = isVisible(item);
+	visibility[index] = select(0u, 1u, visible);
+	writeDraw(index, item, visible);
+	if (visible) {
+		atomicAdd(&counters.drawnFirstPhase, 1u);
+	}
+}
+
+@compute @workgroup_size(64)
+fn cull_second_phase(@builtin(global_invocation_id) id: vec3u) {
+	let index = id.x;
+	if (index >= uniforms.itemCount) {
+		return;
+	}
+	let item = items[index];
+	// Items of the first phase are already in the depth buffer
+	if (visibility[index] != 0u) {
+		writeDraw(uniforms.itemCount + index, item, false);
+		return;
+	}
+	let visible = isVisible(item);
+	writeDraw(uniforms.itemCount + index, item, visible);
+	if (visible) {
+		atomicAdd(&counters.drawnSecondPhase, 1u);
+	}
+	else {
+		atomicAdd(&counters.culled, 1u);
+	}
+}
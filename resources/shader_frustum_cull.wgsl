@@ -0,0 +1,79 @@
+// Frustum culling of every object on the GPU, compacted into one instanced indirect draw per group
+// The objects of a group share a mesh; each visible object appends its transform slot to the
+// group's range of object indices and counts itself in the instance count of the group's draw
+
+struct FrustumUniforms {
+	planes: array<vec4f, 6>,	// Facing inwards, like Frustum in Bounds.h
+	objectCount: u32,
+	padding0: u32,
+	padding1: u32,
+	padding2: u32,
+};
+
+// Model space box of one object, its world matrix is read from the transform table
+struct CullObject {
+	boundsMin: vec3f,
+	transformSlot: u32,
+	boundsMax: vec3f,
+	group: u32,
+};
+
+// Layout of the arguments of drawIndexedIndirect, the instance count is the append counter
+struct DrawArguments {
+	indexCount: u32,
+	instanceCount: atomic<u32>,
+	firstIndex: u32,
+	baseVertex: i32,
+	firstInstance: u32,	// First object index of the group
+};
+
+@group(0) @binding(0) var<uniform> uniforms: FrustumUniforms;
+@group(0) @binding(1) var<storage, read> objects: array<CullObject>;
+@group(0) @binding(2) var<storage, read> worlds: array<mat4x4f>;
+@group(0) @binding(3) var<storage, read_write> draws: array<DrawArguments>;
+@group(0) @binding(4) var<storage, read_write> objectIndices: array<u32>;
+@group(0) @binding(5) var<storage, read_write> visibleCount: atomic<u32>;
+
+var<workgroup> workgroupVisible: atomic<u32>;
+
+fn isVisible(object: CullObject) -> bool {
+	// World box around the transformed model box, the extents grow by the absolute matrix
+	let world = worlds[object.transformSlot];
+	let localCenter = (object.boundsMin + object.boundsMax) * 0.5;
+	let localExtents = (object.boundsMax - object.boundsMin) * 0.5;
+	let center = (world * vec4f(localCenter, 1.0)).xyz;
+	let extents = abs(world[0].xyz) * localExtents.x + abs(world[1].xyz) * localExtents.y + abs(world[2].xyz) * localExtents.z;
+
+	for (var i = 0u; i < 6u; i++) {
+		let plane = uniforms.planes[i];
+		let distance = dot(plane.xyz, center) + plane.w;
+		let radius = dot(abs(plane.xyz), extents);
+		if (distance + radius < 0.0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+@compute @workgroup_size(64)
+fn cull(@builtin(global_invocation_id) id: vec3u, @builtin(local_invocation_index) local: u32) {
+	if (local == 0u) {
+		atomicStore(&workgroupVisible, 0u);
+	}
+	workgroupBarrier();
+
+	if (id.x < uniforms.objectCount) {
+		let object = objects[id.x];
+		if (isVisible(object)) {
+			let index = atomicAdd(&draws[object.group].instanceCount, 1u);
+			objectIndices[draws[object.group].firstInstance + index] = object.transformSlot;
+			atomicAdd(&workgroupVisible, 1u);
+		}
+	}
+
+	// One global atomic per workgroup for the statistics
+	workgroupBarrier();
+	if (local == 0u) {
+		atomicAdd(&visibleCount, atomicLoad(&workgroupVisible));
+	}
+}
@@ -0,0 +1,34 @@
+// Hierarchical depth pyramid, every texel keeps the farthest depth of the 2x2 texels below it
+// Level 0 halves the depth buffer, which is read through a separate entry point
+
+@group(0) @binding(0) var source: texture_2d<f32>;
+@group(0) @binding(1) var destination: texture_storage_2d<r32float, write>;
+@group(0) @binding(2) var depthSource: texture_depth_2d;
+
+@compute @workgroup_size(8, 8)
+fn downsample_depth(@builtin(global_invocation_id) id: vec3u) {
+	if (any(id.xy >= textureDimensions(destination))) {
+		return;
+	}
+	// The pyramid is a power of two, texels past the edge of the depth buffer repeat the edge
+	let last = textureDimensions(depthSource) - 1u;
+	let base = id.xy * 2u;
+	let farthest = max(
+		max(textureLoad(depthSource, min(base, last), 0), textureLoad(depthSource, min(base + vec2u(1u, 0u), last), 0)),
+		max(textureLoad(depthSource, min(base + vec2u(0u, 1u), last), 0), textureLoad(depthSource, min(base + vec2u(1u, 1u), last), 0)));
+	textureStore(destination, id.xy, vec4f(farthest, 0.0, 0.0, 0.0));
+}
+
+@compute @workgroup_size(8, 8)
+fn downsample(@builtin(global_invocation_id) id: vec3u) {
+	if (any(id.xy >= textureDimensions(destination))) {
+		return;
+	}
+	// Levels of one texel in a direction only shrink along the other one
+	let last = textureDimensions(source) - 1u;
+	let base = id.xy * 2u;
+	let farthest = max(
+		max(textureLoad(source, min(base, last), 0).r, textureLoad(source, min(base + vec2u(1u, 0u), last), 0).r),
+		max(textureLoad(source, min(base + vec2u(0u, 1u), last), 0).r, textureLoad(source, min(base + vec2u(1u, 1u), last), 0).r));
+	textureStore(destination, id.xy, vec4f(farthest, 0.0, 0.0, 0.0));
+}
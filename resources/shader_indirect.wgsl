@@ -0,0 +1,42 @@
+struct Camera {
+	projectionMatrix: mat4x4f,
+	viewMatrix: mat4x4f,
+};
+
+@group(0) @binding(0) var<uniform> uCamera: Camera;
+
+// Every model matrix of the scene
+@group(1) @binding(0) var<storage, read> uModels: array<mat4x4f>;
+// Transform slot of every indirect draw, indexed by the draw index passed as firstInstance
+@group(1) @binding(1) var<storage, read> objectIndices: array<u32>;
+
+@group(2) @binding(0) var gradientTexture: texture_2d<f32>;
+@group(2) @binding(1) var textureSampler: sampler;
+
+struct VertexInput {
+	@location(0) position: vec3f,
+	@location(1) normal: vec3f,
+	@location(2) uv: vec2f,
+};
+
+struct VertexOutput {
+	@builtin(position) position: vec4f,
+	@location(0) normal: vec3f,
+	@location(1) uv: vec2f,
+}
+
+@vertex
+fn vs_main(in: VertexInput, @builtin(instance_index) drawIndex: u32) -> VertexOutput {
+	var out: VertexOutput;
+	let uModel = uModels[objectIndices[drawIndex]];
+	out.position = uCamera.projectionMatrix * uCamera.viewMatrix * uModel * vec4f(in.position, 1.0f);
+	out.normal = in.normal;
+	out.uv = in.uv;
+	return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+	let color = textureSample(gradientTexture, textureSampler, in.uv).rgb;
+	return vec4f(color, 1.0f);
+}
@@ -0,0 +1,94 @@
+// World matrices of a transform hierarchy, one dispatch per depth level
+// The slots are sorted by level, so the parents of a level were all written by earlier dispatches
+// Before them the scatter dispatch copies the local transforms that changed this frame into their slots
+
+struct Level {
+	firstSlot: u32,
+	slotCount: u32,
+	padding0: u32,
+	padding1: u32,
+};
+
+// Local transform of one slot, the w components are unused except for the rotation quaternion (x, y, z, w)
+struct LocalTransform {
+	translation: vec4f,
+	rotation: vec4f,
+	scale: vec4f,
+};
+
+const InvalidIndex: u32 = 0xffffffffu;
+
+@group(0) @binding(0) var<uniform> level: Level;
+@group(0) @binding(1) var<storage, read> locals: array<LocalTransform>;
+@group(0) @binding(2) var<storage, read> parents: array<u32>;
+// The storage transform table read by the vertex shader
+@group(0) @binding(3) var<storage, read_write> worlds: array<mat4x4f>;
+
+// Bindings of the scatter pipeline, the locals are written there
+struct ScatterParams {
+	count: u32,
+	padding0: u32,
+	padding1: u32,
+	padding2: u32,
+};
+
+struct ChangedLocal {
+	local: LocalTransform,
+	slot: u32,
+};
+
+@group(0) @binding(4) var<uniform> scatterParams: ScatterParams;
+@group(0) @binding(5) var<storage, read> changedLocals: array<ChangedLocal>;
+@group(0) @binding(6) var<storage, read_write> scatterLocals: array<LocalTransform>;
+
+// translate * rotate * scale, like TransformStore::getLocalMatrix
+fn localMatrix(local: LocalTransform) -> mat4x4f {
+	let q = local.rotation;
+	let x2 = q.x + q.x;
+	let y2 = q.y + q.y;
+	let z2 = q.z + q.z;
+	let xx = q.x * x2;
+	let yy = q.y * y2;
+	let zz = q.z * z2;
+	let xy = q.x * y2;
+	let xz = q.x * z2;
+	let yz = q.y * z2;
+	let wx = q.w * x2;
+	let wy = q.w * y2;
+	let wz = q.w * z2;
+
+	let s = local.scale.xyz;
+	return mat4x4f(
+		vec4f(1.0 - yy - zz, xy + wz, xz - wy, 0.0) * s.x,
+		vec4f(xy - wz, 1.0 - xx - zz, yz + wx, 0.0) * s.y,
+		vec4f(xz + wy, yz - wx, 1.0 - xx - yy, 0.0) * s.z,
+		vec4f(local.translation.xyz, 1.0),
+	);
+}
+
+@compute @workgroup_size(64)
+fn propagate(@builtin(global_invocation_id) id: vec3u) {
+	if (id.x >= level.slotCount) {
+		return;
+	}
+
+	let slot = level.firstSlot + id.x;
+	let local = localMatrix(locals[slot]);
+	let parent = parents[slot];
+	if (parent == InvalidIndex) {
+		worlds[slot] = local;
+	}
+	else {
+		worlds[slot] = worlds[parent] * local;
+	}
+}
+
+@compute @workgroup_size(64)
+fn scatter(@builtin(global_invocation_id) id: vec3u) {
+	if (id.x >= scatterParams.count) {
+		return;
+	}
+
+	let changed = changedLocals[id.x];
+	scatterLocals[changed.slot] = changed.local;
+}
@@ -5,6 +5,7 @@
 
 #include <webgpu/webgpu.hpp>
 #include "utils.h"
+#include "ResourceTracker.h"
 
 namespace fs = std::filesystem;
 
@@ -141,7 +142,7 @@ Texture loadTexture(const fs::path& path, Device device, TextureView* pTextureVi
     textureDesc.usage = TextureUsage::TextureBinding | TextureUsage::CopyDst;
     textureDesc.viewFormatCount = 0;
     textureDesc.viewFormats = nullptr;
-    Texture texture = device.createTexture(textureDesc);
+    Texture texture = ResourceTracker::createTexture(device, textureDesc, ResourceCategory::Texture);
 
     writeMipMaps(device, texture, textureDesc.size, textureDesc.mipLevelCount, pixelData);
 